@@ -37,6 +37,7 @@ class DistFDB : public FDBBase {
 public: // method
 
     using FDBBase::stats;
+    using FDBBase::archive;
 
     DistFDB(const Config& config, const std::string& name);
     ~DistFDB() override;
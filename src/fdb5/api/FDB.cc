@@ -14,6 +14,7 @@
  */
 
 #include "eckit/config/Resource.h"
+#include "eckit/io/Buffer.h"
 #include "eckit/io/DataHandle.h"
 #include "eckit/io/MemoryHandle.h"
 #include "eckit/log/Log.h"
@@ -40,6 +41,22 @@ FDB::FDB(const Config &config) :
     reportStats_(config.getBool("statistics", false)) {}
 
 
+FDB::FDB(FDB&& other) :
+    internal_(std::move(other.internal_)),
+    dirty_(other.dirty_.exchange(false)),
+    reportStats_(other.reportStats_),
+    stats_(std::move(other.stats_)) {}
+
+FDB& FDB::operator=(FDB&& other) {
+    if (this != &other) {
+        internal_ = std::move(other.internal_);
+        dirty_ = other.dirty_.exchange(false);
+        reportStats_ = other.reportStats_;
+        stats_ = std::move(other.stats_);
+    }
+    return *this;
+}
+
 FDB::~FDB() {
     flush();
     if (reportStats_ && internal_) {
@@ -104,6 +121,20 @@ void FDB::archive(const Key& key, const void* data, size_t length) {
     dirty_ = true;
 
     timer.stop();
+    std::lock_guard<std::mutex> lock(statsMutex_);
+    stats_.addArchive(length, timer);
+}
+
+void FDB::archive(const Key& key, eckit::Buffer&& data) {
+    eckit::Timer timer;
+    timer.start();
+
+    size_t length = data.size();
+    internal_->archive(key, std::move(data));
+    dirty_ = true;
+
+    timer.stop();
+    std::lock_guard<std::mutex> lock(statsMutex_);
     stats_.addArchive(length, timer);
 }
 
@@ -244,6 +275,7 @@ MoveIterator FDB::move(const FDBToolRequest& request, const eckit::URI& dest, bo
 }
 
 FDBStats FDB::stats() const {
+    std::lock_guard<std::mutex> lock(statsMutex_);
     return stats_;
 }
 
@@ -264,15 +296,27 @@ void FDB::print(std::ostream& s) const {
 }
 
 void FDB::flush() {
-    if (dirty_) {
+
+    // n.b. Concurrent flushes are serialised, so that none returns before data archived prior to it is
+    //      flushed by another. Data archived concurrently with the flush marks the FDB dirty again.
+
+    std::lock_guard<std::mutex> flushLock(flushMutex_);
+
+    if (dirty_.exchange(false)) {
 
         eckit::Timer timer;
         timer.start();
 
-        internal_->flush();
-        dirty_ = false;
+        try {
+            internal_->flush();
+        }
+        catch (...) {
+            dirty_ = true;
+            throw;
+        }
 
         timer.stop();
+        std::lock_guard<std::mutex> lock(statsMutex_);
         stats_.addFlush(timer);
     }
 }
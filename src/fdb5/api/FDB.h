@@ -19,7 +19,9 @@
 #ifndef fdb5_api_FDB_H
 #define fdb5_api_FDB_H
 
+#include <atomic>
 #include <memory>
+#include <mutex>
 #include <iosfwd>
 
 #include "fdb5/api/FDBStats.h"
@@ -37,6 +39,7 @@ namespace eckit {
 namespace message {
 class Message;
 }
+class Buffer;
 class DataHandle;
 }  // namespace eckit
 
@@ -62,8 +65,8 @@ public: // methods
     FDB(const FDB&) = delete;
     FDB& operator=(const FDB&) = delete;
 
-    FDB(FDB&&) = default;
-    FDB& operator=(FDB&&) = default;
+    FDB(FDB&&);
+    FDB& operator=(FDB&&);
 
     // -------------- Primary API functions ----------------------------
 
@@ -74,9 +77,14 @@ public: // methods
     void archive(const metkit::mars::MarsRequest& request, eckit::DataHandle& handle);
     // disclaimer: this is a low-level API. The provided key and the corresponding data are not checked for consistency
     void archive(const Key& key, const void* data, size_t length);
+    // as above, but ownership of the data is passed to the FDB, which avoids a copy if it is queued
+    void archive(const Key& key, eckit::Buffer&& data);
+    // n.b. archive() and flush() may be called concurrently from many threads if the (local) FDB is
+    //      configured with concurrentArchive (or FDB_CONCURRENT_ARCHIVE is set)
 
     /// Flushes all buffers and closes all data handles into a consistent DB state
     /// @note always safe to call
+    /// @note with concurrentArchive, all the data archived by any thread before the call is flushed
     void flush();
 
     eckit::DataHandle* read(const eckit::URI& uri);
@@ -140,9 +148,11 @@ private: // members
 
     std::unique_ptr<FDBBase> internal_;
 
-    bool dirty_;
+    std::atomic<bool> dirty_;
     bool reportStats_;
 
+    std::mutex flushMutex_;
+    mutable std::mutex statsMutex_;
     FDBStats stats_;
 };
 
@@ -15,6 +15,7 @@
 
 
 #include "eckit/config/YAMLConfiguration.h"
+#include "eckit/io/Buffer.h"
 #include "eckit/log/Log.h"
 #include "eckit/message/Message.h"
 #include "eckit/thread/AutoLock.h"
@@ -62,6 +63,10 @@ std::string FDBBase::id() const {
     return ss.str();
 }
 
+void FDBBase::archive(const Key& key, eckit::Buffer&& data) {
+    archive(key, data.data(), data.size());
+}
+
 FDBStats FDBBase::stats() const {
     /// By default we have no additional internal statistics
     return FDBStats();
@@ -38,6 +38,7 @@
 #include "fdb5/api/helpers/StatusIterator.h"
 
 namespace eckit {
+class Buffer;
 namespace message {
 class Message;
 }
@@ -65,6 +66,9 @@ public: // methods
 
     virtual void archive(const Key& key, const void* data, size_t length) = 0;
 
+    /// Archive, taking ownership of the data. By default this just archives a view of it.
+    virtual void archive(const Key& key, eckit::Buffer&& data);
+
     virtual void flush() = 0;
 
     virtual ListIterator inspect(const metkit::mars::MarsRequest& request) = 0;
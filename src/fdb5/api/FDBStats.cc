@@ -40,7 +40,10 @@ FDBStats::FDBStats() :
     elapsedRetrieve_(0),
     sumArchiveTimingSquared_(0),
     sumRetrieveTimingSquared_(0),
-    sumFlushTimingSquared_(0) {}
+    sumFlushTimingSquared_(0),
+    numDatabaseOpen_(0),
+    numDatabaseEvict_(0),
+    numDatabaseHit_(0) {}
 
 
 FDBStats::~FDBStats() {}
@@ -60,6 +63,9 @@ FDBStats& FDBStats::operator+=(const FDBStats& rhs) {
     sumArchiveTimingSquared_ += rhs.sumArchiveTimingSquared_;
     sumRetrieveTimingSquared_ += rhs.sumRetrieveTimingSquared_;
     sumFlushTimingSquared_ += rhs.sumFlushTimingSquared_;
+    numDatabaseOpen_ += rhs.numDatabaseOpen_;
+    numDatabaseEvict_ += rhs.numDatabaseEvict_;
+    numDatabaseHit_ += rhs.numDatabaseHit_;
     return *this;
 }
 
@@ -135,6 +141,14 @@ void FDBStats::report(std::ostream& out, const char* prefix) const {
 
     reportCount(out, "num flush", numFlush_, prefix);
     reportTimeStats(out, "flush time", numFlush_, elapsedFlush_, sumFlushTimingSquared_, prefix);
+
+    // Database reuse statistics (only for archivers)
+
+    if (numDatabaseOpen_ != 0) {
+        reportCount(out, "num db open", numDatabaseOpen_, prefix);
+        reportCount(out, "num db evict", numDatabaseEvict_, prefix);
+        reportCount(out, "num db hit", numDatabaseHit_, prefix);
+    }
 }
 
 //----------------------------------------------------------------------------------------------------------------------
@@ -42,6 +42,15 @@ public:
     void addRetrieve(size_t length, eckit::Timer& timer);
     void addFlush(eckit::Timer& timer);
 
+    // Reuse of the databases held open for archiving
+    void addDatabaseOpen() { numDatabaseOpen_++; }
+    void addDatabaseEvict() { numDatabaseEvict_++; }
+    void addDatabaseHit() { numDatabaseHit_++; }
+
+    size_t numDatabaseOpen() const { return numDatabaseOpen_; }
+    size_t numDatabaseEvict() const { return numDatabaseEvict_; }
+    size_t numDatabaseHit() const { return numDatabaseHit_; }
+
     void report(std::ostream& out, const char* indent) const;
 
     FDBStats& operator+=(const FDBStats& rhs);
@@ -65,6 +74,10 @@ private: // members
     double sumArchiveTimingSquared_;
     double sumRetrieveTimingSquared_;
     double sumFlushTimingSquared_;
+
+    size_t numDatabaseOpen_;
+    size_t numDatabaseEvict_;
+    size_t numDatabaseHit_;
 };
 
 //----------------------------------------------------------------------------------------------------------------------
@@ -13,7 +13,9 @@
  * (Project ID: 671951) www.nextgenio.eu
  */
 
+#include "eckit/config/Resource.h"
 #include "eckit/container/Queue.h"
+#include "eckit/io/Buffer.h"
 #include "eckit/log/Log.h"
 #include "eckit/message/Message.h"
 
@@ -21,6 +23,7 @@
 #include "fdb5/api/helpers/FDBToolRequest.h"
 #include "fdb5/api/LocalFDB.h"
 #include "fdb5/database/Archiver.h"
+#include "fdb5/database/ConcurrentArchiver.h"
 #include "fdb5/database/DB.h"
 #include "fdb5/database/EntryVisitMechanism.h"
 #include "fdb5/database/Index.h"
@@ -45,8 +48,31 @@ using namespace eckit;
 
 
 namespace fdb5 {
+
+LocalFDB::LocalFDB(const Config& config, const std::string& name) :
+    FDBBase(config, name),
+    concurrent_(config.getBool("concurrentArchive", eckit::Resource<bool>("fdbConcurrentArchive;$FDB_CONCURRENT_ARCHIVE", false))) {}
+
+ConcurrentArchiver& LocalFDB::concurrentArchiver() {
+
+    std::lock_guard<std::mutex> lock(concurrentMutex_);
+
+    if (!concurrentArchiver_) {
+        static size_t queueLength = eckit::Resource<size_t>("fdbConcurrentArchiveQueueLength;$FDB_CONCURRENT_ARCHIVE_QUEUE_LENGTH", 256);
+        Log::debug<LibFdb5>() << *this << ": Constructing new concurrent archiver" << std::endl;
+        concurrentArchiver_.reset(new ConcurrentArchiver(config_, queueLength));
+    }
+
+    return *concurrentArchiver_;
+}
+
 void LocalFDB::archive(const Key& key, const void* data, size_t length) {
 
+    if (concurrent_) {
+        concurrentArchiver().archive(key, data, length);
+        return;
+    }
+
     if (!archiver_) {
         Log::debug<LibFdb5>() << *this << ": Constructing new archiver" << std::endl;
         archiver_.reset(new Archiver(config_));
@@ -55,6 +81,16 @@ void LocalFDB::archive(const Key& key, const void* data, size_t length) {
     archiver_->archive(key, data, length);
 }
 
+void LocalFDB::archive(const Key& key, eckit::Buffer&& data) {
+
+    if (concurrent_) {
+        concurrentArchiver().archive(key, std::move(data));
+        return;
+    }
+
+    archive(key, data.data(), data.size());
+}
+
 ListIterator LocalFDB::inspect(const metkit::mars::MarsRequest &request) {
 
     if (!inspector_) {
@@ -74,8 +110,9 @@ APIIterator<typename VisitorType::ValueType> LocalFDB::queryInternal(const FDBTo
 
     auto async_worker = [this, request, args...] (Queue<ValueType>& queue) {
         EntryVisitMechanism mechanism(config_);
-        VisitorType visitor(queue, request.request(), args...);
-        mechanism.visit(request, visitor);
+        mechanism.visit<ValueType>(request, queue, [&request, args...] (Queue<ValueType>& q) -> EntryVisitor* {
+            return new VisitorType(q, request.request(), args...);
+        });
     };
 
     return QueryIterator(new AsyncIterator(async_worker));
@@ -124,12 +161,33 @@ ControlIterator LocalFDB::control(const FDBToolRequest& request,
 }
 
 void LocalFDB::flush() {
+    if (concurrent_) {
+        ConcurrentArchiver* archiver;
+        {
+            std::lock_guard<std::mutex> lock(concurrentMutex_);
+            archiver = concurrentArchiver_.get();
+        }
+        if (archiver) {
+            archiver->flush();
+        }
+        return;
+    }
+
     if (archiver_) {
         archiver_->flush();
     }
 }
 
 
+FDBStats LocalFDB::stats() const {
+    if (concurrent_) {
+        std::lock_guard<std::mutex> lock(concurrentMutex_);
+        return concurrentArchiver_ ? concurrentArchiver_->stats() : FDBStats();
+    }
+    return archiver_ ? archiver_->stats() : FDBStats();
+}
+
+
 void LocalFDB::print(std::ostream &s) const {
     s << "LocalFDB(home=" << config_.expandPath("~fdb") << ")";
 }
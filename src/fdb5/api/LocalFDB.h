@@ -19,6 +19,8 @@
 #ifndef fdb5_api_LocalFDB_H
 #define fdb5_api_LocalFDB_H
 
+#include <mutex>
+
 #include "fdb5/api/FDBFactory.h"
 
 
@@ -26,6 +28,7 @@ namespace fdb5 {
 
 class Inspector;
 class Archiver;
+class ConcurrentArchiver;
 class FDB;
 
 //----------------------------------------------------------------------------------------------------------------------
@@ -34,11 +37,14 @@ class LocalFDB : public FDBBase {
 
 public: // methods
 
-    using FDBBase::FDBBase;
+    LocalFDB(const Config& config, const std::string& name);
     using FDBBase::stats;
+    using FDBBase::archive;
 
     void archive(const Key& key, const void* data, size_t length) override;
 
+    void archive(const Key& key, eckit::Buffer&& data) override;
+
     ListIterator inspect(const metkit::mars::MarsRequest& request) override;
 
     ListIterator list(const FDBToolRequest& request) override;
@@ -65,14 +71,24 @@ private: // methods
 
     void print(std::ostream& s) const override;
 
+    FDBStats stats() const override;
+
     template <typename VisitorType, typename ... Ts>
     APIIterator<typename VisitorType::ValueType> queryInternal(const FDBToolRequest& request, Ts ... args);
 
+    ConcurrentArchiver& concurrentArchiver();
+
 private: // members
 
     std::string home_;
 
     std::unique_ptr<Archiver> archiver_;
+
+    // If archive() may be called concurrently (concurrentArchive), all the fields are archived
+    // through a thread-safe front-end instead
+    bool concurrent_;
+    mutable std::mutex concurrentMutex_;
+    std::unique_ptr<ConcurrentArchiver> concurrentArchiver_;
     std::unique_ptr<Inspector> inspector_;
 };
 
@@ -13,7 +13,11 @@
  * (Project ID: 671951) www.nextgenio.eu
  */
 
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
 #include <functional>
+#include <sys/uio.h>
 #include <unistd.h>
 
 #include "fdb5/api/RemoteFDB.h"
@@ -121,7 +125,10 @@ RemoteFDB::RemoteFDB(const eckit::Configuration& config, const std::string& name
     maxArchiveQueueLength_(eckit::Resource<size_t>("fdbRemoteArchiveQueueLength;$FDB_REMOTE_ARCHIVE_QUEUE_LENGTH", 200)),
     maxArchiveBatchSize_(config.getInt("maxBatchSize", 1)),
     retrieveMessageQueue_(eckit::Resource<size_t>("fdbRemoteRetrieveQueueLength;$FDB_REMOTE_RETRIEVE_QUEUE_LENGTH", 200)),
-    connected_(false) {}
+    readWindow_(eckit::Resource<size_t>("fdbRemoteReadWindow;$FDB_REMOTE_READ_WINDOW", 0)),
+    keyArena_(0),
+    connected_(false),
+    multiReadVersion_(0) {}
 
 
 RemoteFDB::~RemoteFDB() {
@@ -252,6 +259,7 @@ SessionID RemoteFDB::verifyServerStartupResponse() {
     LocalConfiguration serverFunctionality(s);
 
     dataEndpoint_ = dataEndpoint;
+    multiReadVersion_ = serverFunctionality.getInt("MultiRead", 0);
 
     if (dataEndpoint_.hostname() != controlEndpoint_.hostname()) {
         Log::warning() << "Data and control interface hostnames do not match. "
@@ -284,6 +292,8 @@ eckit::LocalConfiguration RemoteFDB::availableFunctionality() const {
     eckit::LocalConfiguration conf;
     std::vector<int> remoteFieldLocationVersions = {1};
     conf.set("RemoteFieldLocation", remoteFieldLocationVersions);
+    std::vector<int> multiReadVersions = {1, 2};
+    conf.set("MultiRead", multiReadVersions);
     return conf;
 }
 
@@ -321,9 +331,12 @@ void RemoteFDB::listeningThreadLoop() {
             Buffer payload(hdr.payloadSize);
             if (hdr.payloadSize > 0) dataRead(payload, hdr.payloadSize);
 
+            std::shared_ptr<MessageQueue> queue;
             auto it = messageQueues_.find(hdr.requestID);
             if (it != messageQueues_.end()) {
                 it->second->emplace(std::make_pair(hdr, std::move(payload)));
+            } else if (retrieveQueue(hdr.requestID, queue, false)) {
+                if (queue) queue->emplace(std::make_pair(hdr, std::move(payload)));
             } else {
                 retrieveMessageQueue_.emplace(std::make_pair(hdr, std::move(payload)));
             }
@@ -331,6 +344,7 @@ void RemoteFDB::listeningThreadLoop() {
         }
 
         case Message::Complete: {
+            std::shared_ptr<MessageQueue> queue;
             auto it = messageQueues_.find(hdr.requestID);
             if (it != messageQueues_.end()) {
                 it->second->close();
@@ -339,6 +353,8 @@ void RemoteFDB::listeningThreadLoop() {
                 // goes out of scope in the worker thread).
                 messageQueues_.erase(it);
 
+            } else if (retrieveQueue(hdr.requestID, queue, true)) {
+                if (queue) queue->emplace(std::make_pair(hdr, Buffer(0)));
             } else {
                 retrieveMessageQueue_.emplace(std::make_pair(hdr, Buffer(0)));
             }
@@ -347,6 +363,7 @@ void RemoteFDB::listeningThreadLoop() {
 
         case Message::Error: {
 
+            std::shared_ptr<MessageQueue> queue;
             auto it = messageQueues_.find(hdr.requestID);
             if (it != messageQueues_.end()) {
                 std::string msg;
@@ -373,6 +390,10 @@ void RemoteFDB::listeningThreadLoop() {
 
                     archiveQueue_->interrupt(std::make_exception_ptr(RemoteFDBException(msg, dataEndpoint_)));
                 }
+            } else if (retrieveQueue(hdr.requestID, queue, true)) {
+                Buffer payload(hdr.payloadSize);
+                if (hdr.payloadSize > 0) dataRead(payload, hdr.payloadSize);
+                if (queue) queue->emplace(std::make_pair(hdr, std::move(payload)));
             } else {
                 Buffer payload(hdr.payloadSize);
                 if (hdr.payloadSize > 0) dataRead(payload, hdr.payloadSize);
@@ -404,6 +425,13 @@ void RemoteFDB::listeningThreadLoop() {
         }
         messageQueues_.clear();
         retrieveMessageQueue_.interrupt(std::make_exception_ptr(e));
+        {
+            std::lock_guard<std::mutex> lock(retrieveQueuesMutex_);
+            for (auto& it : retrieveQueues_) {
+                if (it.second) it.second->interrupt(std::make_exception_ptr(e));
+            }
+            retrieveQueues_.clear();
+        }
         {
             std::lock_guard<std::mutex> lock(archiveQueuePtrMutex_);
             if (archiveQueue_) archiveQueue_->interrupt(std::make_exception_ptr(e));
@@ -414,6 +442,13 @@ void RemoteFDB::listeningThreadLoop() {
         }
         messageQueues_.clear();
         retrieveMessageQueue_.interrupt(std::current_exception());
+        {
+            std::lock_guard<std::mutex> lock(retrieveQueuesMutex_);
+            for (auto& it : retrieveQueues_) {
+                if (it.second) it.second->interrupt(std::current_exception());
+            }
+            retrieveQueues_.clear();
+        }
         {
             std::lock_guard<std::mutex> lock(archiveQueuePtrMutex_);
             if (archiveQueue_) archiveQueue_->interrupt(std::current_exception());
@@ -423,6 +458,8 @@ void RemoteFDB::listeningThreadLoop() {
 
 void RemoteFDB::controlWriteCheckResponse(Message msg, uint32_t requestID, const void* payload, uint32_t payloadLength) {
 
+    std::lock_guard<std::mutex> lock(controlMutex_);
+
     controlWrite(msg, requestID, payload, payloadLength);
 
     // Wait for the receipt acknowledgement
@@ -492,6 +529,47 @@ void RemoteFDB::dataWrite(const void* data, size_t length) {
     }
 }
 
+void RemoteFDB::dataWrite(std::vector<struct iovec>& iov) {
+
+    // n.b. this consumes (modifies) the iovec entries as the data is written
+
+    static const size_t maxIov = []() -> size_t {
+        long n = ::sysconf(_SC_IOV_MAX);
+        return n > 0 ? size_t(n) : 1024;
+    }();
+
+    size_t pos = 0;
+    while (pos < iov.size()) {
+
+        if (iov[pos].iov_len == 0) {
+            ++pos;
+            continue;
+        }
+
+        size_t n = std::min(iov.size() - pos, maxIov);
+        ssize_t written = ::writev(dataClient_.socket(), &iov[pos], int(n));
+
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            std::stringstream ss;
+            ss << "Write error: " << ::strerror(errno);
+            throw TCPException(ss.str(), Here());
+        }
+
+        size_t remaining = size_t(written);
+        while (remaining > 0 && pos < iov.size()) {
+            if (remaining >= iov[pos].iov_len) {
+                remaining -= iov[pos].iov_len;
+                ++pos;
+            } else {
+                iov[pos].iov_base = static_cast<char*>(iov[pos].iov_base) + remaining;
+                iov[pos].iov_len -= remaining;
+                remaining = 0;
+            }
+        }
+    }
+}
+
 void RemoteFDB::dataRead(void* data, size_t length) {
     size_t read = dataClient_.read(data, length);
     if (length != read) {
@@ -526,6 +604,46 @@ FDBStats RemoteFDB::stats() const {
     return internalStats_;
 }
 
+bool RemoteFDB::retrieveQueue(uint32_t requestID, std::shared_ptr<MessageQueue>& queue, bool remove) {
+
+    std::lock_guard<std::mutex> lock(retrieveQueuesMutex_);
+
+    auto it = retrieveQueues_.find(requestID);
+    if (it == retrieveQueues_.end()) return false;
+
+    queue = it->second;
+    if (remove) retrieveQueues_.erase(it);
+    return true;
+}
+
+// The server is told to stop reading an abandoned request, which it then terminates with a
+// Complete (or Error). Until that arrives, any data still in flight is discarded on receipt (it
+// must not fall through to the shared retrieve queue), and the entry is then removed as usual.
+
+void RemoteFDB::abandonRetrieveQueue(uint32_t requestID) {
+
+    {
+        std::lock_guard<std::mutex> lock(retrieveQueuesMutex_);
+
+        auto it = retrieveQueues_.find(requestID);
+        if (it == retrieveQueues_.end()) return;
+        it->second.reset();
+    }
+
+    // n.b. a credit of zero cancels the request
+
+    sendReadCredit(requestID, 0);
+}
+
+void RemoteFDB::sendReadCredit(uint32_t requestID, size_t credit) {
+
+    Buffer payload(256);
+    MemoryStream s(payload);
+    s << credit;
+
+    controlWriteCheckResponse(Message::ReadCredit, requestID, payload, s.position());
+}
+
 
 // Implement the primary FDB API
 
@@ -764,6 +882,10 @@ MoveIterator RemoteFDB::move(const FDBToolRequest& request, const eckit::URI& de
 
 // Here we do archive/flush related stuff
 void RemoteFDB::archive(const Key& key, const void* data, size_t length) {
+    archive(key, Buffer(reinterpret_cast<const char*>(data), length));
+}
+
+void RemoteFDB::archive(const Key& key, Buffer&& data) {
 
     connect();
 
@@ -793,7 +915,7 @@ void RemoteFDB::archive(const Key& key, const void* data, size_t length) {
     {
         std::lock_guard<std::mutex> lock(archiveQueuePtrMutex_);
         ASSERT(archiveQueue_);
-        archiveQueue_->emplace(std::make_pair(key, Buffer(reinterpret_cast<const char*>(data), length)));
+        archiveQueue_->emplace(std::make_pair(key, std::move(data)));
     }
 }
 
@@ -884,64 +1006,71 @@ FDBStats RemoteFDB::archiveThreadLoop(uint32_t requestID) {
 
 long RemoteFDB::sendArchiveData(uint32_t id, const std::vector<std::pair<Key, Buffer>>& elements, size_t count) {
 
-    if (count == 1) {
-        sendArchiveData(id, elements[0].first, elements[0].second.data(), elements[0].second.size());
-        return elements[0].second.size();
-    }
+    ASSERT(count > 0);
 
-    // Serialise the keys
+    // Serialise all of the keys into one (reused) arena, rather than a buffer per field
 
-    std::vector<Buffer> keyBuffers;
-    std::vector<size_t> keySizes;
-    keyBuffers.reserve(count);
-    keySizes.reserve(count);
+    if (keyArena_.size() < count * 4096) {
+        Buffer arena(count * 4096);
+        keyArena_.swap(arena);
+    }
 
-    size_t containedSize = 0;
+    std::vector<size_t> keyOffsets;
+    keyOffsets.reserve(count + 1);
 
+    MemoryStream keyStream(keyArena_);
     for (size_t i = 0; i < count; ++i) {
-        keyBuffers.emplace_back(Buffer {4096});
-        MemoryStream keyStream(keyBuffers.back());
+        keyOffsets.push_back(keyStream.position());
         keyStream << elements[i].first;
-        keySizes.push_back(keyStream.position());
-        containedSize += (keyStream.position() + elements[i].second.size() +
-                          sizeof(MessageHeader) + sizeof(EndMarker));
     }
+    keyOffsets.push_back(keyStream.position());
 
-    // Construct the containing message
+    // Describe the whole message, and send it with as few system calls as possible. The data
+    // is sent directly from the archived buffers. A single field is sent as a bare Blob.
 
-    MessageHeader message(Message::MultiBlob, id, containedSize);
-    dataWrite(&message, sizeof(message));
+    bool multi = (count > 1);
 
-    long dataSent = 0;
+    std::vector<MessageHeader> headers;
+    headers.reserve(count + 1);
 
-    for (size_t i = 0; i < count; ++i) {
-        MessageHeader containedMessage(Message::Blob, id, elements[i].second.size() + keySizes[i]);
-        dataWrite(&containedMessage, sizeof(containedMessage));
-        dataWrite(keyBuffers[i], keySizes[i]);
-        dataWrite(elements[i].second.data(), elements[i].second.size());
-        dataWrite(&EndMarker, sizeof(EndMarker));
-        dataSent += elements[i].second.size();
+    std::vector<struct iovec> iov;
+    iov.reserve(4 * count + 2);
+
+    auto append = [&iov](const void* data, size_t length) {
+        iov.push_back({const_cast<void*>(data), length});
+    };
+
+    if (multi) {
+        headers.emplace_back(Message::MultiBlob, id, 0);
+        append(&headers.back(), sizeof(MessageHeader));
     }
 
-    dataWrite(&EndMarker, sizeof(EndMarker));
-    return dataSent;
-}
+    size_t containedSize = 0;
+    long dataSent = 0;
 
+    for (size_t i = 0; i < count; ++i) {
 
-void RemoteFDB::sendArchiveData(uint32_t id, const Key& key, const void* data, size_t length) {
+        const Buffer& data(elements[i].second);
+        size_t keySize = keyOffsets[i + 1] - keyOffsets[i];
+        ASSERT(data.size() != 0);
 
-    ASSERT(data);
-    ASSERT(length != 0);
+        headers.emplace_back(Message::Blob, id, data.size() + keySize);
+        append(&headers.back(), sizeof(MessageHeader));
+        append(static_cast<const char*>(keyArena_.data()) + keyOffsets[i], keySize);
+        append(data.data(), data.size());
+        append(&EndMarker, sizeof(EndMarker));
 
-    Buffer keyBuffer(4096);
-    MemoryStream keyStream(keyBuffer);
-    keyStream << key;
+        containedSize += (sizeof(MessageHeader) + keySize + data.size() + sizeof(EndMarker));
+        dataSent += data.size();
+    }
 
-    MessageHeader message(Message::Blob, id, length + keyStream.position());
-    dataWrite(&message, sizeof(message));
-    dataWrite(keyBuffer, keyStream.position());
-    dataWrite(data, length);
-    dataWrite(&EndMarker, sizeof(EndMarker));
+    if (multi) {
+        headers.front().payloadSize = containedSize;
+        append(&EndMarker, sizeof(EndMarker));
+    }
+
+    dataWrite(iov);
+    return dataSent;
 }
 
 // -----------------------------------------------------------------------------------------------------
@@ -957,6 +1086,12 @@ void RemoteFDB::sendArchiveData(uint32_t id, const Key& key, const void* data, s
 ///       in the stream
 ///
 /// --> Retrieve is a _streaming_ service.
+///
+/// @note The exception is if a read window is configured (fdbRemoteReadWindow). Then each
+///       (batched) read gets its own queue, and the server only sends as many bytes for a
+///       request as the client has granted it credit for. The handle returns credit as the
+///       data is consumed. Memory use is bounded by the window per request, and the
+///       handles may be read in any order, or concurrently.
 
 namespace {
 
@@ -973,7 +1108,40 @@ public: // methods
         pos_(0),
         overallPosition_(0),
         currentBuffer_(0),
-        complete_(false) {}
+        complete_(false),
+        remoteFDB_(nullptr),
+        creditThreshold_(0),
+        consumed_(0) {}
+
+    /// A handle on a demultiplexed retrieve. Consumed data is returned to the server as credit,
+    /// once creditThreshold bytes have been consumed.
+    FDBRemoteDataHandle(uint32_t requestID,
+                        std::shared_ptr<RemoteFDB::MessageQueue> queue,
+                        const net::Endpoint& remoteEndpoint,
+                        RemoteFDB* remoteFDB,
+                        size_t creditThreshold) :
+        requestID_(requestID),
+        ownedQueue_(queue),
+        queue_(*queue),
+        remoteEndpoint_(remoteEndpoint),
+        pos_(0),
+        overallPosition_(0),
+        currentBuffer_(0),
+        complete_(false),
+        remoteFDB_(remoteFDB),
+        creditThreshold_(creditThreshold),
+        consumed_(0) {}
+
+    ~FDBRemoteDataHandle() override {
+        if (remoteFDB_ && !complete_) {
+            try {
+                remoteFDB_->abandonRetrieveQueue(requestID_);
+            } catch (std::exception& e) {
+                Log::error() << "Failed to cancel retrieve " << requestID_ << ": " << e.what() << std::endl;
+            }
+        }
+    }
+
     virtual bool canSeek() const override { return false; }
 
 private: // methods
@@ -1018,7 +1186,7 @@ private: // methods
         // Are we now complete
 
         if (hdr.message == Message::Complete) {
-            complete_ = 0;
+            complete_ = true;
             return 0;
         }
 
@@ -1048,6 +1216,7 @@ private: // methods
         // If we have exhausted this buffer, free it up.
 
         if (pos_ >= currentBuffer_.size()) {
+            if (remoteFDB_) returnCredit(currentBuffer_.size());
             Buffer nullBuffer(0);
             std::swap(currentBuffer_, nullBuffer);
             pos_ = 0;
@@ -1057,6 +1226,14 @@ private: // methods
         return read;
     }
 
+    void returnCredit(size_t consumed) {
+        consumed_ += consumed;
+        if (consumed_ >= creditThreshold_) {
+            remoteFDB_->sendReadCredit(requestID_, consumed_);
+            consumed_ = 0;
+        }
+    }
+
     Length estimate() override {
         return 0;
     }
@@ -1068,12 +1245,18 @@ private: // methods
 private: // members
 
     uint32_t requestID_;
+    std::shared_ptr<RemoteFDB::MessageQueue> ownedQueue_;
     RemoteFDB::MessageQueue& queue_;
     net::Endpoint remoteEndpoint_;
     size_t pos_;
     Offset overallPosition_;
     Buffer currentBuffer_;
     bool complete_;
+
+    // Flow control (demultiplexed retrieves only)
+    RemoteFDB* remoteFDB_;
+    size_t creditThreshold_;
+    size_t consumed_;
 };
 
 }
@@ -1119,6 +1302,152 @@ eckit::DataHandle* RemoteFDB::dataHandle(const FieldLocation& fieldLocation, con
     return new FDBRemoteDataHandle(id, retrieveMessageQueue_, controlEndpoint_);
 }
 
+eckit::DataHandle* RemoteFDB::dataHandle(const std::vector<std::shared_ptr<const FieldLocation>>& fieldLocations) {
+
+    ASSERT(!fieldLocations.empty());
+
+    connect();
+
+    bool flowControlled = (readWindow_ != 0 && multiReadVersion_ >= 2);
+
+    if (!flowControlled && (fieldLocations.size() == 1 || multiReadVersion_ == 0)) {
+        ASSERT(fieldLocations.size() == 1);
+        return dataHandle(*fieldLocations[0]);
+    }
+
+    // Size the encoding buffer up front, rather than guessing a (very) large upper bound
+
+    size_t encodedSize = 0;
+    {
+        Buffer sizingBuffer(4096);
+        for (const auto& location : fieldLocations) {
+            MemoryStream s(sizingBuffer);
+            s << *location;
+            encodedSize += s.position();
+        }
+    }
+
+    Buffer encodeBuffer(encodedSize + 1024);
+    MemoryStream s(encodeBuffer);
+    if (multiReadVersion_ >= 2) {
+        s << (flowControlled ? readWindow_ : size_t(0));
+    }
+    s << fieldLocations.size();
+    for (const auto& location : fieldLocations) {
+        s << *location;
+    }
+
+    uint32_t id = generateRequestID();
+
+    if (!flowControlled) {
+        controlWriteCheckResponse(Message::MultiRead, id, encodeBuffer, s.position());
+        return new FDBRemoteDataHandle(id, retrieveMessageQueue_, controlEndpoint_);
+    }
+
+    // The queue must exist before the request is sent, as data may arrive before the receipt
+    // is acknowledged. n.b. The queue length is not what bounds memory use (the window is), it
+    // just must be large enough to never block the listening thread.
+
+    static const size_t maxQueueLength = 65536;
+
+    auto queue = std::make_shared<MessageQueue>(maxQueueLength);
+    {
+        std::lock_guard<std::mutex> lock(retrieveQueuesMutex_);
+        retrieveQueues_.emplace(id, queue);
+    }
+
+    try {
+        controlWriteCheckResponse(Message::MultiRead, id, encodeBuffer, s.position());
+    } catch (...) {
+        std::shared_ptr<MessageQueue> q;
+        retrieveQueue(id, q, true);
+        throw;
+    }
+
+    return new FDBRemoteDataHandle(id, queue, controlEndpoint_, this, std::max(readWindow_ / 2, size_t(1)));
+}
+
+// -----------------------------------------------------------------------------------------------------
+
+/// @note The deferred handle does not contact the server until it is opened. Until then it
+///       absorbs (via merge()) any subsequent deferred handles for the same RemoteFDB, so that
+///       a retrieve aggregated by the HandleGatherer costs one control round trip in total,
+///       rather than one per field.
+
+namespace {
+
+class FDBRemoteDeferredDataHandle : public DataHandle {
+
+public: // methods
+
+    FDBRemoteDeferredDataHandle(RemoteFDB* remoteFDB, std::shared_ptr<const FieldLocation> location) :
+        remoteFDB_(remoteFDB),
+        locations_{std::move(location)} {}
+
+    virtual bool canSeek() const override { return false; }
+
+private: // methods
+
+    void print(std::ostream& s) const override {
+        s << "FDBRemoteDeferredDataHandle(fdb=" << *remoteFDB_ << ", fields=" << locations_.size() << ")";
+    }
+
+    bool merge(DataHandle* other) override {
+
+        if (handle_) return false;
+
+        FDBRemoteDeferredDataHandle* rhs = dynamic_cast<FDBRemoteDeferredDataHandle*>(other);
+        if (!rhs || rhs->handle_ || rhs->remoteFDB_ != remoteFDB_) return false;
+        if (!remoteFDB_->multiReadSupported()) return false;
+
+        locations_.insert(locations_.end(), rhs->locations_.begin(), rhs->locations_.end());
+        return true;
+    }
+
+    Length openForRead() override {
+        ASSERT(!handle_);
+        handle_.reset(remoteFDB_->dataHandle(locations_));
+        return handle_->openForRead();
+    }
+
+    void openForWrite(const Length&) override { NOTIMP; }
+    void openForAppend(const Length&) override { NOTIMP; }
+    long write(const void*, long) override { NOTIMP; }
+
+    void close() override {
+        if (handle_) handle_->close();
+    }
+
+    long read(void* pos, long sz) override {
+        ASSERT(handle_);
+        return handle_->read(pos, sz);
+    }
+
+    Length estimate() override {
+        long long total = 0;
+        for (const auto& location : locations_) {
+            total += location->length();
+        }
+        return Length(total);
+    }
+
+    Offset position() override {
+        return handle_ ? handle_->position() : Offset(0);
+    }
+
+private: // members
+
+    RemoteFDB* remoteFDB_;
+    std::vector<std::shared_ptr<const FieldLocation>> locations_;
+    std::unique_ptr<DataHandle> handle_;
+};
+
+}
+
+eckit::DataHandle* RemoteFDB::deferredDataHandle(std::shared_ptr<const FieldLocation> fieldLocation) {
+    return new FDBRemoteDeferredDataHandle(this, std::move(fieldLocation));
+}
+
 void RemoteFDB::print(std::ostream &s) const {
     s << "RemoteFDB(host=" << controlEndpoint_ << ", data=" << dataEndpoint_ << ")";
 }
@@ -19,6 +19,8 @@
 #ifndef fdb5_remote_RemoteFDB_H
 #define fdb5_remote_RemoteFDB_H
 
+#include <sys/uio.h>
+
 #include <future>
 #include <thread>
 
@@ -56,10 +58,26 @@ public: // method
 
     /// Archive writes data into aggregation buffer
     void archive(const Key& key, const void* data, size_t length) override;
+    void archive(const Key& key, eckit::Buffer&& data) override;
 
     eckit::DataHandle* dataHandle(const FieldLocation& fieldLocation);
     eckit::DataHandle* dataHandle(const FieldLocation& fieldLocation, const Key& remapKey);
 
+    /// Request a sequence of fields with a single control message. The data is streamed back
+    /// in the order of the supplied locations, on one DataHandle.
+    eckit::DataHandle* dataHandle(const std::vector<std::shared_ptr<const FieldLocation>>& fieldLocations);
+
+    /// A DataHandle that only issues its read request when opened. Consecutive handles on the
+    /// same RemoteFDB merge (see HandleGatherer), so that they are read in one round trip.
+    eckit::DataHandle* deferredDataHandle(std::shared_ptr<const FieldLocation> fieldLocation);
+
+    bool multiReadSupported() const { return multiReadVersion_ > 0; }
+
+    // Flow control for demultiplexed retrieves (see fdbRemoteReadWindow). Abandoning a retrieve
+    // cancels it on the server.
+    void sendReadCredit(uint32_t requestID, size_t credit);
+    void abandonRetrieveQueue(uint32_t requestID);
+
     ListIterator inspect(const metkit::mars::MarsRequest& request) override;
 
     ListIterator list(const FDBToolRequest& request) override;
@@ -111,9 +129,14 @@ private: // methods
     void controlRead(void* data, size_t length);
     void dataWrite(remote::Message msg, uint32_t requestID, const void* payload=nullptr, uint32_t payloadLength=0);
     void dataWrite(const void* data, size_t length);
+    void dataWrite(std::vector<struct iovec>& iov);
     void dataRead(void* data, size_t length);
     void handleError(const remote::MessageHeader& hdr);
 
+    // Demultiplexed (flow controlled) retrieves. If requestID belongs to one, returns true and
+    // its queue. The queue is null if the DataHandle has been abandoned before completion.
+    bool retrieveQueue(uint32_t requestID, std::shared_ptr<MessageQueue>& queue, bool remove);
+
     // Worker for the API functions
 
     template <typename HelperClass>
@@ -123,7 +146,6 @@ private: // methods
 
     FDBStats archiveThreadLoop(uint32_t requestID);
 
-    void sendArchiveData(uint32_t id, const Key& key, const void* data, size_t length);
     long sendArchiveData(uint32_t id, const std::vector<std::pair<Key, eckit::Buffer>>& elements, size_t count);
 
     virtual void print(std::ostream& s) const override;
@@ -168,7 +190,23 @@ private: // members
     std::unique_ptr<ArchiveQueue> archiveQueue_;
     MessageQueue retrieveMessageQueue_;
 
+    // If a read window is configured (and the server supports it), each retrieve gets its own
+    // queue. The server only sends as much data as the client has granted credit for, so the
+    // queues are bounded and can be consumed in any order, or concurrently.
+    size_t readWindow_;
+
+    // Scratch space for the keys encoded by sendArchiveData (archive thread only)
+    eckit::Buffer keyArena_;
+    std::mutex retrieveQueuesMutex_;
+    std::map<uint32_t, std::shared_ptr<MessageQueue>> retrieveQueues_;
+
+    // Requests on the control connection may come from multiple consuming threads
+    std::mutex controlMutex_;
+
     bool connected_;
+
+    // The version of batched (MultiRead) requests agreed during protocol negotiation (0 = none)
+    int multiReadVersion_;
 };
 
 //----------------------------------------------------------------------------------------------------------------------
@@ -13,6 +13,7 @@
  * (Project ID: 671951) www.nextgenio.eu
  */
 
+#include "eckit/io/Buffer.h"
 #include "eckit/log/Log.h"
 #include "eckit/message/Message.h"
 #include "eckit/utils/Tokenizer.h"
@@ -98,6 +99,24 @@ void SelectFDB::archive(const Key& key, const void* data, size_t length) {
     throw eckit::UserError(ss.str(), Here());
 }
 
+void SelectFDB::archive(const Key& key, eckit::Buffer&& data) {
+
+    for (auto& iter : subFdbs_) {
+
+        const SelectMap& select(iter.first);
+        FDB& fdb(iter.second);
+
+        if (matches(key, select, true)) {
+            fdb.archive(key, std::move(data));
+            return;
+        }
+    }
+
+    std::stringstream ss;
+    ss << "No matching fdb for key: " << key;
+    throw eckit::UserError(ss.str(), Here());
+}
+
 ListIterator SelectFDB::inspect(const metkit::mars::MarsRequest& request) {
 
     std::queue<APIIterator<ListElement>> lists;
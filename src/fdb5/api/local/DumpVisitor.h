@@ -43,6 +43,7 @@ public:
 
     bool visitIndexes() override { return false; }
     bool visitEntries() override { return false; }
+    bool concurrentDatabases() override { return true; }
 
     bool visitDatabase(const Catalogue& catalogue, const Store& store) override {
         catalogue.dump(out_, simple_);
@@ -37,6 +37,8 @@ struct ListVisitor : public QueryVisitor<ListElement> {
 public:
     using QueryVisitor<ListElement>::QueryVisitor;
 
+    bool concurrentDatabases() override { return true; }
+
     /// Make a note of the current database. Subtract its key from the current
     /// request so we can test request is used in its entirety
     bool visitDatabase(const Catalogue& catalogue, const Store& store) override {
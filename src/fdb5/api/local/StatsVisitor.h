@@ -38,6 +38,8 @@ public:
 
     using QueryVisitor<StatsElement>::QueryVisitor;
 
+    bool concurrentDatabases() override { return true; }
+
     bool visitDatabase(const Catalogue& catalogue, const Store& store) override;
     bool visitIndex(const Index& index) override;
     void catalogueComplete(const Catalogue& catalogue) override;
@@ -0,0 +1,120 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#include "eckit/exception/Exceptions.h"
+#include "eckit/log/Log.h"
+
+#include "fdb5/LibFdb5.h"
+#include "fdb5/database/ArchiveWorker.h"
+#include "fdb5/database/DB.h"
+
+namespace fdb5 {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+ArchiveWorker::ArchiveWorker(DB& db, size_t queueLength) :
+    db_(db),
+    queue_(queueLength),
+    barriersRequested_(0),
+    barriersCompleted_(0),
+    thread_([this] { run(); }) {}
+
+ArchiveWorker::~ArchiveWorker() {
+
+    // n.b. the queue is drained before the thread exits
+
+    queue_.close();
+    thread_.join();
+
+    if (error_) {
+        eckit::Log::error() << "Unreported error in archive worker for " << db_ << std::endl;
+    }
+}
+
+void ArchiveWorker::archive(const Key& index, const Key& datum, const void* data, size_t length) {
+    push(Task{index, datum, eckit::Buffer(static_cast<const char*>(data), length), 0, false});
+}
+
+void ArchiveWorker::sync(bool flush) {
+
+    size_t barrier;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        barrier = ++barriersRequested_;
+    }
+
+    push(Task{Key{}, Key{}, eckit::Buffer{0}, barrier, flush});
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    cv_.wait(lock, [this, barrier] { return barriersCompleted_ >= barrier || error_; });
+
+    if (error_) {
+        std::exception_ptr e = error_;
+        error_ = nullptr;
+        std::rethrow_exception(e);
+    }
+}
+
+void ArchiveWorker::push(Task&& task) {
+    try {
+        queue_.emplace(std::move(task));
+    }
+    catch (...) {
+        // The worker has failed, and the queue rethrows its error. Don't report it twice.
+        std::lock_guard<std::mutex> lock(mutex_);
+        error_ = nullptr;
+        throw;
+    }
+}
+
+void ArchiveWorker::run() {
+
+    Task task{Key{}, Key{}, eckit::Buffer{0}, 0, false};
+
+    // The index last selected by this worker. Cleared at each barrier, as the caller may
+    // then use the DB directly.
+    Key index;
+
+    try {
+        while (queue_.pop(task) != -1) {
+
+            if (task.barrier != 0) {
+                if (task.flush) {
+                    db_.flush();
+                }
+                index = Key();
+                std::lock_guard<std::mutex> lock(mutex_);
+                barriersCompleted_ = task.barrier;
+                cv_.notify_all();
+                continue;
+            }
+
+            if (task.index != index) {
+                db_.selectIndex(task.index);
+                index = task.index;
+            }
+
+            db_.archive(task.datum, task.data, task.data.size());
+        }
+    }
+    catch (...) {
+        eckit::Log::debug<LibFdb5>() << "Archive worker for " << db_ << " failed" << std::endl;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            error_ = std::current_exception();
+            cv_.notify_all();
+        }
+        queue_.interrupt(std::current_exception());
+    }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+} // namespace fdb5
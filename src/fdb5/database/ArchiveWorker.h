@@ -0,0 +1,87 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+/// @file   ArchiveWorker.h
+/// @date   Oct 2026
+
+#ifndef fdb5_ArchiveWorker_H
+#define fdb5_ArchiveWorker_H
+
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <thread>
+
+#include "eckit/container/Queue.h"
+#include "eckit/io/Buffer.h"
+#include "eckit/memory/NonCopyable.h"
+
+#include "fdb5/database/Key.h"
+
+namespace fdb5 {
+
+class DB;
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/// A thread that owns the writing of one database, for the asynchronous Archiver.
+/// Fields are written in the order they are queued. Once a field has failed, the error is
+/// rethrown to the next caller of archive() or sync().
+
+class ArchiveWorker : public eckit::NonCopyable {
+
+public: // methods
+
+    ArchiveWorker(DB& db, size_t queueLength);
+
+    ~ArchiveWorker();
+
+    /// Queue a (copy of the) field for archival into the given index
+    void archive(const Key& index, const Key& datum, const void* data, size_t length);
+
+    /// Wait until all of the queued fields have been written, optionally followed by a flush of the DB.
+    /// Until the next call to archive(), the DB may then be safely used by the calling thread.
+    void sync(bool flush);
+
+private: // types
+
+    struct Task {
+        Key index;
+        Key datum;
+        eckit::Buffer data;
+        size_t barrier;  // if non-zero, a sync() request
+        bool flush;
+    };
+
+private: // methods
+
+    void push(Task&& task);
+    void run();
+
+private: // members
+
+    DB& db_;
+
+    eckit::Queue<Task> queue_;
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    size_t barriersRequested_;
+    size_t barriersCompleted_;
+    std::exception_ptr error_;
+
+    std::thread thread_;
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+
+} // namespace fdb5
+
+#endif
@@ -11,10 +11,13 @@
 
 #include "fdb5/database/Archiver.h"
 
+#include <future>
+
 #include "eckit/config/Resource.h"
 
 #include "fdb5/LibFdb5.h"
 #include "fdb5/database/ArchiveVisitor.h"
+#include "fdb5/database/ArchiveWorker.h"
 #include "fdb5/database/BaseArchiveVisitor.h"
 #include "fdb5/rules/Schema.h"
 #include "fdb5/rules/Rule.h"
@@ -23,26 +26,104 @@ namespace fdb5 {
 
 //----------------------------------------------------------------------------------------------------------------------
 
+/// Expands the key on the calling thread, but leaves the database to be written by its worker.
+
+class AsyncArchiveVisitor : public BaseArchiveVisitor {
+
+public: // methods
+
+    AsyncArchiveVisitor(Archiver &owner, const Key &field, const void *data, size_t size) :
+        BaseArchiveVisitor(owner, field),
+        owner_(owner),
+        data_(data),
+        size_(size) {}
+
+protected: // methods
+
+    bool selectDatabase(const Key &key, const Key&) override {
+        // n.b. unlike BaseArchiveVisitor, don't touch the database. Its worker may be using it.
+        eckit::Log::debug<LibFdb5>() << "selectDatabase " << key << std::endl;
+        owner_.current_ = &owner_.database(key);
+        ASSERT(owner_.currentWorker_);
+        return true;
+    }
+
+    bool selectIndex(const Key &key, const Key&) override {
+        owner_.currentIndex_ = key;
+        return true;
+    }
+
+    bool selectDatum(const Key &key, const Key &full) override {
+        checkMissingKeys(full);
+        ASSERT(owner_.currentWorker_);
+        owner_.currentWorker_->archive(owner_.currentIndex_, key, data_, size_);
+        return true;
+    }
+
+    void print(std::ostream &out) const override {
+        out << "AsyncArchiveVisitor["
+            << "size=" << size_
+            << "]";
+    }
+
+private: // members
+
+    Archiver& owner_;
+
+    const void *data_;
+    size_t size_;
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+
 
 Archiver::Archiver(const Config& dbConfig) :
     dbConfig_(dbConfig),
+    asynchronous_(eckit::Resource<bool>("fdbAsyncArchiver;$FDB_ASYNC_ARCHIVER", false)),
+    workerQueueLength_(eckit::Resource<size_t>("fdbAsyncArchiverQueueLength;$FDB_ASYNC_ARCHIVER_QUEUE_LENGTH", 32)),
+    maxOpenDatabases_(dbConfig.getInt("maxOpenDatabases", eckit::Resource<size_t>("fdbMaxNbDBsOpen", 64))),
+    currentWorker_(nullptr),
     current_(nullptr) {
+    ASSERT(maxOpenDatabases_ > 0);
 }
 
 Archiver::~Archiver() {
 
-    flush(); // certify that all sessions are flushed before closing them
+    // Certify that all sessions are flushed before closing them. n.b. a destructor must not throw,
+    // so an error (e.g. from an asynchronous worker) can only be reported.
 
-    databases_.clear(); //< explicitly delete the DBs before schemas are destroyed
+    try {
+        flush();
+    }
+    catch (std::exception& e) {
+        eckit::Log::error() << "Failed to flush the archived data: " << e.what() << std::endl;
+    }
+
+    databases_.clear();
+    lru_.clear(); //< explicitly delete the DBs before schemas are destroyed
 }
 
 void Archiver::archive(const Key &key, const void* data, size_t len) {
-    ArchiveVisitor visitor(*this, key, data, len);
-    archive(key, visitor);
+    if (asynchronous_) {
+        AsyncArchiveVisitor visitor(*this, key, data, len);
+        archive(key, visitor);
+    } else {
+        ArchiveVisitor visitor(*this, key, data, len);
+        archive(key, visitor);
+    }
 }
 
 void Archiver::archive(const Key &key, BaseArchiveVisitor& visitor) {
 
+    // In asynchronous mode, other visitors use the databases directly. Wait for the workers to be
+    // idle, and ensure that the database and index are selected afresh before and afterwards.
+
+    bool direct = asynchronous_ && !dynamic_cast<AsyncArchiveVisitor*>(&visitor);
+    if (direct) {
+        sync(false);
+        prev_.assign(prev_.size(), Key());
+    }
+
     visitor.rule(nullptr);
 
     dbConfig_.schema().expand(key, visitor);
@@ -52,42 +133,78 @@ void Archiver::archive(const Key &key, BaseArchiveVisitor& visitor) {
         oss << "FDB: Could not find a rule to archive " << key;
         throw eckit::SeriousBug(oss.str());
     }
+
+    if (direct) {
+        prev_.assign(prev_.size(), Key());
+    }
 }
 
 void Archiver::flush() {
-    for (store_t::iterator i = databases_.begin(); i != databases_.end(); ++i) {
-        i->second.second->flush();
+    if (asynchronous_) {
+        sync(true);
+        return;
+    }
+
+    for (auto& d : lru_) {
+        d.db->flush();
     }
 }
 
+void Archiver::sync(bool flush) {
 
-DB& Archiver::database(const Key &key) {
+    // Each worker flushes its own database, so these proceed concurrently. All of the workers
+    // are waited for, and the first error is reported.
 
-    store_t::iterator i = databases_.find(key);
+    std::vector<std::future<void>> syncs;
+    for (auto& d : lru_) {
+        ArchiveWorker* worker = d.worker.get();
+        syncs.emplace_back(std::async(std::launch::async, [worker, flush] { worker->sync(flush); }));
+    }
 
-    if (i != databases_.end() ) {
-        DB& db = *(i->second.second);
-        i->second.first = ::time(0);
-        return db;
+    std::exception_ptr error;
+    for (auto& s : syncs) {
+        try {
+            s.get();
+        }
+        catch (...) {
+            if (!error) error = std::current_exception();
+        }
+    }
+
+    if (error) {
+        std::rethrow_exception(error);
     }
+}
 
-    static size_t fdbMaxNbDBsOpen = eckit::Resource<size_t>("fdbMaxNbDBsOpen", 64);
 
-    if (databases_.size() >= fdbMaxNbDBsOpen) {
-        bool found = false;
-        time_t oldest = ::time(0) + 24 * 60 * 60;
-        Key oldK;
-        for (store_t::iterator i = databases_.begin(); i != databases_.end(); ++i) {
-            if (i->second.first <= oldest) {
-                found = true;
-                oldK = i->first;
-                oldest = i->second.first;
-            }
-        }
-        if (found) {
-            eckit::Log::info() << "Closing database " << *databases_[oldK].second << std::endl;
-            databases_.erase(oldK);
+FDBStats Archiver::stats() const {
+    return stats_;
+}
+
+
+DB& Archiver::database(const Key &key) {
+
+    // The open databases are kept in least-recently-used order, most recent first
+
+    auto i = databases_.find(key);
+
+    if (i != databases_.end()) {
+        lru_.splice(lru_.begin(), lru_, i->second);
+        currentWorker_ = lru_.front().worker.get();
+        stats_.addDatabaseHit();
+        return *lru_.front().db;
+    }
+
+    if (databases_.size() >= maxOpenDatabases_) {
+        ASSERT(!lru_.empty());
+        Database& oldest(lru_.back());
+        eckit::Log::info() << "Closing database " << *oldest.db << std::endl;
+        if (oldest.worker) {
+            oldest.worker->sync(false); // n.b. report any error before the worker is discarded
         }
+        databases_.erase(oldest.key);
+        lru_.pop_back();
+        stats_.addDatabaseEvict();
     }
 
     std::unique_ptr<DB> db = DB::buildWriter(key, dbConfig_);
@@ -101,9 +218,17 @@ DB& Archiver::database(const Key &key) {
         throw eckit::UserError(ss.str(), Here());
     }
 
-    DB& out = *db;
-    databases_[key] = std::make_pair(::time(0), std::move(db));
-    return out;
+    std::unique_ptr<ArchiveWorker> worker;
+    if (asynchronous_) {
+        worker.reset(new ArchiveWorker(*db, workerQueueLength_));
+    }
+
+    lru_.emplace_front(Database{key, std::move(db), std::move(worker)});
+    databases_[key] = lru_.begin();
+    stats_.addDatabaseOpen();
+
+    currentWorker_ = lru_.front().worker.get();
+    return *lru_.front().db;
 }
 
 void Archiver::print(std::ostream &out) const {
@@ -16,11 +16,14 @@
 #ifndef fdb5_Archiver_H
 #define fdb5_Archiver_H
 
-#include <time.h>
+#include <list>
+#include <memory>
+#include <unordered_map>
 #include <utility>
 
 #include "eckit/memory/NonCopyable.h"
 
+#include "fdb5/api/FDBStats.h"
 #include "fdb5/database/DB.h"
 #include "fdb5/config/Config.h"
 
@@ -33,6 +36,7 @@ class MarsTask;
 namespace fdb5 {
 
 class Key;
+class ArchiveWorker;
 class BaseArchiveVisitor;
 class Schema;
 
@@ -47,12 +51,20 @@ public: // methods
     virtual ~Archiver();
 
     void archive(const Key &key, BaseArchiveVisitor& visitor);
+
+    /// In asynchronous mode (fdbAsyncArchiver) the key is expanded on the calling thread, and a copy
+    /// of the data is written by a worker thread that owns the database. Errors are then reported
+    /// by a subsequent call to archive() or flush().
     void archive(const Key &key, const void* data, size_t len);
 
     /// Flushes all buffers and closes all data handles into a consistent DB state
     /// @note always safe to call
+    /// @note in asynchronous mode, this is a barrier. All the data archived has been written on return.
     void flush();
 
+    /// Statistics on the use of the open databases
+    FDBStats stats() const;
+
     friend std::ostream &operator<<(std::ostream &s, const Archiver &x) {
         x.print(s);
         return s;
@@ -64,15 +76,39 @@ private: // methods
 
     DB& database(const Key &key);
 
+    // Wait for all of the workers to write their queued data
+    void sync(bool flush);
+
 private: // members
 
     friend class BaseArchiveVisitor;
+    friend class AsyncArchiveVisitor;
+
+    // An open database, and in asynchronous mode the worker that writes to it. n.b. the worker is
+    // destroyed (and stopped) first.
+    struct Database {
+        Key key;
+        std::unique_ptr<DB> db;
+        std::unique_ptr<ArchiveWorker> worker;
+    };
 
-    typedef std::map< Key, std::pair<time_t, std::unique_ptr<DB> > > store_t;
+    typedef std::list<Database> lru_t;
 
     Config dbConfig_;
 
-    store_t databases_;
+    bool asynchronous_;
+    size_t workerQueueLength_;
+
+    // The open databases, most recently used first. Once maxOpenDatabases_ are open, the least
+    // recently used is closed to make room.
+    size_t maxOpenDatabases_;
+    lru_t lru_;
+    std::unordered_map<Key, lru_t::iterator, KeyHash> databases_;
+
+    FDBStats stats_;
+
+    ArchiveWorker* currentWorker_;
+    Key currentIndex_;
 
     std::vector<Key> prev_;
 
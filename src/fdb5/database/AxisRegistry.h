@@ -20,10 +20,12 @@
 #include <memory>
 #include <unordered_set>
 #include <functional>
+#include <vector>
 
-#include "eckit/container/DenseSet.h"
 #include "eckit/thread/Mutex.h"
 
+#include "fdb5/database/StringPool.h"
+
 namespace fdb5 {
 
 //----------------------------------------------------------------------------------------------------------------------
@@ -32,7 +34,8 @@ class AxisRegistry {
 public: // types
 
     typedef std::string keyword_t;
-    typedef eckit::DenseSet<std::string> axis_t;
+    /// The (interned) values of an axis, ordered by their strings
+    typedef std::vector<StringPool::id_t> axis_t;
     typedef std::shared_ptr<axis_t> ptr_axis_t;
 
     struct HashDenseSet
@@ -40,10 +43,10 @@ public: // types
         std::size_t operator()(ptr_axis_t const& p) const noexcept
         {
             std::size_t h = 0;
-            for(const auto& s: *p) {
+            for(const auto& id: *p) {
                 // this hash combine is inspired in the boost::hash_combine
                 // 0x9e3779b9 is the reciprocal of the golden ratio to ensure random bit distribution
-                h ^= std::hash<std::string>{}(s) + 0x9e3779b9 + (h << 6) + (h >> 2);
+                h ^= std::size_t(id) + 0x9e3779b9 + (h << 6) + (h >> 2);
             }
             return h;
         }
@@ -128,6 +128,7 @@ public:
     virtual void overlayDB(const Catalogue& otherCatalogue, const std::set<std::string>& variableKeys, bool unmount) = 0;
     virtual void index(const Key& key, const eckit::URI& uri, eckit::Offset offset, eckit::Length length) = 0;
     virtual void reconsolidate() = 0;
+    virtual size_t compact(size_t minimumIndexes) = 0;
 };
 
 //----------------------------------------------------------------------------------------------------------------------
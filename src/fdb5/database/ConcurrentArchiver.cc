@@ -0,0 +1,112 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#include <algorithm>
+
+#include "eckit/exception/Exceptions.h"
+#include "eckit/log/Log.h"
+
+#include "fdb5/LibFdb5.h"
+#include "fdb5/database/ConcurrentArchiver.h"
+
+namespace fdb5 {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+ConcurrentArchiver::ConcurrentArchiver(const Config& dbConfig, size_t queueLength) :
+    archiver_(dbConfig),
+    queue_(queueLength),
+    barriersRequested_(0),
+    barriersCompleted_(0),
+    thread_([this] { run(); }) {}
+
+ConcurrentArchiver::~ConcurrentArchiver() {
+
+    // n.b. the queue is drained before the thread exits, and the Archiver flushes on destruction
+
+    queue_.close();
+    thread_.join();
+}
+
+void ConcurrentArchiver::archive(const Key& key, const void* data, size_t length) {
+    push(Task{key, eckit::Buffer(static_cast<const char*>(data), length), 0});
+}
+
+void ConcurrentArchiver::archive(const Key& key, eckit::Buffer&& data) {
+    push(Task{key, std::move(data), 0});
+}
+
+void ConcurrentArchiver::flush() {
+
+    size_t barrier;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (error_) std::rethrow_exception(error_);
+        barrier = ++barriersRequested_;
+    }
+
+    push(Task{Key{}, eckit::Buffer{0}, barrier});
+
+    // The queue is FIFO, so every field queued before the barrier has been archived once it is reached
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    cv_.wait(lock, [this, barrier] { return barriersCompleted_ >= barrier || error_; });
+
+    if (error_) {
+        std::rethrow_exception(error_);
+    }
+}
+
+FDBStats ConcurrentArchiver::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+void ConcurrentArchiver::push(Task&& task) {
+    // n.b. once the archiving thread has failed, the queue rethrows its error to all the producers
+    queue_.emplace(std::move(task));
+}
+
+void ConcurrentArchiver::run() {
+
+    Task task{Key{}, eckit::Buffer{0}, 0};
+
+    try {
+        while (queue_.pop(task) != -1) {
+
+            if (task.barrier != 0) {
+                archiver_.flush();
+                std::lock_guard<std::mutex> lock(mutex_);
+                stats_ = archiver_.stats();
+                // n.b. concurrent flushes may queue their barriers out of order
+                barriersCompleted_ = std::max(barriersCompleted_, task.barrier);
+                cv_.notify_all();
+                continue;
+            }
+
+            archiver_.archive(task.key, task.data, task.data.size());
+        }
+    }
+    catch (...) {
+        eckit::Log::debug<LibFdb5>() << "Concurrent archiver failed" << std::endl;
+
+        // n.b. the queue is interrupted first, so that a caller that has seen the error cannot then queue more fields
+        queue_.interrupt(std::current_exception());
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            error_ = std::current_exception();
+            cv_.notify_all();
+        }
+    }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+} // namespace fdb5
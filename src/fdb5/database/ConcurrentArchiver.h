@@ -0,0 +1,94 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+/// @file   ConcurrentArchiver.h
+/// @date   Oct 2026
+
+#ifndef fdb5_ConcurrentArchiver_H
+#define fdb5_ConcurrentArchiver_H
+
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <thread>
+
+#include "eckit/container/Queue.h"
+#include "eckit/io/Buffer.h"
+#include "eckit/memory/NonCopyable.h"
+
+#include "fdb5/api/FDBStats.h"
+#include "fdb5/config/Config.h"
+#include "fdb5/database/Archiver.h"
+#include "fdb5/database/Key.h"
+
+namespace fdb5 {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/// A thread-safe front-end to an Archiver, so that many threads may archive into the same
+/// databases and data files. The fields are queued, and archived in order by a single thread
+/// that owns the Archiver (which may itself be asynchronous, with a writer per database).
+///
+/// Once a field has failed, the error is rethrown to every subsequent caller of archive() or flush().
+
+class ConcurrentArchiver : public eckit::NonCopyable {
+
+public: // methods
+
+    ConcurrentArchiver(const Config& dbConfig, size_t queueLength);
+
+    ~ConcurrentArchiver();
+
+    /// Queue a copy of the field
+    void archive(const Key& key, const void* data, size_t length);
+
+    /// Queue the field, taking ownership of the data
+    void archive(const Key& key, eckit::Buffer&& data);
+
+    /// On return, all of the fields queued before the call (by any thread) have been archived and flushed
+    void flush();
+
+    /// Statistics of the Archiver, as of the last flush
+    FDBStats stats() const;
+
+private: // types
+
+    struct Task {
+        Key key;
+        eckit::Buffer data;
+        size_t barrier;  // if non-zero, a flush() request
+    };
+
+private: // methods
+
+    void push(Task&& task);
+    void run();
+
+private: // members
+
+    Archiver archiver_;
+
+    eckit::Queue<Task> queue_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    size_t barriersRequested_;
+    size_t barriersCompleted_;
+    std::exception_ptr error_;
+    FDBStats stats_;
+
+    std::thread thread_;
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+
+} // namespace fdb5
+
+#endif
@@ -164,6 +164,13 @@ void DB::reconsolidate() {
     cat->reconsolidate();
 }
 
+size_t DB::compact(size_t minimumIndexes) {
+    CatalogueWriter* cat = dynamic_cast<CatalogueWriter*>(catalogue_.get());
+    ASSERT(cat);
+
+    return cat->compact(minimumIndexes);
+}
+
 void DB::index(const Key &key, const eckit::PathName &path, eckit::Offset offset, eckit::Length length) {
     if (catalogue_->type() == TocEngine::typeName()) {
         CatalogueWriter* cat = dynamic_cast<CatalogueWriter*>(catalogue_.get());
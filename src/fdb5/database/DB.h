@@ -72,6 +72,10 @@ public: // methods
     DbStats stats() const;
     void reconsolidate();
 
+    /// Merge the indexes of the DB that share an index key, where there are at least minimumIndexes
+    /// @returns the number of indexes replaced
+    size_t compact(size_t minimumIndexes = 2);
+
     // for ToC tools
     void hideContents();
     eckit::URI uri() const;
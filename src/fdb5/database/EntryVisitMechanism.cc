@@ -10,6 +10,7 @@
 
 #include "fdb5/database/EntryVisitMechanism.h"
 
+#include "eckit/config/Resource.h"
 #include "eckit/io/AutoCloser.h"
 
 #include "fdb5/api/helpers/FDBToolRequest.h"
@@ -31,13 +32,18 @@ public:
 
 //----------------------------------------------------------------------------------------------------------------------
 
-EntryVisitor::EntryVisitor() : currentCatalogue_(nullptr), currentIndex_(nullptr) {}
+EntryVisitor::EntryVisitor() :
+    currentCatalogue_(nullptr),
+    currentStore_(nullptr),
+    currentIndex_(nullptr),
+    currentRule_(nullptr) {}
 
 EntryVisitor::~EntryVisitor() {}
 
 bool EntryVisitor::visitDatabase(const Catalogue& catalogue, const Store& store) {
     currentCatalogue_ = &catalogue;
     currentStore_ = &store;
+    currentRule_ = nullptr;
     return true;
 }
 
@@ -48,10 +54,12 @@ void EntryVisitor::catalogueComplete(const Catalogue& catalogue) {
     currentCatalogue_ = nullptr;
     currentStore_ = nullptr;
     currentIndex_ = nullptr;
+    currentRule_ = nullptr;
 }
 
 bool EntryVisitor::visitIndex(const Index& index) {
     currentIndex_ = &index;
+    currentRule_ = nullptr;
     return true;
 }
 
@@ -59,7 +67,14 @@ void EntryVisitor::visitDatum(const Field& field, const std::string& keyFingerpr
     ASSERT(currentCatalogue_);
     ASSERT(currentIndex_);
 
-    Key key(keyFingerprint, currentCatalogue_->schema().ruleFor(currentCatalogue_->key(), currentIndex_->key()));
+    // The rule depends only on the catalogue and index, so is looked up once per index rather
+    // than for every entry
+
+    if (!currentRule_) {
+        currentRule_ = currentCatalogue_->schema().ruleFor(currentCatalogue_->key(), currentIndex_->key());
+    }
+
+    Key key(keyFingerprint, currentRule_);
     visitDatum(field, key);
 }
 
@@ -72,13 +87,11 @@ time_t EntryVisitor::indexTimestamp() const {
 
 EntryVisitMechanism::EntryVisitMechanism(const Config& config) :
     dbConfig_(config),
+    threads_(config.getInt("visitThreads", eckit::Resource<size_t>("fdbVisitThreads;$FDB_VISIT_THREADS", 1))),
+    ordered_(config.getBool("visitOrdered", eckit::Resource<bool>("fdbVisitOrdered;$FDB_VISIT_ORDERED", true))),
     fail_(true) {}
 
-void EntryVisitMechanism::visit(const FDBToolRequest& request, EntryVisitor& visitor) {
-
-    if (visitor.visitEntries() && !visitor.visitIndexes()) {
-        throw FDBVisitException("Cannot visit entries without visiting indexes", Here());
-    }
+std::vector<URI> EntryVisitMechanism::locations(const FDBToolRequest& request) const {
 
     // A request against all is the same as using an empty key in visitableLocations.
 
@@ -88,30 +101,47 @@ void EntryVisitMechanism::visit(const FDBToolRequest& request, EntryVisitor& vis
 
     Log::debug<LibFdb5>() << "REQUEST ====> " << request.request() << std::endl;
 
-    try {
+    // n.b. it is not an error if nothing is found (especially in a sub-fdb).
+
+    return Manager(dbConfig_).visitableLocations(request.request(), request.all());
+}
 
-        std::vector<URI> uris(Manager(dbConfig_).visitableLocations(request.request(), request.all()));
+void EntryVisitMechanism::visitDatabase(const URI& uri, EntryVisitor& visitor) const {
 
-        // n.b. it is not an error if nothing is found (especially in a sub-fdb).
+    PathName path(uri.path());
+    if (path.exists()) {
+        if (!path.isDir())
+            path = path.dirName();
+        path = path.realName();
 
-        // And do the visitation
+        Log::debug<LibFdb5>() << "FDB processing Path " << path << std::endl;
+
+        std::unique_ptr<DB> db = DB::buildReader(eckit::URI(uri.scheme(), path), dbConfig_);
+        ASSERT(db->open());
+        eckit::AutoCloser<DB> closer(*db);
+
+        db->visitEntries(visitor, false);
+    }
+}
+
+void EntryVisitMechanism::validate(EntryVisitor& visitor) {
+    if (visitor.visitEntries() && !visitor.visitIndexes()) {
+        throw FDBVisitException("Cannot visit entries without visiting indexes", Here());
+    }
+}
 
-        for (URI uri : uris) {
+void EntryVisitMechanism::visit(const FDBToolRequest& request, EntryVisitor& visitor) {
 
-            PathName path(uri.path());
-            if (path.exists()) {
-                if (!path.isDir())
-                    path = path.dirName();
-                path = path.realName();
+    validate(visitor);
 
-                Log::debug<LibFdb5>() << "FDB processing Path " << path << std::endl;
+    try {
 
-                std::unique_ptr<DB> db = DB::buildReader(eckit::URI(uri.scheme(), path), dbConfig_);
-                ASSERT(db->open());
-                eckit::AutoCloser<DB> closer(*db);
+        std::vector<URI> uris(locations(request));
 
-                db->visitEntries(visitor, false);
-            }
+        // And do the visitation
+
+        for (const URI& uri : uris) {
+            visitDatabase(uri, visitor);
         }
 
     } catch (eckit::UserError&) {
@@ -120,11 +150,6 @@ void EntryVisitMechanism::visit(const FDBToolRequest& request, EntryVisitor& vis
         Log::warning() << e.what() << std::endl;
         if (fail_) throw;
     }
-
-
-
-
-
 }
 
 //----------------------------------------------------------------------------------------------------------------------
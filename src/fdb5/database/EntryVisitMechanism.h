@@ -14,6 +14,17 @@
 #ifndef fdb5_EntryVisitMechanism_H
 #define fdb5_EntryVisitMechanism_H
 
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "eckit/container/Queue.h"
+#include "eckit/filesystem/URI.h"
 #include "eckit/memory/NonCopyable.h"
 
 #include "fdb5/config/Config.h"
@@ -26,6 +37,7 @@ class Store;
 class FDBToolRequest;
 class Index;
 class Key;
+class Rule;
 
 //----------------------------------------------------------------------------------------------------------------------
 
@@ -40,9 +52,17 @@ public:  // methods
     virtual bool visitIndexes() { return true; }
     virtual bool visitEntries() { return true; }
 
+    /// Visitors which return true may be instantiated once per database, with the instances
+    /// visiting different databases concurrently. They must keep no state between databases.
+    virtual bool concurrentDatabases() { return false; }
+
     virtual bool visitDatabase(const Catalogue& catalogue, const Store& store);    // return true if Catalogue should be explored
     virtual bool visitIndex(const Index& index); // return true if index should be explored
     virtual void catalogueComplete(const Catalogue& catalogue);
+
+    /// Called for each entry, with the fingerprint of its key as stored in the index. By default
+    /// the Key is decoded, and passed on. Visitors which don't need the key (e.g. those only
+    /// interested in the location of the data) should override this, and avoid decoding it.
     virtual void visitDatum(const Field& field, const std::string& keyFingerprint);
 
     time_t indexTimestamp() const;
@@ -57,6 +77,11 @@ protected:  // members
     const Catalogue* currentCatalogue_;
     const Store* currentStore_;
     const Index* currentIndex_;
+
+private: // members
+
+    // The rule used to decode the keys of the current index, resolved on first use
+    const Rule* currentRule_;
 };
 
 //----------------------------------------------------------------------------------------------------------------------
@@ -69,14 +94,135 @@ public:  // methods
 
     void visit(const FDBToolRequest& request, EntryVisitor& visitor);
 
+    /// Visit the databases concurrently, with a new visitor for each database, if so configured
+    /// (fdbVisitThreads). Unless fdbVisitOrdered is disabled, the output is the same as that of a
+    /// sequential visit. Otherwise it is returned as it becomes available.
+    template <typename ValueType>
+    void visit(const FDBToolRequest& request,
+               eckit::Queue<ValueType>& queue,
+               std::function<EntryVisitor*(eckit::Queue<ValueType>&)> makeVisitor);
+
+    size_t threads() const { return threads_; }
+
+private:  // methods
+
+    static void validate(EntryVisitor& visitor);
+
+    std::vector<eckit::URI> locations(const FDBToolRequest& request) const;
+    void visitDatabase(const eckit::URI& uri, EntryVisitor& visitor) const;
+
+    template <typename ValueType>
+    void visitConcurrently(const std::vector<eckit::URI>& uris,
+                           eckit::Queue<ValueType>& queue,
+                           std::function<EntryVisitor*(eckit::Queue<ValueType>&)> makeVisitor);
+
 private:  // members
 
     const Config& dbConfig_;
 
+    size_t threads_;
+    bool ordered_;
+
     // Fail on error
     bool fail_;
 };
 
+template <typename ValueType>
+void EntryVisitMechanism::visit(const FDBToolRequest& request,
+                                eckit::Queue<ValueType>& queue,
+                                std::function<EntryVisitor*(eckit::Queue<ValueType>&)> makeVisitor) {
+
+    std::unique_ptr<EntryVisitor> visitor(makeVisitor(queue));
+
+    if (threads_ <= 1 || !visitor->concurrentDatabases()) {
+        visit(request, *visitor);
+        return;
+    }
+
+    validate(*visitor);
+    visitor.reset();
+
+    std::vector<eckit::URI> uris(locations(request));
+    visitConcurrently(uris, queue, makeVisitor);
+}
+
+template <typename ValueType>
+void EntryVisitMechanism::visitConcurrently(const std::vector<eckit::URI>& uris,
+                                            eckit::Queue<ValueType>& queue,
+                                            std::function<EntryVisitor*(eckit::Queue<ValueType>&)> makeVisitor) {
+
+    // To preserve the order of the output, each database is visited into its own (bounded) queue,
+    // and these are drained in turn. The databases are started in order, so the one being drained
+    // is always either running or complete.
+
+    std::vector<std::unique_ptr<eckit::Queue<ValueType>>> outputs;
+    if (ordered_) {
+        for (size_t i = 0; i < uris.size(); ++i) {
+            outputs.emplace_back(new eckit::Queue<ValueType>(100));
+        }
+    }
+
+    std::atomic<size_t> next(0);
+    std::atomic<bool> stop(false);
+
+    std::mutex errorMutex;
+    std::exception_ptr error;
+
+    auto worker = [&]() {
+        size_t i;
+        while (!stop && (i = next++) < uris.size()) {
+            eckit::Queue<ValueType>& output(ordered_ ? *outputs[i] : queue);
+            try {
+                {
+                    // n.b. visitors may still emit output when destroyed
+                    std::unique_ptr<EntryVisitor> visitor(makeVisitor(output));
+                    visitDatabase(uris[i], *visitor);
+                }
+                if (ordered_) output.close();
+            } catch (...) {
+                if (ordered_) {
+                    output.interrupt(std::current_exception());
+                } else {
+                    std::lock_guard<std::mutex> lock(errorMutex);
+                    if (!error) error = std::current_exception();
+                    stop = true;
+                }
+            }
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (size_t i = 0; i < std::min(threads_, uris.size()); ++i) {
+        workers.emplace_back(worker);
+    }
+
+    if (ordered_) {
+        try {
+            ValueType elem;
+            for (auto& output : outputs) {
+                while (output->pop(elem) != -1) {
+                    queue.emplace(std::move(elem));
+                }
+            }
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(errorMutex);
+            error = std::current_exception();
+            stop = true;
+            for (auto& output : outputs) {
+                output->interrupt(error);
+            }
+        }
+    }
+
+    for (std::thread& w : workers) {
+        w.join();
+    }
+
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
 //----------------------------------------------------------------------------------------------------------------------
 
 }  // namespace fdb5
@@ -8,6 +8,8 @@
  * does it submit to any jurisdiction.
  */
 
+#include <algorithm>
+#include <iterator>
 
 #include "eckit/log/Log.h"
 #include "eckit/exception/Exceptions.h"
@@ -54,15 +56,17 @@ void IndexAxis::encode(eckit::Stream &s, const int version) const {
 void IndexAxis::encodeCurrent(eckit::Stream &s, const int version) const {
     ASSERT(version >= 3);
 
+    const StringPool& pool(StringPool::instance());
+
     s.startObject();
     s << "size" << axis_.size();
     s << "axes";
     for (AxisMap::const_iterator i = axis_.begin(); i != axis_.end(); ++i) {
         s << (*i).first;
-        const eckit::DenseSet<std::string> &values = *(*i).second;
+        const AxisRegistry::axis_t &values = *(*i).second;
         s << values.size();
-        for (eckit::DenseSet<std::string>::const_iterator j = values.begin(); j != values.end(); ++j) {
-            s << (*j);
+        for (AxisRegistry::axis_t::const_iterator j = values.begin(); j != values.end(); ++j) {
+            s << pool.get(*j);
         }
     }
     s.endObject();
@@ -71,13 +75,15 @@ void IndexAxis::encodeCurrent(eckit::Stream &s, const int version) const {
 void IndexAxis::encodeLegacy(eckit::Stream &s, const int version) const {
     ASSERT(version <= 2);
 
+    const StringPool& pool(StringPool::instance());
+
     s << axis_.size();
     for (AxisMap::const_iterator i = axis_.begin(); i != axis_.end(); ++i) {
         s << (*i).first;
-        const eckit::DenseSet<std::string> &values = *(*i).second;
+        const AxisRegistry::axis_t &values = *(*i).second;
         s << values.size();
-        for (eckit::DenseSet<std::string>::const_iterator j = values.begin(); j != values.end(); ++j) {
-            s << (*j);
+        for (AxisRegistry::axis_t::const_iterator j = values.begin(); j != values.end(); ++j) {
+            s << pool.get(*j);
         }
     }
 }
@@ -90,6 +96,40 @@ void IndexAxis::decode(eckit::Stream &s, const int version) {
         decodeLegacy(s, version);
 }
 
+namespace {
+
+// Orders the ids of interned strings by their values
+
+struct ValueLess {
+    const StringPool& pool_;
+    ValueLess() : pool_(StringPool::instance()) {}
+    bool operator()(StringPool::id_t lhs, StringPool::id_t rhs) const { return pool_.get(lhs) < pool_.get(rhs); }
+    bool operator()(StringPool::id_t lhs, const std::string& rhs) const { return pool_.get(lhs) < rhs; }
+    bool operator()(const std::string& lhs, StringPool::id_t rhs) const { return lhs < pool_.get(rhs); }
+};
+
+AxisRegistry::axis_t* decodeValues(eckit::Stream& s, size_t n) {
+
+    StringPool& pool(StringPool::instance());
+
+    std::unique_ptr<AxisRegistry::axis_t> values(new AxisRegistry::axis_t);
+    values->reserve(n);
+
+    std::string v;
+    for (size_t j = 0; j < n; j++) {
+        s >> v;
+        values->push_back(pool.intern(v));
+    }
+
+    std::sort(values->begin(), values->end(), ValueLess());
+    values->erase(std::unique(values->begin(), values->end()), values->end());
+    values->shrink_to_fit();
+
+    return values.release();
+}
+
+}
+
 enum IndexAxisStreamKeys {
     IndexAxisKeyUnrecognised,
     IndexAxisSize,
@@ -116,7 +156,6 @@ void IndexAxis::decodeCurrent(eckit::Stream &s, const int version) {
     ASSERT(axis_.empty());
 
     std::string k;
-    std::string v;
     size_t n = 0;
     while (!s.endObjectFound()) {
         s >> k;
@@ -128,15 +167,10 @@ void IndexAxis::decodeCurrent(eckit::Stream &s, const int version) {
                 ASSERT(n);
                 for (size_t i = 0; i < n; i++) {
                     s >> k;
-                    std::shared_ptr<eckit::DenseSet<std::string> >& values = axis_[k];
-                    values.reset(new eckit::DenseSet<std::string>);
+                    std::shared_ptr<AxisRegistry::axis_t>& values = axis_[k];
                     size_t m;
                     s >> m;
-                    for (size_t j = 0; j < m; j++) {
-                        s >> v;
-                        values->insert(v);
-                    }
-                    values->sort();
+                    values.reset(decodeValues(s, m));
                     AxisRegistry::instance().deduplicate(k, values);
                 }
                 break;
@@ -154,19 +188,13 @@ void IndexAxis::decodeLegacy(eckit::Stream& s, const int version) {
     s >> n;
 
     std::string k;
-    std::string v;
 
     for (size_t i = 0; i < n; i++) {
         s >> k;
-        std::shared_ptr<eckit::DenseSet<std::string> >& values = axis_[k];
-        values.reset(new eckit::DenseSet<std::string>);
+        std::shared_ptr<AxisRegistry::axis_t>& values = axis_[k];
         size_t m;
         s >> m;
-        for (size_t j = 0; j < m; j++) {
-            s >> v;
-            values->insert(v);
-        }
-        values->sort();
+        values.reset(decodeValues(s, m));
         AxisRegistry::instance().deduplicate(k, values);
     }
 }
@@ -175,14 +203,15 @@ void IndexAxis::dump(std::ostream &out, const char* indent) const {
     out << indent << "Axes:" << std::endl;
    for (AxisMap::const_iterator i = axis_.begin(); i != axis_.end(); ++i) {
         out << indent << indent << (*i).first << std::endl;
-        const eckit::DenseSet<std::string> &values = *(*i).second;
-        for (eckit::DenseSet<std::string>::const_iterator j = values.begin(); j != values.end(); ++j) {
+        const AxisRegistry::axis_t &values = *(*i).second;
+        for (AxisRegistry::axis_t::const_iterator j = values.begin(); j != values.end(); ++j) {
+            const std::string& value(StringPool::instance().get(*j));
             out << indent << indent << indent;
-            if ((*j).empty()) {
+            if (value.empty()) {
                 out << "<empty>";
             }
             else {
-                out << (*j);
+                out << value;
             }
             out  << std::endl;
         }
@@ -190,10 +219,21 @@ void IndexAxis::dump(std::ostream &out, const char* indent) const {
    // out << std::endl;
 }
 
+bool IndexAxis::contains(const AxisRegistry::axis_t& axis, const std::string& value) {
+    return std::binary_search(axis.begin(), axis.end(), value, ValueLess());
+}
+
 bool IndexAxis::contains(const Key &key) const {
 
     for (AxisMap::const_iterator i = axis_.begin(); i != axis_.end(); ++i) {
-        if (!key.match(i->first, *(i->second))) {
+
+        Key::const_iterator k = key.find(i->first);
+        if (k == key.end()) {
+            return false;
+        }
+
+        // by default we use the exact request value. In case of mismatch, we try to canonicalise it
+        if (!contains(*(i->second), k->second) && !contains(*(i->second), key.canonicalValue(i->first))) {
             return false;
         }
     }
@@ -206,11 +246,38 @@ void IndexAxis::insert(const Key &key) {
     for (Key::const_iterator i = key.begin(); i  != key.end(); ++i) {
         const std::string &keyword = i->first;
 
-        std::shared_ptr<eckit::DenseSet<std::string> >& axis_set = axis_[keyword];
-        if (!axis_set)
-            axis_set.reset(new eckit::DenseSet<std::string>);
+        std::shared_ptr<AxisRegistry::axis_t>& axis = axis_[keyword];
+        if (!axis)
+            axis.reset(new AxisRegistry::axis_t);
+
+        // Keep the values sorted. New values are rare, compared to the number of fields.
 
-        axis_set->insert(key.canonicalValue(keyword));
+        std::string value = key.canonicalValue(keyword);
+        AxisRegistry::axis_t::iterator pos = std::lower_bound(axis->begin(), axis->end(), value, ValueLess());
+        if (pos == axis->end() || StringPool::instance().get(*pos) != value) {
+            axis->insert(pos, StringPool::instance().intern(value));
+        }
+
+        dirty_ = true;
+    }
+}
+
+void IndexAxis::merge(const IndexAxis& other) {
+    ASSERT(!readOnly_);
+
+    for (AxisMap::const_iterator i = other.axis_.begin(); i != other.axis_.end(); ++i) {
+
+        std::shared_ptr<AxisRegistry::axis_t>& axis = axis_[i->first];
+        if (!axis)
+            axis.reset(new AxisRegistry::axis_t);
+
+        // Both axes are sorted, and each value is interned only once
+
+        AxisRegistry::axis_t merged;
+        merged.reserve(axis->size() + i->second->size());
+        std::set_union(axis->begin(), axis->end(), i->second->begin(), i->second->end(),
+                       std::back_inserter(merged), ValueLess());
+        axis->swap(merged);
 
         dirty_ = true;
     }
@@ -227,8 +294,6 @@ void IndexAxis::clean() {
 }
 
 void IndexAxis::sort() {
-    for (AxisMap::iterator i = axis_.begin(); i != axis_.end(); ++i)
-       i->second->sort();
 }
 
 void IndexAxis::wipe() {
@@ -240,29 +305,43 @@ void IndexAxis::wipe() {
 }
 
 
-const eckit::DenseSet<std::string> &IndexAxis::values(const std::string &keyword) const {
+void IndexAxis::values(const std::string &keyword, eckit::StringSet& s) const {
 
     // If an Index is empty, this is bad, but is not strictly an error. Nothing will
     // be found...
 
     if (axis_.empty()) {
         eckit::Log::warning() << "Querying axis of empty Index: " << keyword << std::endl;
-        const static eckit::DenseSet<std::string> nullStringSet;
-        return nullStringSet;
+        return;
     }
 
     AxisMap::const_iterator i = axis_.find(keyword);
     if (i == axis_.end()) {
         throw eckit::SeriousBug("Cannot find Axis: " + keyword);
     }
-    return *(i->second);
+
+    const StringPool& pool(StringPool::instance());
+    for (AxisRegistry::axis_t::const_iterator j = i->second->begin(); j != i->second->end(); ++j) {
+        s.insert(pool.get(*j));
+    }
 }
 
 void IndexAxis::print(std::ostream &out) const {
+    const StringPool& pool(StringPool::instance());
     out << "IndexAxis["
-        <<  "axis=";
-    eckit::__print_container(out, axis_);
-    out  << "]";
+        <<  "axis={";
+    const char* sep = "";
+    for (AxisMap::const_iterator i = axis_.begin(); i != axis_.end(); ++i) {
+        out << sep << i->first << "=[";
+        const char* vsep = "";
+        for (AxisRegistry::axis_t::const_iterator j = i->second->begin(); j != i->second->end(); ++j) {
+            out << vsep << pool.get(*j);
+            vsep = ",";
+        }
+        out << "]";
+        sep = ",";
+    }
+    out  << "}]";
 }
 
 //----------------------------------------------------------------------------------------------------------------------
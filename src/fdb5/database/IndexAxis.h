@@ -20,11 +20,12 @@
 #include <map>
 #include <memory>
 
-#include "eckit/container/DenseSet.h"
 #include "eckit/memory/NonCopyable.h"
 #include "eckit/filesystem/PathName.h"
 #include "eckit/types/Types.h"
 
+#include "fdb5/database/AxisRegistry.h"
+
 namespace eckit {
 class Stream;
 }
@@ -45,12 +46,16 @@ public: // methods
     ~IndexAxis();
 
     void insert(const Key &key);
+
+    /// Add all the values of another axis object
+    void merge(const IndexAxis& other);
     void encode(eckit::Stream &s, const int version) const;
 
     // Decode can be used for two-stage initialisation (IndexAxis a; a.decode(s);)
     void decode(eckit::Stream& s, const int version);
 
-    const eckit::DenseSet<std::string> &values(const std::string &keyword) const;
+    /// Add the values of an axis to s
+    void values(const std::string &keyword, eckit::StringSet& s) const;
 
     void dump(std::ostream &out, const char* indent) const;
 
@@ -61,7 +66,7 @@ public: // methods
     bool dirty() const;
     void clean();
 
-    /// Sort the internal axes
+    /// Sort the internal axes. n.b. they are kept sorted, so this is a no-op.
     void sort();
 
     /// Reset the axis to a default state.
@@ -82,10 +87,13 @@ private: // methods
 
     void print(std::ostream &out) const;
 
+    static bool contains(const AxisRegistry::axis_t& axis, const std::string& value);
 
 private: // members
 
-    typedef std::map<std::string, std::shared_ptr<eckit::DenseSet<std::string> > > AxisMap;
+    // The values are interned in the StringPool, and identical axes are shared between indexes
+    // (see AxisRegistry)
+    typedef std::map<std::string, std::shared_ptr<AxisRegistry::axis_t> > AxisMap;
     AxisMap axis_;
 
     bool readOnly_;
@@ -87,13 +87,29 @@ Key::Key(eckit::Stream& s) :
     decode(s);
 }
 
+Key::Key(const Key& other) :
+    keys_(other.keys_),
+    names_(other.names_),
+    rule_(other.rule_),
+    fingerprint_(std::atomic_load(&other.fingerprint_)) {}
+
+Key& Key::operator=(const Key& other) {
+    if (this != &other) {
+        keys_ = other.keys_;
+        names_ = other.names_;
+        rule_ = other.rule_;
+        fingerprint_ = std::atomic_load(&other.fingerprint_);
+    }
+    return *this;
+}
+
 void Key::decode(eckit::Stream& s) {
 
     ASSERT(rule_ == nullptr);
 
     keys_.clear();
     names_.clear();
-
+    modified();
 
     size_t n;
 
@@ -145,7 +161,10 @@ std::set<std::string> Key::keys() const {
 
 
 void Key::rule(const Rule *rule) {
-    rule_ = rule;
+    if (rule != rule_) {
+        rule_ = rule;
+        modified();
+    }
 }
 
 const Rule *Key::rule() const {
@@ -155,6 +174,7 @@ const Rule *Key::rule() const {
 void Key::clear() {
     keys_.clear();
     names_.clear();
+    modified();
 }
 
 void Key::set(const std::string &k, const std::string &v) {
@@ -167,21 +187,26 @@ void Key::set(const std::string &k, const std::string &v) {
         it->second = v;
     }
 
+    modified();
 }
 
 void Key::unset(const std::string &k) {
     keys_.erase(k);
+    names_.erase(std::remove(names_.begin(), names_.end(), k), names_.end());
+    modified();
 }
 
 void Key::push(const std::string &k, const std::string &v) {
     keys_[k] = v;
     names_.push_back(k);
+    modified();
 }
 
 void Key::pop(const std::string &k) {
     keys_.erase(k);
     ASSERT(names_.back() == k);
     names_.pop_back();
+    modified();
 }
 
 const std::string &Key::get( const std::string &k ) const {
@@ -316,24 +341,53 @@ std::string Key::canonicalValue(const std::string& keyword) const {
     return canonicalise(keyword, it->second);
 }
 
-std::string Key::valuesToString() const {
+std::shared_ptr<const Key::Fingerprint> Key::fingerprint() const {
+
+    std::shared_ptr<const Fingerprint> fp = std::atomic_load(&fingerprint_);
+    if (fp) {
+        return fp;
+    }
 
     ASSERT(names_.size() == keys_.size());
 
-    std::ostringstream oss;
-    const char *sep = "";
+    std::shared_ptr<Fingerprint> result = std::make_shared<Fingerprint>();
+    std::string& values(result->values);
 
     for (eckit::StringList::const_iterator j = names_.begin(); j != names_.end(); ++j) {
         eckit::StringDict::const_iterator i = keys_.find(*j);
         ASSERT(i != keys_.end());
 
-        oss << sep;
-        oss << canonicalise(*j, i->second);
-
-        sep = ":";
+        if (j != names_.begin()) {
+            values += ':';
+        }
+        values += canonicalise(*j, i->second);
     }
 
-    return oss.str();
+    result->hash = std::hash<std::string>()(values);
+
+    // If several threads compute the fingerprint concurrently, they are identical
+    fp = result;
+    std::atomic_store(&fingerprint_, fp);
+    return fp;
+}
+
+const std::string& Key::valuesToString() const {
+    // n.b. the fingerprint is kept alive by the key until it is next modified
+    return fingerprint()->values;
+}
+
+size_t Key::hash() const {
+    return fingerprint()->hash;
+}
+
+size_t KeyHash::operator()(const Key& key) const {
+    std::hash<std::string> hasher;
+    size_t h = 0;
+    for (Key::const_iterator i = key.begin(); i != key.end(); ++i) {
+        h ^= hasher(i->first) + 0x9e3779b9 + (h << 6) + (h >> 2);
+        h ^= hasher(i->second) + 0x9e3779b9 + (h << 6) + (h >> 2);
+    }
+    return h;
 }
 
 
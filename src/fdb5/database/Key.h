@@ -17,6 +17,7 @@
 #define fdb5_Key_H
 
 #include <map>
+#include <memory>
 #include <string>
 #include <vector>
 #include <set>
@@ -53,6 +54,12 @@ public: // methods
 
     explicit Key(const eckit::StringDict &keys);
 
+    Key(const Key& other);
+    Key& operator=(const Key& other);
+
+    Key(Key&& other) = default;
+    Key& operator=(Key&& other) = default;
+
     std::set<std::string> keys() const;
 
     void set(const std::string &k, const std::string &v);
@@ -108,7 +115,11 @@ public: // methods
     const Rule *rule() const;
     const TypesRegistry& registry() const;
 
-    std::string valuesToString() const;
+    /// The canonical values, separated by ':'. This is cached until the key is next modified.
+    const std::string& valuesToString() const;
+
+    /// A hash of valuesToString(), similarly cached
+    size_t hash() const;
 
     const eckit::StringList& names() const;
 
@@ -152,11 +163,33 @@ private: // members
 
     std::string toString() const;
 
+    // The fingerprint is immutable once computed, and shared by copies of the key. It is
+    // accessed atomically, so that const keys may be used concurrently.
+
+    struct Fingerprint {
+        std::string values;
+        size_t hash;
+    };
+
+    std::shared_ptr<const Fingerprint> fingerprint() const;
+    void modified() { fingerprint_.reset(); }
+
     eckit::StringDict keys_;
     eckit::StringList names_;
 
     const Rule *rule_;
 
+    mutable std::shared_ptr<const Fingerprint> fingerprint_;
+
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/// Hashes the keywords and (raw) values, consistently with Key::operator==. n.b. std::hash<Key>
+/// hashes the canonical values, and so must not be used for containers keyed on Key::operator==.
+
+struct KeyHash {
+    size_t operator()(const Key& key) const;
 };
 
 //----------------------------------------------------------------------------------------------------------------------
@@ -167,7 +200,7 @@ namespace std {
     template <>
     struct hash<fdb5::Key> {
         size_t operator() (const fdb5::Key& key) const {
-            return std::hash<std::string>()(key.valuesToString());
+            return key.hash();
         }
     };
 }
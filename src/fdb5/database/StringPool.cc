@@ -0,0 +1,71 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#include "eckit/exception/Exceptions.h"
+#include "eckit/thread/AutoLock.h"
+
+#include "fdb5/database/StringPool.h"
+
+namespace fdb5 {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+StringPool& StringPool::instance() {
+    static StringPool pool;
+    return pool;
+}
+
+StringPool::StringPool() :
+    size_(0) {
+    for (size_t i = 0; i < maxChunks; ++i) {
+        chunks_[i].store(nullptr, std::memory_order_relaxed);
+    }
+}
+
+StringPool::~StringPool() {
+    for (size_t i = 0; i < maxChunks; ++i) {
+        delete[] chunks_[i].load(std::memory_order_relaxed);
+    }
+}
+
+StringPool::id_t StringPool::intern(const std::string& s) {
+
+    eckit::AutoLock<eckit::Mutex> lock(mutex_);
+
+    auto it = ids_.find(s);
+    if (it != ids_.end()) {
+        return it->second;
+    }
+
+    ASSERT(size_ < chunkSize * maxChunks);
+
+    id_t id = size_++;
+
+    std::string* chunk = chunks_[id >> chunkBits].load(std::memory_order_relaxed);
+    if (!chunk) {
+        chunk = new std::string[chunkSize];
+    }
+    chunk[id & (chunkSize - 1)] = s;
+
+    // Publish the (new) chunk, and the string in it
+    chunks_[id >> chunkBits].store(chunk, std::memory_order_release);
+
+    ids_.emplace(s, id);
+    return id;
+}
+
+size_t StringPool::size() const {
+    eckit::AutoLock<eckit::Mutex> lock(mutex_);
+    return size_;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+} // namespace fdb5
@@ -0,0 +1,77 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+/// @file   StringPool.h
+/// @date   Oct 2026
+
+#ifndef fdb5_StringPool_H
+#define fdb5_StringPool_H
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+
+#include "eckit/memory/NonCopyable.h"
+#include "eckit/thread/Mutex.h"
+
+namespace fdb5 {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/// A process-wide pool of interned strings (the values of the index axes), each identified by a
+/// compact id. Strings are never removed, as the vocabulary of axis values is small compared to
+/// the number of axes that refer to it.
+///
+/// Interning is serialised, but the strings may be looked up by id concurrently, without locking.
+
+class StringPool : private eckit::NonCopyable {
+
+public: // types
+
+    typedef uint32_t id_t;
+
+public: // methods
+
+    static StringPool& instance();
+
+    id_t intern(const std::string& s);
+
+    const std::string& get(id_t id) const {
+        return chunks_[id >> chunkBits].load(std::memory_order_acquire)[id & (chunkSize - 1)];
+    }
+
+    size_t size() const;
+
+private: // methods
+
+    StringPool();
+    ~StringPool();
+
+private: // members
+
+    static const size_t chunkBits = 12;
+    static const size_t chunkSize = size_t(1) << chunkBits;
+    static const size_t maxChunks = size_t(1) << 16;
+
+    // Chunks are never reallocated, so references to the strings remain valid
+    std::atomic<std::string*> chunks_[maxChunks];
+
+    std::unordered_map<std::string, id_t> ids_;
+    size_t size_;
+
+    mutable eckit::Mutex mutex_;
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+
+} // namespace fdb5
+
+#endif // fdb5_StringPool_H
@@ -0,0 +1,387 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+
+#include "eckit/config/Resource.h"
+#include "eckit/eckit.h"
+#include "eckit/exception/Exceptions.h"
+#include "eckit/io/FDataSync.h"
+#include "eckit/log/Bytes.h"
+#include "eckit/log/Log.h"
+#include "eckit/log/Timer.h"
+
+#include "fdb5/LibFdb5.h"
+#include "fdb5/io/DirectFileHandle.h"
+#include "fdb5/io/RootStatistics.h"
+
+using namespace eckit;
+
+namespace fdb5 {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+namespace {
+
+const size_t noBlock = size_t(-1);
+
+}
+
+void DirectFileHandle::print(std::ostream& s) const {
+    s << "DirectFileHandle[file=" << path_ << ']';
+}
+
+DirectFileHandle::DirectFileHandle(const std::string& name, size_t nbBuffers, size_t bufferSize,
+                                   const std::string& root) :
+    path_(name),
+    alignment_(eckit::Resource<size_t>("fdbDirectIOAlignment;$FDB_DIRECT_IO_ALIGNMENT", 4096)),
+    bufferSize_(bufferSize),
+    fd_(-1),
+    direct_(false),
+    pos_(0),
+    flushed_(0),
+    next_(0),
+    current_(noBlock),
+    stopping_(false),
+    root_(root) {
+
+    ASSERT(alignment_ > 0 && (alignment_ & (alignment_ - 1)) == 0);
+    ASSERT(nbBuffers > 0);
+
+    // The buffers are whole multiples of the alignment, so every block starts aligned
+
+    bufferSize_ = std::max(alignment_, ((bufferSize_ + alignment_ - 1) / alignment_) * alignment_);
+
+    for (size_t i = 0; i < nbBuffers; ++i) {
+        void* data = nullptr;
+        int err = ::posix_memalign(&data, alignment_, bufferSize_);
+        if (err != 0) {
+            for (Block& b : blocks_) {
+                ::free(b.data);
+            }
+            throw eckit::FailedSystemCall("posix_memalign", Here());
+        }
+        blocks_.push_back(Block{static_cast<char*>(data), 0, 0});
+    }
+}
+
+DirectFileHandle::~DirectFileHandle() {
+
+    // n.b. the data still queued is written, but not flushed
+
+    if (fd_ >= 0) {
+        stop();
+        ::close(fd_);
+    }
+
+    for (Block& b : blocks_) {
+        ::free(b.data);
+    }
+}
+
+Length DirectFileHandle::openForRead() {
+    NOTIMP;
+}
+
+void DirectFileHandle::openForWrite(const Length&) {
+    NOTIMP;
+}
+
+void DirectFileHandle::openForAppend(const Length&) {
+    ASSERT(fd_ < 0);
+
+    direct_ = false;
+
+#ifdef O_DIRECT
+    fd_ = ::open(path_.c_str(), O_RDWR | O_CREAT | O_DIRECT, 0666);
+    if (fd_ >= 0) {
+        direct_ = true;
+    }
+    else if (errno == EINVAL) {
+        Log::debug<LibFdb5>() << "O_DIRECT not supported for " << path_ << ", writing through the page cache" << std::endl;
+    }
+#endif
+
+    if (fd_ < 0) {
+        fd_ = ::open(path_.c_str(), O_RDWR | O_CREAT, 0666);
+    }
+    if (fd_ < 0) {
+        throw eckit::CantOpenFile(path_);
+    }
+
+    struct stat st;
+    SYSCALL(::fstat(fd_, &st));
+
+    pos_ = st.st_size;
+    flushed_ = pos_;
+    next_ = pos_ - (pos_ % alignment_);
+    current_ = noBlock;
+
+    free_.clear();
+    pending_.clear();
+    for (size_t i = 0; i < blocks_.size(); ++i) {
+        free_.push_back(i);
+    }
+    stopping_ = false;
+    error_ = nullptr;
+
+    // If the file ends part way through a block, start from a copy of that block
+
+    if (pos_ > next_) {
+        current_ = acquire();
+        Block& b(blocks_[current_]);
+        ssize_t len;
+        SYSCALL(len = ::pread(fd_, b.data, alignment_, next_));
+        ASSERT(len >= pos_ - next_);
+        b.offset = next_;
+        b.used = pos_ - next_;
+        next_ += bufferSize_;
+    }
+
+    thread_ = std::thread([this] { run(); });
+
+    Log::debug<LibFdb5>() << "Opened " << path_ << (direct_ ? " with O_DIRECT" : "") << " at " << pos_
+                          << ", " << blocks_.size() << " buffers of " << Bytes(bufferSize_) << std::endl;
+}
+
+long DirectFileHandle::read(void*, long) {
+    NOTIMP;
+}
+
+long DirectFileHandle::write(const void* buffer, long length) {
+    ASSERT(buffer);
+    ASSERT(fd_ >= 0);
+    ASSERT(length >= 0);
+
+    const char* p = static_cast<const char*>(buffer);
+    size_t remaining = length;
+
+    while (remaining > 0) {
+
+        if (current_ == noBlock) {
+            current_ = acquire();
+            blocks_[current_].offset = next_;
+            blocks_[current_].used = 0;
+            next_ += bufferSize_;
+        }
+
+        Block& b(blocks_[current_]);
+        size_t n = std::min(remaining, bufferSize_ - b.used);
+        ::memcpy(b.data + b.used, p, n);
+        b.used += n;
+        p += n;
+        remaining -= n;
+
+        if (b.used == bufferSize_) {
+            submit(current_);
+            current_ = noBlock;
+        }
+    }
+
+    pos_ += length;
+
+    return length;
+}
+
+void DirectFileHandle::flush() {
+    static bool fdbDataSyncOnFlush =
+        eckit::LibResource<bool, LibFdb5>("$FDB_DATA_SYNC_ON_FLUSH;fdbDataSyncOnFlush", true);
+
+    if (fd_ < 0) {
+        return;
+    }
+
+    eckit::Timer timer;
+
+    wait();
+
+    // Write the partial block padded to the alignment, and remove the padding. The block is
+    // kept, and will be written again once it is full.
+
+    if (current_ != noBlock && blocks_[current_].used > 0) {
+        Block& b(blocks_[current_]);
+        ASSERT(off_t(b.offset + b.used) == pos_);
+
+        size_t length = ((b.used + alignment_ - 1) / alignment_) * alignment_;
+        ::memset(b.data + b.used, 0, length - b.used);
+        writeBlock(b.data, length, b.offset);
+
+        if (length > b.used) {
+            SYSCALL(::ftruncate(fd_, pos_));
+        }
+    }
+
+    if (fdbDataSyncOnFlush) {
+        int ret = eckit::fdatasync(fd_);
+
+        while (ret < 0 && errno == EINTR) {
+            ret = eckit::fdatasync(fd_);
+        }
+        if (ret < 0) {
+            Log::error() << "Cannot fdatasync(" << path_ << ") " << fd_ << Log::syserr << std::endl;
+            throw eckit::WriteError(path_);
+        }
+    }
+
+    if (pos_ > flushed_) {
+        if (!root_.empty()) {
+            RootStatistics::instance().record(root_, pos_ - flushed_, timer.elapsed());
+        }
+        flushed_ = pos_;
+    }
+}
+
+void DirectFileHandle::close() {
+    if (fd_ < 0) {
+        return;
+    }
+
+    std::exception_ptr error;
+    try {
+        flush();
+    }
+    catch (...) {
+        error = std::current_exception();
+    }
+
+    stop();
+
+    int ret = ::close(fd_);
+    fd_ = -1;
+    pos_ = 0;
+    current_ = noBlock;
+
+    if (error) {
+        std::rethrow_exception(error);
+    }
+    if (ret < 0) {
+        throw WriteError(std::string("close ") + name());
+    }
+}
+
+Offset DirectFileHandle::position() {
+    return pos_;
+}
+
+std::string DirectFileHandle::title() const {
+    return PathName::shorten(path_);
+}
+
+size_t DirectFileHandle::acquire() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    cv_.wait(lock, [this] { return !free_.empty() || error_; });
+
+    if (error_) {
+        std::rethrow_exception(error_);
+    }
+
+    size_t block = free_.front();
+    free_.pop_front();
+    return block;
+}
+
+void DirectFileHandle::submit(size_t block) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    if (error_) {
+        std::rethrow_exception(error_);
+    }
+
+    pending_.push_back(block);
+    cv_.notify_all();
+}
+
+void DirectFileHandle::wait() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    cv_.wait(lock, [this] { return pending_.empty() || error_; });
+
+    if (error_) {
+        std::rethrow_exception(error_);
+    }
+}
+
+void DirectFileHandle::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+        cv_.notify_all();
+    }
+
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+void DirectFileHandle::run() {
+
+    // n.b. the blocks are only removed from pending_ once written, so that wait() covers the write in progress
+
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    while (true) {
+        cv_.wait(lock, [this] { return !pending_.empty() || stopping_; });
+
+        if (pending_.empty()) {
+            break;
+        }
+
+        size_t block = pending_.front();
+        const Block& b(blocks_[block]);
+
+        lock.unlock();
+        try {
+            writeBlock(b.data, b.used, b.offset);
+        }
+        catch (...) {
+            lock.lock();
+            error_ = std::current_exception();
+            for (size_t i : pending_) {
+                free_.push_back(i);
+            }
+            pending_.clear();
+            cv_.notify_all();
+            continue;
+        }
+        lock.lock();
+
+        pending_.pop_front();
+        free_.push_back(block);
+        cv_.notify_all();
+    }
+}
+
+void DirectFileHandle::writeBlock(const char* data, size_t length, off_t offset) {
+
+    size_t done = 0;
+    while (done < length) {
+        ssize_t ret = ::pwrite(fd_, data + done, length - done, offset + done);
+        if (ret < 0 && errno == EINTR) {
+            continue;
+        }
+        if (ret <= 0) {
+            Log::error() << "Cannot write " << length << " bytes at " << offset << " to " << path_
+                         << Log::syserr << std::endl;
+            throw eckit::WriteError(path_);
+        }
+        done += ret;
+    }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+}  // namespace fdb5
@@ -0,0 +1,117 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+/// @file   DirectFileHandle.h
+/// @date   Oct 2026
+
+#ifndef fdb5_DirectFileHandle_h
+#define fdb5_DirectFileHandle_h
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "eckit/io/DataHandle.h"
+#include "eckit/filesystem/PathName.h"
+
+namespace fdb5 {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/// A handle for appending to data files with O_DIRECT, so that the data written does not go
+/// through (and evict everything else from) the page cache.
+///
+///   * the data is copied into a pool of aligned buffers, and each full buffer is written by a
+///     background thread while the next is filled
+///   * on flush, the partially filled buffer is written padded to the alignment, and the padding
+///     is then truncated away. The buffer is kept, and rewritten as it fills.
+///   * the position is that of the data, and does not include any padding
+///   * this class can only be used in Append mode, and assumes it is the only writer of the file
+///   * if the filesystem does not support O_DIRECT, the file is written through the page cache
+///   * if the root containing the file is given, the time taken to flush is recorded in its RootStatistics
+
+class DirectFileHandle : public eckit::DataHandle {
+public:  // methods
+
+    DirectFileHandle(const std::string& path, size_t nbBuffers, size_t bufferSize,
+                     const std::string& root = std::string());
+
+    ~DirectFileHandle();
+
+    virtual eckit::Length openForRead() override;
+    virtual void   openForWrite(const eckit::Length &) override;
+    virtual void   openForAppend(const eckit::Length &) override;
+
+    virtual long   read(void *, long) override;
+    virtual long   write(const void *, long) override;
+    virtual void   close() override;
+    virtual void   flush() override;
+    virtual void print(std::ostream &) const override;
+    virtual eckit::Offset position() override;
+    virtual std::string title() const override;
+    virtual bool canSeek() const override { return false; }
+
+protected: // members
+
+    std::string      path_;
+
+private: // types
+
+    struct Block {
+        char*  data;
+        off_t  offset;  ///< in the file, aligned
+        size_t used;
+    };
+
+private: // methods
+
+    size_t acquire();
+    void submit(size_t block);
+    void wait();
+    void stop();
+    void run();
+
+    void writeBlock(const char* data, size_t length, off_t offset);
+
+private: // members
+
+    size_t alignment_;
+    size_t bufferSize_;
+
+    std::vector<Block> blocks_;
+
+    int fd_;
+    bool direct_;
+    off_t pos_;
+    off_t flushed_;
+    off_t next_;          ///< the offset of the next block to be filled
+
+    size_t current_;      ///< the block being filled, if any
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<size_t> free_;
+    std::deque<size_t> pending_;  ///< blocks waiting for (or being) written, in order
+    bool stopping_;
+    std::exception_ptr error_;
+
+    std::thread thread_;
+
+    std::string      root_;
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+
+} // namespace fdb5
+
+#endif
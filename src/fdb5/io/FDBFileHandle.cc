@@ -15,9 +15,11 @@
 #include "eckit/eckit.h"
 #include "eckit/io/FDataSync.h"
 #include "eckit/log/Log.h"
+#include "eckit/log/Timer.h"
 
 #include "fdb5/LibFdb5.h"
 #include "fdb5/io/FDBFileHandle.h"
+#include "fdb5/io/RootStatistics.h"
 
 using namespace eckit;
 
@@ -29,11 +31,13 @@ void FDBFileHandle::print(std::ostream& s) const {
     s << "FDBFileHandle[file=" << path_ << ']';
 }
 
-FDBFileHandle::FDBFileHandle(const std::string& name, size_t buffer) :
+FDBFileHandle::FDBFileHandle(const std::string& name, size_t buffer, const std::string& root) :
     path_(name),
     file_(nullptr),
     buffer_(buffer),
-    pos_(0) {}
+    pos_(0),
+    flushed_(0),
+    root_(root) {}
 
 FDBFileHandle::~FDBFileHandle() {}
 
@@ -52,6 +56,7 @@ void FDBFileHandle::openForAppend(const Length&) {
         throw eckit::CantOpenFile(path_);
     }
     SYSCALL(pos_ = ::ftello(file_));
+    flushed_ = pos_;
     SYSCALL(::setvbuf(file_, buffer_, _IOFBF, buffer_.size()));
 }
 
@@ -79,6 +84,8 @@ void FDBFileHandle::flush() {
         eckit::LibResource<bool, LibFdb5>("$FDB_DATA_SYNC_ON_FLUSH;fdbDataSyncOnFlush", true);
 
     if (file_) {
+        eckit::Timer timer;
+
         if (::fflush(file_))
             throw WriteError(std::string("FDBFileHandle::~FDBFileHandle(fflush(") + path_ + "))",
                              Here());
@@ -99,6 +106,13 @@ void FDBFileHandle::flush() {
         off_t current;
         SYSCALL(current = ::ftello(file_));
         ASSERT(pos_ == current);
+
+        if (pos_ > flushed_) {
+            if (!root_.empty()) {
+                RootStatistics::instance().record(root_, pos_ - flushed_, timer.elapsed());
+            }
+            flushed_ = pos_;
+        }
     }
 }
 
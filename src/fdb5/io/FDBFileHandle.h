@@ -17,6 +17,7 @@
 
 #include "eckit/io/DataHandle.h"
 #include "eckit/io/Buffer.h"
+#include "eckit/filesystem/PathName.h"
 
 namespace fdb5 {
 
@@ -28,11 +29,12 @@ namespace fdb5 {
 ///   * it fails on ENOSPC
 ///   * this class can only be used in Append mode
 ///   * this is not thread-safe neither multi-process safe
+///   * if the root containing the file is given, the time taken to flush is recorded in its RootStatistics
 
 class FDBFileHandle : public eckit::DataHandle {
 public:  // methods
 
-    FDBFileHandle(const std::string&, size_t buffer);
+    FDBFileHandle(const std::string&, size_t buffer, const std::string& root = std::string());
 
     ~FDBFileHandle();
 
@@ -58,6 +60,9 @@ private: // members
     FILE            *file_;
     eckit::Buffer    buffer_;
     off_t pos_;
+    off_t flushed_;
+
+    std::string      root_;
 
 };
 
@@ -52,6 +52,18 @@ public: // methods
     {
     }
 
+    LustreFileHandle(const std::string& path, size_t buffsize, const std::string& root, LustreStripe stripe) :
+        HANDLE(path, buffsize, root),
+        stripe_(stripe)
+    {
+    }
+
+    LustreFileHandle(const std::string& path, size_t buffcount, size_t buffsize, const std::string& root, LustreStripe stripe) :
+        HANDLE(path, buffcount, buffsize, root),
+        stripe_(stripe)
+    {
+    }
+
     virtual ~LustreFileHandle() override {}
 
     virtual void openForAppend(const eckit::Length& len) override {
@@ -0,0 +1,189 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "eckit/config/Resource.h"
+#include "eckit/log/Log.h"
+#include "eckit/thread/AutoLock.h"
+
+#include "fdb5/LibFdb5.h"
+#include "fdb5/io/RootStatistics.h"
+
+using namespace eckit;
+
+namespace fdb5 {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+namespace {
+
+const char magic[] = "FDBPERF1";
+
+/// The statistics are advisory, so any failure to access the file is only reported as debug output
+
+class StatisticsFile {
+public:
+    StatisticsFile(const PathName& path, bool write) : path_(path), fd_(-1) {
+        fd_ = write ? ::open(path.localPath(), O_RDWR | O_CREAT, 0666) : ::open(path.localPath(), O_RDONLY);
+        if (fd_ < 0) {
+            if (write) Log::debug<LibFdb5>() << "Cannot open " << path_ << Log::syserr << std::endl;
+            return;
+        }
+
+        struct flock lock;
+        ::memset(&lock, 0, sizeof(lock));
+        lock.l_type = write ? F_WRLCK : F_RDLCK;
+        lock.l_whence = SEEK_SET;
+
+        int ret;
+        while ((ret = ::fcntl(fd_, F_SETLKW, &lock)) < 0 && errno == EINTR) {}
+        if (ret < 0) {
+            Log::debug<LibFdb5>() << "Cannot lock " << path_ << Log::syserr << std::endl;
+            ::close(fd_);
+            fd_ = -1;
+        }
+    }
+
+    ~StatisticsFile() {
+        if (fd_ >= 0) ::close(fd_);
+    }
+
+    bool valid() const { return fd_ >= 0; }
+
+    template <typename T>
+    bool read(T& record) const {
+        return ::pread(fd_, &record, sizeof(T), 0) == ssize_t(sizeof(T)) && ::memcmp(record.magic_, magic, 8) == 0;
+    }
+
+    template <typename T>
+    void write(const T& record) const {
+        if (::pwrite(fd_, &record, sizeof(T), 0) != ssize_t(sizeof(T))) {
+            Log::debug<LibFdb5>() << "Cannot write " << path_ << Log::syserr << std::endl;
+        }
+    }
+
+private:
+    PathName path_;
+    int fd_;
+};
+
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+RootStatistics& RootStatistics::instance() {
+    static RootStatistics statistics;
+    return statistics;
+}
+
+RootStatistics::RootStatistics() :
+    interval_(eckit::Resource<long>("fdbRootStatisticsInterval;$FDB_ROOT_STATISTICS_INTERVAL", 60)),
+    expiry_(eckit::Resource<long>("fdbRootStatisticsExpiry;$FDB_ROOT_STATISTICS_EXPIRY", 86400)),
+    weight_(eckit::Resource<double>("fdbRootStatisticsWeight;$FDB_ROOT_STATISTICS_WEIGHT", 0.25)) {
+    ASSERT(weight_ > 0 && weight_ <= 1);
+}
+
+PathName RootStatistics::statisticsPath(const PathName& root) {
+    return root / ".fdb-performance";
+}
+
+void RootStatistics::record(const PathName& root, size_t bytes, double seconds) {
+
+    AutoLock<Mutex> lock(mutex_);
+
+    Accumulated& acc = accumulated_[root.asString()];
+    acc.bytes += bytes;
+    acc.seconds += seconds;
+    acc.flushes++;
+
+    // n.b. The first flush is published immediately, as many writers are short lived
+
+    time_t now = ::time(nullptr);
+    if (now - acc.published >= interval_) {
+        publish(root, acc);
+        acc = Accumulated();
+        acc.published = now;
+    }
+}
+
+void RootStatistics::publish(const PathName& root, Accumulated& acc) const {
+
+    if (acc.flushes == 0 || acc.seconds <= 0) return;
+
+    double throughput = acc.bytes / acc.seconds;
+    double latency = acc.seconds / acc.flushes;
+
+    StatisticsFile file(statisticsPath(root), true);
+    if (!file.valid()) return;
+
+    time_t now = ::time(nullptr);
+
+    Record r;
+    if (file.read(r) && now - r.updated_ < expiry_) {
+        r.throughput_ = weight_ * throughput + (1 - weight_) * r.throughput_;
+        r.latency_ = weight_ * latency + (1 - weight_) * r.latency_;
+    } else {
+        ::memset(&r, 0, sizeof(r));
+        ::memcpy(r.magic_, magic, 8);
+        r.throughput_ = throughput;
+        r.latency_ = latency;
+    }
+    r.updated_ = now;
+
+    file.write(r);
+
+    Log::debug<LibFdb5>() << "Root " << root << " throughput " << r.throughput_ << " B/s, latency "
+                          << r.latency_ << " s" << std::endl;
+
+    Cached& cached = cache_[root.asString()];
+    cached.perf = Performance{r.throughput_, r.latency_, now};
+    cached.valid = true;
+    cached.read = now;
+}
+
+bool RootStatistics::read(const PathName& root, Performance& perf) const {
+
+    StatisticsFile file(statisticsPath(root), false);
+    if (!file.valid()) return false;
+
+    Record r;
+    if (!file.read(r)) return false;
+
+    perf = Performance{r.throughput_, r.latency_, time_t(r.updated_)};
+    return true;
+}
+
+bool RootStatistics::performance(const PathName& root, Performance& perf) const {
+
+    AutoLock<Mutex> lock(mutex_);
+
+    time_t now = ::time(nullptr);
+
+    Cached& cached = cache_[root.asString()];
+    if (cached.read == 0 || now - cached.read >= interval_) {
+        cached.valid = read(root, cached.perf);
+        cached.read = now;
+    }
+
+    if (!cached.valid || now - cached.perf.updated >= expiry_) {
+        return false;
+    }
+
+    perf = cached.perf;
+    return true;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+} // namespace fdb5
@@ -0,0 +1,106 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+/// @file   RootStatistics.h
+/// @date   Oct 2026
+
+#ifndef fdb5_RootStatistics_H
+#define fdb5_RootStatistics_H
+
+#include <cstdint>
+#include <ctime>
+#include <map>
+#include <string>
+
+#include "eckit/filesystem/PathName.h"
+#include "eckit/memory/NonCopyable.h"
+#include "eckit/thread/Mutex.h"
+
+namespace fdb5 {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/// The observed write performance of each root, measured as the data files are flushed.
+///
+/// Each process accumulates its measurements, and periodically merges them into a small file in
+/// the root (.fdb-performance), so that the performance seen by all the writers is shared. The
+/// file holds exponentially weighted averages, so that it follows changes in the load.
+
+class RootStatistics : private eckit::NonCopyable {
+
+public: // types
+
+    struct Performance {
+        double throughput;  ///< bytes per second
+        double latency;     ///< seconds per flush
+        time_t updated;
+    };
+
+public: // methods
+
+    static RootStatistics& instance();
+
+    /// Record a flush of a data file in the given root
+    void record(const eckit::PathName& root, size_t bytes, double seconds);
+
+    /// The shared performance of the root
+    /// @returns false if there are no (recent) measurements
+    bool performance(const eckit::PathName& root, Performance& perf) const;
+
+private: // types
+
+    struct Accumulated {
+        Accumulated() : bytes(0), seconds(0), flushes(0), published(0) {}
+        size_t bytes;
+        double seconds;
+        size_t flushes;
+        time_t published;
+    };
+
+    struct Cached {
+        Performance perf;
+        bool valid;
+        time_t read;
+    };
+
+    struct Record {
+        char    magic_[8];
+        double  throughput_;
+        double  latency_;
+        int64_t updated_;
+        char    spare_[8];
+    };
+
+private: // methods
+
+    RootStatistics();
+
+    static eckit::PathName statisticsPath(const eckit::PathName& root);
+
+    void publish(const eckit::PathName& root, Accumulated& acc) const;
+    bool read(const eckit::PathName& root, Performance& perf) const;
+
+private: // members
+
+    mutable eckit::Mutex mutex_;
+
+    std::map<std::string, Accumulated> accumulated_;
+    mutable std::map<std::string, Cached> cache_;
+
+    time_t interval_;
+    time_t expiry_;
+    double weight_;
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+
+} // namespace fdb5
+
+#endif // fdb5_RootStatistics_H
@@ -69,7 +69,8 @@ bool PMemDBReader::selectIndex(const Key &key) {
 
 
 void PMemDBReader::axis(const std::string& keyword, eckit::StringSet& s) const {
-    s = currentIndex_.axes().values(keyword);
+    s.clear();
+    currentIndex_.axes().values(keyword, s);
 }
 
 
@@ -13,9 +13,23 @@
  * (Project ID: 671951) www.nextgenio.eu
  */
 
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if defined(__linux__)
+#include <sys/sendfile.h>
+#endif
+
+#include <cerrno>
 #include <chrono>
+#include <cstring>
+#include <set>
 
 #include "eckit/config/Resource.h"
+#include "eckit/log/Bytes.h"
+#include "eckit/log/Timer.h"
 #include "eckit/maths/Functions.h"
 #include "eckit/net/Endpoint.h"
 #include "eckit/runtime/Main.h"
@@ -25,6 +39,7 @@
 #include "metkit/mars/MarsRequest.h"
 
 #include "fdb5/LibFdb5.h"
+#include "fdb5/fdb5_config.h"
 #include "fdb5/fdb5_version.h"
 #include "fdb5/api/helpers/FDBToolRequest.h"
 #include "fdb5/database/Key.h"
@@ -32,6 +47,11 @@
 #include "fdb5/remote/Handler.h"
 #include "fdb5/remote/Messages.h"
 #include "fdb5/remote/RemoteFieldLocation.h"
+#include "fdb5/rules/Schema.h"
+
+#if defined(fdb5_HAVE_TOCFDB)
+#include "fdb5/toc/TocFieldLocation.h"
+#endif
 
 using namespace eckit;
 using metkit::mars::MarsRequest;
@@ -176,9 +196,9 @@ private:
 
 //----------------------------------------------------------------------------------------------------------------------
 
-// n.b. by default the retrieve queue is big -- we are only queueing the requests, and it
-// is a common idiom to queue _many_ requests behind each other (and then aggregate the
-// results in a MultiHandle/HandleGatherer).
+// n.b. the pending reads are not bounded -- we are only queueing the requests, and it is a
+// common idiom to queue _many_ requests behind each other (and then aggregate the results
+// in a MultiHandle/HandleGatherer). The prefetch queue holds field data, so is small.
 
 RemoteHandler::RemoteHandler(eckit::net::TCPSocket& socket, const Config& config) :
     config_(config),
@@ -186,7 +206,17 @@ RemoteHandler::RemoteHandler(eckit::net::TCPSocket& socket, const Config& config
     dataSocket_(selectDataPort()),
     dataListenHostname_(config.getString("dataListenHostname", "")),
     fdb_(config),
-    readLocationQueue_(eckit::Resource<size_t>("fdbRetrieveQueueSize", 10000)) {}
+    numArchiveWorkers_(eckit::Resource<size_t>("fdbServerArchiveWorkers;$FDB_SERVER_ARCHIVE_WORKERS", 1)),
+    readRequestsClosed_(false),
+    numReadWorkers_(eckit::Resource<size_t>("fdbServerReadWorkers;$FDB_SERVER_READ_WORKERS", 1)),
+    zeroCopyRead_(eckit::Resource<bool>("fdbServerZeroCopyRead;$FDB_SERVER_ZERO_COPY_READ", true)),
+    readWorkerStats_(numReadWorkers_),
+    readTaskQueue_(eckit::Resource<size_t>("fdbServerReadPrefetch;$FDB_SERVER_READ_PREFETCH", 16)),
+    readResultQueue_(eckit::Resource<size_t>("fdbServerReadPrefetch;$FDB_SERVER_READ_PREFETCH", 16)),
+    dataConnectionLost_(false) {
+    ASSERT(numArchiveWorkers_ > 0);
+    ASSERT(numReadWorkers_ > 0);
+}
 
 RemoteHandler::~RemoteHandler() {
     // We don't want to die before the worker threads are cleaned up
@@ -195,6 +225,11 @@ RemoteHandler::~RemoteHandler() {
 
     // And notify the client that we are done.
 
+    if (dataConnectionLost_) {
+        Log::warning() << "Data connection was shut down, no exit message sent to client" << std::endl;
+        return;
+    }
+
     Log::info() << "Sending exit message to client" << std::endl;
     dataWrite(Message::Exit, 0);
     Log::info() << "Done" << std::endl;
@@ -206,6 +241,8 @@ eckit::LocalConfiguration RemoteHandler::availableFunctionality() const {
 //    Add to the configuration all the components that require to be versioned, as in the following example, with a vector of supported version numbers
     std::vector<int> remoteFieldLocationVersions = {1};
     conf.set("RemoteFieldLocation", remoteFieldLocationVersions);
+    std::vector<int> multiReadVersions = {1, 2};
+    conf.set("MultiRead", multiReadVersions);
     return conf;
 }
 
@@ -278,6 +315,16 @@ void RemoteHandler::initialiseConnections() {
              ss << "    client functionality: " << clientAvailableFunctionality << std::endl;
              errorMsg = ss.str();
          }
+
+        // Batched reads are optional. Older clients don't know about them, so only agree
+        // to them if they have been offered.
+        if (clientAvailableFunctionality.has("MultiRead")) {
+            std::vector<int> mrCommon = intersection(clientAvailableFunctionality, serverConf, "MultiRead");
+            if (mrCommon.size() > 0) {
+                Log::debug() << "Protocol negotiation - MultiRead version " << mrCommon.back() << std::endl;
+                agreedConf_.set("MultiRead", mrCommon.back());
+            }
+        }
     }
 
     // We want a data connection too. Send info to RemoteFDB, and wait for connection
@@ -411,6 +458,14 @@ void RemoteHandler::handle() {
                     read(hdr);
                     break;
 
+                case Message::MultiRead:
+                    multiRead(hdr);
+                    break;
+
+                case Message::ReadCredit:
+                    readCredit(hdr);
+                    break;
+
                 case Message::Flush:
                     flush(hdr);
                     break;
@@ -517,6 +572,59 @@ void RemoteHandler::dataWriteUnsafe(const void* data, size_t length) {
     }
 }
 
+// Send a range of a local file as Blob messages, without copying the data through user space.
+// The framing is identical to dataWrite(), including splitting into chunks of (at most) 10MiB.
+//
+// The range is checked against the file before it is queued (see readWorkerThreadLoop), but once
+// a header has been sent the client expects the whole chunk. If it cannot be sent (e.g. the file
+// has been truncated since) the stream cannot be resynchronised, so the data connection is shut
+// down and the client sees it fail.
+
+void RemoteHandler::dataWriteFileRange(uint32_t requestID, int fd, off_t offset, size_t length) {
+
+#if defined(__linux__)
+    static const size_t maxChunkSize = 10 * 1024 * 1024;
+
+    while (length > 0) {
+
+        size_t chunkSize = std::min(length, maxChunkSize);
+        MessageHeader message(Message::Blob, requestID, chunkSize);
+
+        std::lock_guard<std::mutex> lock(dataWriteMutex_);
+
+        dataWriteUnsafe(&message, sizeof(message));
+
+        try {
+            size_t remaining = chunkSize;
+            while (remaining > 0) {
+                ssize_t sent = ::sendfile(dataSocket_.socket(), fd, &offset, remaining);
+                if (sent < 0 && errno == EINTR) continue;
+                if (sent <= 0) {
+                    std::stringstream ss;
+                    ss << "sendfile error. Expected " << remaining << " bytes, sent " << sent;
+                    if (sent < 0) ss << " (" << ::strerror(errno) << ")";
+                    throw TCPException(ss.str(), Here());
+                }
+                remaining -= sent;
+            }
+
+            dataWriteUnsafe(&EndMarker, sizeof(EndMarker));
+        }
+        catch (...) {
+            // n.b. shutdown, not close, so that the descriptor is not reused under the other writers
+            Log::error() << "Shutting down data connection, part way through request " << requestID << std::endl;
+            dataConnectionLost_ = true;
+            ::shutdown(dataSocket_.socket(), SHUT_RDWR);
+            throw;
+        }
+
+        length -= chunkSize;
+    }
+#else
+    NOTIMP;
+#endif
+}
+
 
 Buffer RemoteHandler::receivePayload(const MessageHeader& hdr, net::TCPSocket& socket) {
     Buffer payload(hdr.payloadSize);
@@ -544,7 +652,11 @@ void RemoteHandler::tidyWorkers() {
 }
 
 void RemoteHandler::waitForWorkers() {
-    readLocationQueue_.close();
+    {
+        std::lock_guard<std::mutex> lock(readRequestsMutex_);
+        readRequestsClosed_ = true;
+    }
+    readRequestsCV_.notify_all();
 
     tidyWorkers();
 
@@ -555,8 +667,20 @@ void RemoteHandler::waitForWorkers() {
         Log::error() << "Thread complete" << std::endl;
     }
 
+    // n.b. the dispatcher closes the downstream queues once it has drained the pending reads
+
     if (readLocationWorker_.joinable()) {
         readLocationWorker_.join();
+
+        for (std::thread& worker : readWorkers_) {
+            worker.join();
+        }
+        readResultWorker_.join();
+
+        for (size_t i = 0; i < readWorkerStats_.size(); ++i) {
+            std::string prefix = "read worker " + std::to_string(i) + " ";
+            readWorkerStats_[i].report(Log::info(), prefix.c_str());
+        }
     }
 }
 
@@ -620,79 +744,112 @@ void RemoteHandler::archive(const MessageHeader& hdr) {
 
 // A helper function to make archiveThreadLoop a bit cleaner
 
-static void archiveBlobPayload(FDB& fdb, const void* data, size_t length) {
-    MemoryStream s(data, length);
-
-    fdb5::Key key(s);
+static void archiveBlob(FDB& fdb, const Key& key, const void* data, size_t length) {
 
     std::stringstream ss_key;
     ss_key << key;
 
-    const char* charData = static_cast<const char*>(data);  // To allow pointer arithmetic
     Log::status() << "Archiving data: " << ss_key.str() << std::endl;
-    fdb.archive(key, charData + s.position(), length - s.position());
+    fdb.archive(key, data, length);
     Log::status() << "Archiving done: " << ss_key.str() << std::endl;
 }
 
 
+FDB& RemoteHandler::archiveFDB(size_t worker) {
+    ASSERT(worker < numArchiveWorkers_);
+    return (worker == 0) ? fdb_ : *archiveFDBs_[worker - 1];
+}
+
+
+size_t RemoteHandler::archiveWorker(const Key& key) {
+
+    if (numArchiveWorkers_ == 1) return 0;
+
+    // Fields are sharded by database, so that the fields of one database are archived in
+    // order by a single Archiver. Databases are assigned to the workers in turn as they are
+    // first seen, and stay with that worker (and its open DB) for the life of the connection.
+    // If the key doesn't match the schema, it will fail in whichever worker archives it.
+
+    Key dbKey;
+    if (!config_.schema().expandFirstLevel(key, dbKey)) return 0;
+
+    auto it = archiveShards_.find(dbKey);
+    if (it == archiveShards_.end()) {
+        size_t worker = archiveShards_.size() % numArchiveWorkers_;
+        it = archiveShards_.emplace(dbKey, worker).first;
+        Log::debug<LibFdb5>() << "Archiving " << dbKey << " with worker " << worker << std::endl;
+    }
+    return it->second;
+}
+
+
 size_t RemoteHandler::archiveThreadLoop(uint32_t id) {
     size_t totalArchived = 0;
 
-    // Create a worker that will do the actual archiving
+    // Create the workers that will do the actual archiving. Each has its own FDB (and hence
+    // Archiver), and is fed the fields of the databases assigned to it, in the order received.
 
     static size_t queueSize(eckit::Resource<size_t>("fdbServerMaxQueueSize", 32));
-    eckit::Queue<std::pair<eckit::Buffer, bool>> queue(queueSize);
 
-    std::future<size_t> worker = std::async(std::launch::async, [this, &queue, id] {
-        size_t totalArchived = 0;
+    while (archiveFDBs_.size() < numArchiveWorkers_ - 1) {
+        archiveFDBs_.emplace_back(new FDB(config_));
+    }
 
-        std::pair<eckit::Buffer, bool> elem = std::make_pair(Buffer{0}, false);
+    std::vector<std::unique_ptr<eckit::Queue<ArchiveElement>>> queues;
+    std::vector<std::future<size_t>> workers;
 
-        try {
-            long queuelen;
-            while ((queuelen = queue.pop(elem)) != -1) {
-                if (elem.second) {
-                    // Handle MultiBlob
-
-                    const char* firstData =
-                        static_cast<const char*>(elem.first.data());  // For pointer arithmetic
-                    const char* charData = firstData;
-                    while (size_t(charData - firstData) < elem.first.size()) {
-                        const MessageHeader* hdr =
-                            static_cast<const MessageHeader*>(static_cast<const void*>(charData));
-                        ASSERT(hdr->marker == StartMarker);
-                        ASSERT(hdr->version == CurrentVersion);
-                        ASSERT(hdr->message == Message::Blob);
-                        ASSERT(hdr->requestID == id);
-                        charData += sizeof(MessageHeader);
-
-                        const void* payloadData = charData;
-                        charData += hdr->payloadSize;
-
-                        const decltype(EndMarker)* e = static_cast<const decltype(EndMarker)*>(
-                            static_cast<const void*>(charData));
-                        ASSERT(*e == EndMarker);
-                        charData += sizeof(EndMarker);
-
-                        archiveBlobPayload(fdb_, payloadData, hdr->payloadSize);
-                        totalArchived += 1;
-                    }
-                }
-                else {
-                    // Handle single blob
-                    archiveBlobPayload(fdb_, elem.first.data(), elem.first.size());
+    for (size_t i = 0; i < numArchiveWorkers_; ++i) {
+        queues.emplace_back(new eckit::Queue<ArchiveElement>(queueSize));
+    }
+
+    for (size_t i = 0; i < numArchiveWorkers_; ++i) {
+
+        eckit::Queue<ArchiveElement>& queue(*queues[i]);
+        FDB& fdb(archiveFDB(i));
+
+        workers.emplace_back(std::async(std::launch::async, [&queue, &fdb] {
+            size_t totalArchived = 0;
+
+            ArchiveElement elem{Key{}, nullptr, nullptr, 0};
+
+            try {
+                long queuelen;
+                while ((queuelen = queue.pop(elem)) != -1) {
+                    archiveBlob(fdb, elem.key, elem.data, elem.length);
                     totalArchived += 1;
                 }
             }
-        }
-        catch (...) {
-            // Ensure exception propagates across the queue back to the parent thread.
-            queue.interrupt(std::current_exception());
-            throw;
-        }
+            catch (...) {
+                // Ensure exception propagates across the queue back to the parent thread.
+                queue.interrupt(std::current_exception());
+                throw;
+            }
+
+            return totalArchived;
+        }));
+    }
 
-        return totalArchived;
-    });
+    // Decode the key of a blob, and queue it for the appropriate worker. The payload is shared
+    // by all of the fields of a MultiBlob, and released once they have all been archived.
+
+    auto queueBlob = [this, &queues](const std::shared_ptr<Buffer>& payload, const char* data, size_t length) {
+
+        MemoryStream s(data, length);
+        Key key(s);
+
+        size_t worker = archiveWorker(key);
+        size_t queuelen = queues[worker]->emplace(
+            ArchiveElement{std::move(key), payload, data + s.position(), length - s.position()});
+
+        Log::debug<LibFdb5>() << "Queued data (worker=" << worker << ", " << queuelen
+                              << ", size=" << length << ")" << std::endl;
+    };
+
+    auto interruptWorkers = [&queues] {
+        for (auto& queue : queues) {
+            queue->interrupt(std::current_exception());
+        }
+    };
 
     try {
         // The archive loop is the only thing that can listen on the data socket,
@@ -714,8 +871,7 @@ size_t RemoteHandler::archiveThreadLoop(uint32_t id) {
 
             ASSERT(hdr.message == Message::Blob || hdr.message == Message::MultiBlob);
 
-            Buffer payload(receivePayload(hdr, dataSocket_));
-            MemoryStream s(payload);
+            std::shared_ptr<Buffer> payload(new Buffer(receivePayload(hdr, dataSocket_)));
 
             eckit::FixedString<4> tail;
             socketRead(&tail, sizeof(tail), dataSocket_);
@@ -723,19 +879,44 @@ size_t RemoteHandler::archiveThreadLoop(uint32_t id) {
 
             // Queueing payload
 
-            size_t sz = payload.size();
-            Log::debug<LibFdb5>() << "Queueing data: " << sz << std::endl;
-            size_t queuelen = queue.emplace(
-                std::make_pair(std::move(payload), hdr.message == Message::MultiBlob));
-            Log::status() << "Queued data (" << queuelen << ", size=" << sz << ")" << std::endl;
-            ;
-            Log::debug<LibFdb5>() << "Queued data (" << queuelen << ", size=" << sz << ")"
-                                  << std::endl;
-            ;
+            Log::debug<LibFdb5>() << "Queueing data: " << payload->size() << std::endl;
+
+            const char* firstData = static_cast<const char*>(payload->data());  // For pointer arithmetic
+
+            if (hdr.message == Message::MultiBlob) {
+
+                const char* charData = firstData;
+                while (size_t(charData - firstData) < payload->size()) {
+                    const MessageHeader* blobHdr =
+                        static_cast<const MessageHeader*>(static_cast<const void*>(charData));
+                    ASSERT(blobHdr->marker == StartMarker);
+                    ASSERT(blobHdr->version == CurrentVersion);
+                    ASSERT(blobHdr->message == Message::Blob);
+                    ASSERT(blobHdr->requestID == id);
+                    charData += sizeof(MessageHeader);
+
+                    const char* payloadData = charData;
+                    charData += blobHdr->payloadSize;
+
+                    const decltype(EndMarker)* e = static_cast<const decltype(EndMarker)*>(
+                        static_cast<const void*>(charData));
+                    ASSERT(*e == EndMarker);
+                    charData += sizeof(EndMarker);
+
+                    queueBlob(payload, payloadData, blobHdr->payloadSize);
+                }
+            }
+            else {
+                queueBlob(payload, firstData, payload->size());
+            }
+
+            Log::status() << "Queued data (size=" << payload->size() << ")" << std::endl;
         }
 
         // Trigger cleanup of the workers
-        queue.close();
+        for (auto& queue : queues) {
+            queue->close();
+        }
 
         // Complete reading the Flush instruction
 
@@ -743,22 +924,24 @@ size_t RemoteHandler::archiveThreadLoop(uint32_t id) {
         socketRead(&tail, sizeof(tail), dataSocket_);
         ASSERT(tail == EndMarker);
 
-        // Ensure worker is done
+        // Ensure workers are done
 
-        ASSERT(worker.valid());
-        totalArchived = worker.get();  // n.b. use of async, get() propagates any exceptions.
+        for (auto& worker : workers) {
+            ASSERT(worker.valid());
+            totalArchived += worker.get();  // n.b. use of async, get() propagates any exceptions.
+        }
     }
     catch (std::exception& e) {
         // n.b. more general than eckit::Exception
         std::string what(e.what());
         dataWrite(Message::Error, id, what.c_str(), what.length());
-        queue.interrupt(std::current_exception());
+        interruptWorkers();
         throw;
     }
     catch (...) {
         std::string what("Caught unexpected, unknown exception in retrieve worker");
         dataWrite(Message::Error, id, what.c_str(), what.length());
-        queue.interrupt(std::current_exception());
+        interruptWorkers();
         throw;
     }
 
@@ -780,10 +963,20 @@ void RemoteHandler::flush(const MessageHeader& hdr) {
         size_t n = archiveFuture_.get();
         ASSERT(numArchived == n);
 
-        // Do the actual flush!
+        // Do the actual flush! Each archive worker has its own FDB, and they are flushed
+        // concurrently.
         Log::info() << "Flushing" << std::endl;
         Log::status() << "Flushing" << std::endl;
+
+        std::vector<std::future<void>> flushes;
+        for (size_t i = 1; i < numArchiveWorkers_; ++i) {
+            FDB& fdb(archiveFDB(i));
+            flushes.emplace_back(std::async(std::launch::async, [&fdb] { fdb.flush(); }));
+        }
         fdb_.flush();
+        for (auto& f : flushes) {
+            f.get();
+        }
         Log::info() << "Flush complete" << std::endl;
         Log::status() << "Flush complete" << std::endl;
     }
@@ -791,9 +984,7 @@ void RemoteHandler::flush(const MessageHeader& hdr) {
 
 void RemoteHandler::read(const MessageHeader& hdr) {
 
-    if (!readLocationWorker_.joinable()) {
-        readLocationWorker_ = std::thread([this] { readLocationThreadLoop(); });
-    }
+    startReadWorkers();
 
     Buffer payload(receivePayload(hdr, controlSocket_));
     MemoryStream s(payload);
@@ -802,61 +993,362 @@ void RemoteHandler::read(const MessageHeader& hdr) {
 
     Log::debug<LibFdb5>() << "Queuing for read: " << hdr.requestID << " " << *location << std::endl;
 
-    std::unique_ptr<eckit::DataHandle> dh;
-    dh.reset(location->dataHandle());
+    std::vector<std::unique_ptr<FieldLocation>> locations;
+    locations.emplace_back(std::move(location));
+    queueReadLocations(hdr.requestID, locations);
+}
+
+void RemoteHandler::multiRead(const MessageHeader& hdr) {
+
+    startReadWorkers();
+
+    Buffer payload(receivePayload(hdr, controlSocket_));
+    MemoryStream s(payload);
+
+    // Version 2 of the protocol prefixes the locations with the flow control window (in bytes)
+    // that the client has allocated for this request. Zero means no flow control.
+
+    size_t window = 0;
+    if (agreedConf_.getInt("MultiRead", 1) >= 2) {
+        s >> window;
+    }
+
+    size_t numLocations;
+    s >> numLocations;
+    ASSERT(numLocations > 0);
+
+    Log::debug<LibFdb5>() << "Queuing for read: " << hdr.requestID << " (" << numLocations << " fields"
+                          << ", window=" << window << ")" << std::endl;
 
-    readLocationQueue_.emplace(std::make_pair(hdr.requestID, std::move(dh)));
+    std::vector<std::unique_ptr<FieldLocation>> locations;
+    locations.reserve(numLocations);
+    for (size_t i = 0; i < numLocations; ++i) {
+        locations.emplace_back(eckit::Reanimator<FieldLocation>::reanimate(s));
+    }
+
+    queueReadLocations(hdr.requestID, locations, window);
 }
 
-void RemoteHandler::writeToParent(const uint32_t requestID, std::unique_ptr<eckit::DataHandle> dh) {
-    try {
-        Log::status() << "Reading: " << requestID << std::endl;
-        // Write the data to the parent, in chunks if necessary.
+void RemoteHandler::readCredit(const MessageHeader& hdr) {
+
+    Buffer payload(receivePayload(hdr, controlSocket_));
+    MemoryStream s(payload);
+
+    size_t credit;
+    s >> credit;
 
-        Buffer writeBuffer(10 * 1024 * 1024);
-        long dataRead;
+    // n.b. the request may already have been fully dispatched. That is fine.
+    //
+    // A credit of zero cancels a request that the client has abandoned. The request is terminated
+    // with a Complete once the fields already being read have been returned, so that the client
+    // can release its state.
 
-        dh->openForRead();
-        Log::debug<LibFdb5>() << "Reading: " << requestID << " dh size: " << dh->size()
-                              << std::endl;
+    if (credit == 0) {
+        dropPendingReads(hdr.requestID);
+        return;
+    }
 
-        while ((dataRead = dh->read(writeBuffer, writeBuffer.size())) != 0) {
-            dataWrite(Message::Blob, requestID, writeBuffer, dataRead);
+    {
+        std::lock_guard<std::mutex> lock(readRequestsMutex_);
+        auto it = readRequests_.find(hdr.requestID);
+        if (it != readRequests_.end()) {
+            it->second.credit += credit;
         }
+    }
+    readRequestsCV_.notify_all();
+}
 
-        // And when we are done, add a complete message.
+// Drop the fields of a request that have not yet been dispatched to the read workers, along with
+// its credit. The request is ended by an element without a location, which carries no data.
 
-        Log::debug<LibFdb5>() << "Writing retrieve complete message: " << requestID
-                              << std::endl;
+void RemoteHandler::dropPendingReads(uint32_t requestID) {
 
-        dataWrite(Message::Complete, requestID);
+    {
+        std::lock_guard<std::mutex> lock(readRequestsMutex_);
+        auto it = readRequests_.find(requestID);
+        if (it == readRequests_.end()) return;
+
+        ReadRequest& request(it->second);
+        Log::debug<LibFdb5>() << "Dropping read request " << requestID << ", "
+                              << request.pending.size() << " fields not read" << std::endl;
+        request.pending.clear();
+        request.pending.emplace_back(ReadLocationElement{requestID, nullptr, true});
+        request.flowControlled = false;
+    }
+    readRequestsCV_.notify_all();
+}
 
-        Log::status() << "Done retrieve: " << requestID << std::endl;
-        Log::debug<LibFdb5>() << "Done retrieve: " << requestID << std::endl;
+// Each field is queued individually, so that they can be read concurrently. All of the fields
+// of a request are returned as one stream of Blobs, terminated by a single Complete.
+
+void RemoteHandler::queueReadLocations(uint32_t requestID, std::vector<std::unique_ptr<FieldLocation>>& locations,
+                                       size_t window) {
+
+    ASSERT(!locations.empty());
+
+    {
+        std::lock_guard<std::mutex> lock(readRequestsMutex_);
+
+        ASSERT(readRequests_.find(requestID) == readRequests_.end());
+        ReadRequest& request(readRequests_[requestID]);
+        request.flowControlled = (window != 0);
+        request.credit = window;
+
+        for (size_t i = 0; i < locations.size(); ++i) {
+            request.pending.emplace_back(ReadLocationElement{requestID, std::move(locations[i]), i == locations.size() - 1});
+        }
     }
-    catch (std::exception& e) {
-        // n.b. more general than eckit::Exception
-        std::string what(e.what());
-        dataWrite(Message::Error, requestID, what.c_str(), what.length());
+    readRequestsCV_.notify_all();
+}
+
+// Select the next field to read. This is the oldest request (requestIDs are allocated in order
+// by the client) that either is not flow controlled, or that still has credit. Blocks until
+// such a field is available, or returns false once the handler is shutting down.
+
+bool RemoteHandler::nextReadLocation(ReadLocationElement& elem) {
+
+    std::unique_lock<std::mutex> lock(readRequestsMutex_);
+
+    while (true) {
+
+        for (auto it = readRequests_.begin(); it != readRequests_.end(); ++it) {
+
+            ReadRequest& request(it->second);
+            ASSERT(!request.pending.empty());
+
+            if (request.flowControlled && request.credit <= 0) continue;
+
+            elem = std::move(request.pending.front());
+            request.pending.pop_front();
+
+            // n.b. a field may overdraw the credit, so that fields larger than the window progress
+            if (request.flowControlled) {
+                request.credit -= static_cast<long long>(elem.location->length());
+            }
+
+            if (request.pending.empty()) readRequests_.erase(it);
+
+            Log::status() << "Read requests pending: " << readRequests_.size() << std::endl;
+            return true;
+        }
+
+        if (readRequestsClosed_) {
+            // The client has gone away. Anything still waiting for credit will never be read.
+            if (!readRequests_.empty()) {
+                Log::warning() << "Discarding " << readRequests_.size() << " flow controlled read requests" << std::endl;
+            }
+            readRequests_.clear();
+            return false;
+        }
+
+        readRequestsCV_.wait(lock);
     }
-    catch (...) {
-        // We really don't want to std::terminate the thread
-        std::string what("Caught unexpected, unknown exception in retrieve worker");
-        dataWrite(Message::Error, requestID, what.c_str(), what.length());
+}
+
+// Fields that are stored unmodified in a local file can be sent with sendfile. Anything that
+// needs to be transformed on the way out (e.g. remapped GRIB keys) goes via a DataHandle.
+
+static bool zeroCopyEligible(const FieldLocation& location) {
+#if defined(__linux__) && defined(fdb5_HAVE_TOCFDB)
+    const TocFieldLocation* tocLocation = dynamic_cast<const TocFieldLocation*>(&location);
+    return tocLocation &&
+           tocLocation->remapKey().empty() &&
+           tocLocation->uri().scheme() == "file" &&
+           size_t(tocLocation->length()) > 0;
+#else
+    return false;
+#endif
+}
+
+void RemoteHandler::startReadWorkers() {
+
+    if (readLocationWorker_.joinable()) return;
+
+    Log::info() << "Starting " << numReadWorkers_ << " read workers" << std::endl;
+
+    readResultWorker_ = std::thread([this] { readResultThreadLoop(); });
+    for (size_t i = 0; i < numReadWorkers_; ++i) {
+        readWorkers_.emplace_back([this, i] { readWorkerThreadLoop(i); });
     }
+    readLocationWorker_ = std::thread([this] { readLocationThreadLoop(); });
 }
 
 void RemoteHandler::readLocationThreadLoop() {
-    std::pair<uint32_t, std::unique_ptr<eckit::DataHandle>> elem;
 
-    while (readLocationQueue_.pop(elem) != -1) {
-        // Get the next MarsRequest in sequence to work on, do the retrieve, and
-        // send the data back to the client.
+    ReadLocationElement elem;
+
+    while (nextReadLocation(elem)) {
+
+        // Reserve the slot in the output ordering before the data is read. n.b. the result
+        // queue is bounded, so this blocks if we are too far ahead of the client.
+
+        ReadTask task;
+        task.location = std::move(elem.location);
+
+        readResultQueue_.emplace(ReadResult{elem.requestID, elem.last, task.data.get_future()});
+
+        // A cancelled request ends with an element without a location, which carries no data
+
+        if (task.location) {
+            readTaskQueue_.emplace(std::move(task));
+        } else {
+            task.data.set_value(ReadData());
+        }
+    }
+
+    readTaskQueue_.close();
+    readResultQueue_.close();
+}
+
+void RemoteHandler::readWorkerThreadLoop(size_t worker) {
+
+    // Write the data to the parent in chunks of (at most) this size
 
-        const uint32_t requestID(elem.first);
+    static const long maxChunkSize = 10 * 1024 * 1024;
 
-        // Forward the API call
-        writeToParent(elem.first, std::move(elem.second));
+    FDBStats& stats(readWorkerStats_[worker]);
+    eckit::Timer timer;
+    ReadTask task;
+
+    while (readTaskQueue_.pop(task) != -1) {
+
+        try {
+            timer.start();
+
+            ReadData data;
+            size_t total = 0;
+
+            if (zeroCopyRead_ && zeroCopyEligible(*task.location)) {
+
+                // Open the file, and ask the kernel to start reading the range into the page
+                // cache. The result thread then sends it straight to the socket.
+
+                std::string path = task.location->uri().path().asString();
+                int fd = ::open(path.c_str(), O_RDONLY);
+                if (fd < 0) throw CantOpenFile(path);
+                data.fd.reset(new int(fd), [](int* p) { ::close(*p); delete p; });
+
+                data.offset = off_t(task.location->offset());
+                data.length = size_t(task.location->length());
+
+                // Check the range before anything is sent, so that errors are reported as usual
+
+                struct stat st;
+                SYSCALL2(::fstat(fd, &st), path);
+                if (data.offset + off_t(data.length) > st.st_size) {
+                    std::stringstream ss;
+                    ss << "Field at " << data.offset << " of length " << data.length << " is beyond the end of "
+                       << path << " (" << st.st_size << " bytes)";
+                    throw ReadError(ss.str(), Here());
+                }
+#if defined(POSIX_FADV_WILLNEED)
+                ::posix_fadvise(fd, data.offset, data.length, POSIX_FADV_WILLNEED);
+#endif
+                total = data.length;
+            }
+            else {
+
+                std::unique_ptr<eckit::DataHandle> dh(task.location->dataHandle());
+
+                long long estimate = dh->openForRead();
+                eckit::AutoClose closer(*dh);
+
+                long chunkSize = (estimate > 0 && estimate < maxChunkSize) ? long(estimate) : maxChunkSize;
+
+                while (true) {
+                    Buffer chunk(chunkSize);
+                    long len = dh->read(chunk, chunkSize);
+                    if (len <= 0) break;
+                    total += len;
+                    data.chunks.emplace_back(std::move(chunk), len);
+                }
+            }
+
+            timer.stop();
+            stats.addRetrieve(total, timer);
+
+            Log::status() << "Read worker " << worker << ": " << Bytes(total) << std::endl;
+
+            task.data.set_value(std::move(data));
+        }
+        catch (...) {
+            // Errors are reported to the client, in order, by the result thread
+            task.data.set_exception(std::current_exception());
+        }
+    }
+}
+
+void RemoteHandler::readResultThreadLoop() {
+
+    ReadResult result;
+    long prefetched;
+
+    // If a field of a (multi-field) request fails, the client stops reading that request on
+    // the Error message. Any remaining fields for it must not be sent. As the fields of several
+    // requests are interleaved, each failed request is tracked until its last result is seen.
+
+    std::set<uint32_t> failedRequests;
+
+    auto fail = [this, &failedRequests](const ReadResult& result, const std::string& what) {
+        dataWrite(Message::Error, result.requestID, what.c_str(), what.length());
+        if (!result.last) {
+            failedRequests.insert(result.requestID);
+            dropPendingReads(result.requestID);
+        }
+    };
+
+    while ((prefetched = readResultQueue_.pop(result)) != -1) {
+
+        // n.b. the queue is still drained once the data connection is lost, so that the dispatcher
+        //      is not blocked
+
+        const uint32_t requestID = result.requestID;
+
+        auto failed = failedRequests.find(requestID);
+        if (failed != failedRequests.end()) {
+            if (result.last) failedRequests.erase(failed);
+            continue;
+        }
+
+        if (dataConnectionLost_) continue;
+
+        try {
+            Log::status() << "Returning: " << requestID << " (" << prefetched << " prefetched)" << std::endl;
+
+            ReadData data(result.data.get());
+            if (data.fd) {
+                dataWriteFileRange(requestID, *data.fd, data.offset, data.length);
+            }
+            for (auto& chunk : data.chunks) {
+                dataWrite(Message::Blob, requestID, chunk.first, chunk.second);
+            }
+
+            // And when we are done, add a complete message.
+
+            if (result.last) {
+                Log::debug<LibFdb5>() << "Writing retrieve complete message: " << requestID << std::endl;
+                dataWrite(Message::Complete, requestID);
+                Log::status() << "Done retrieve: " << requestID << std::endl;
+            }
+        }
+        catch (std::exception& e) {
+            // n.b. more general than eckit::Exception
+            std::string what(e.what());
+            if (dataConnectionLost_) {
+                Log::error() << "Retrieve " << requestID << " failed: " << what << std::endl;
+                continue;
+            }
+            fail(result, what);
+        }
+        catch (...) {
+            // We really don't want to std::terminate the thread
+            std::string what("Caught unexpected, unknown exception in retrieve worker");
+            if (dataConnectionLost_) {
+                Log::error() << "Retrieve " << requestID << " failed: " << what << std::endl;
+                continue;
+            }
+            fail(result, what);
+        }
     }
 }
 
@@ -20,9 +20,19 @@
 #ifndef fdb5_remote_Handler_H
 #define fdb5_remote_Handler_H
 
+#include <sys/types.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
 #include <future>
+#include <map>
+#include <memory>
 #include <mutex>
+#include <thread>
+#include <vector>
 
+#include "eckit/container/Queue.h"
 #include "eckit/io/Buffer.h"
 #include "eckit/io/DataHandle.h"
 #include "eckit/net/TCPServer.h"
@@ -33,6 +43,7 @@
 
 #include "fdb5/api/FDB.h"
 #include "fdb5/config/Config.h"
+#include "fdb5/database/FieldLocation.h"
 #include "fdb5/database/Key.h"
 #include "fdb5/remote/Messages.h"
 
@@ -47,6 +58,57 @@ struct MessageHeader;
 //----------------------------------------------------------------------------------------------------------------------
 
 class RemoteHandler : private eckit::NonCopyable {
+
+private: // types
+
+    // A field received from the client, to be archived. The data is a view into the (shared)
+    // payload of the message it was received in.
+    struct ArchiveElement {
+        Key key;
+        std::shared_ptr<eckit::Buffer> payload;
+        const char* data;
+        size_t length;
+    };
+
+    // A field to be returned to the client. Several fields may share a requestID (MultiRead),
+    // in which case only the last one is followed by a Complete message. A cancelled request is
+    // terminated by an element without a location.
+    struct ReadLocationElement {
+        uint32_t requestID;
+        std::unique_ptr<FieldLocation> location;
+        bool last;
+    };
+
+    // The fields of one request that are waiting to be dispatched to the read workers. Requests
+    // that are flow controlled by the client (MultiRead version 2) are only dispatched while
+    // they hold (byte) credit, which the client replenishes as it consumes the data.
+    struct ReadRequest {
+        std::deque<ReadLocationElement> pending;
+        bool flowControlled;
+        long long credit;
+    };
+
+    // The data of one field, as prepared by a worker. Either it has been read into memory,
+    // in chunks of (buffer, length), or it is a range of an (open) local file, which is sent
+    // directly from the page cache to the data socket.
+    struct ReadData {
+        std::vector<std::pair<eckit::Buffer, long>> chunks;
+        std::shared_ptr<int> fd;
+        off_t offset = 0;
+        size_t length = 0;
+    };
+
+    struct ReadTask {
+        std::unique_ptr<FieldLocation> location;
+        std::promise<ReadData> data;
+    };
+
+    struct ReadResult {
+        uint32_t requestID;
+        bool last;
+        std::future<ReadData> data;
+    };
+
 public:  // methods
     RemoteHandler(eckit::net::TCPSocket& socket, const Config& config);
     ~RemoteHandler();
@@ -73,6 +135,7 @@ private:  // methods
     void dataWrite(Message msg, uint32_t requestID, const void* payload = nullptr,
                    uint32_t payloadLength = 0);
     void dataWriteUnsafe(const void* data, size_t length);
+    void dataWriteFileRange(uint32_t requestID, int fd, off_t offset, size_t length);
 
     eckit::Buffer receivePayload(const MessageHeader& hdr, eckit::net::TCPSocket& socket);
 
@@ -93,11 +156,21 @@ private:  // methods
     void archive(const MessageHeader& hdr);
     void retrieve(const MessageHeader& hdr);
     void read(const MessageHeader& hdr);
-
-    void writeToParent(const uint32_t requestID, std::unique_ptr<eckit::DataHandle> dh);
+    void multiRead(const MessageHeader& hdr);
+    void readCredit(const MessageHeader& hdr);
 
     size_t archiveThreadLoop(uint32_t id);
+    size_t archiveWorker(const Key& key);
+    FDB& archiveFDB(size_t worker);
+
+    void startReadWorkers();
+    void queueReadLocations(uint32_t requestID, std::vector<std::unique_ptr<FieldLocation>>& locations,
+                            size_t window = 0);
+    void dropPendingReads(uint32_t requestID);
+    bool nextReadLocation(ReadLocationElement& elem);
     void readLocationThreadLoop();
+    void readWorkerThreadLoop(size_t worker);
+    void readResultThreadLoop();
 
 private:  // members
     Config config_;
@@ -119,10 +192,40 @@ private:  // members
 
     std::future<size_t> archiveFuture_;
 
+    // Incoming fields may be archived by several workers, each of which owns a database (by
+    // its first level key) for the life of the connection. Worker 0 archives into fdb_.
+    size_t numArchiveWorkers_;
+    std::vector<std::unique_ptr<FDB>> archiveFDBs_;
+    std::map<Key, size_t> archiveShards_;
+
     // Retrieve helpers
+    //
+    // Fields are read by a pool of workers, but are written back to the client in the order
+    // that they were dispatched (which for requests that are not flow controlled is the order
+    // that they were requested, as the shared FDBRemoteDataHandle queue requires). The
+    // dispatcher (readLocationWorker_) hands each field to the workers, and queues a future for
+    // its data on readResultQueue_. This queue is bounded, which limits the data prefetched in
+    // memory. As flow controlled requests are only dispatched with credit, the result thread
+    // never has to wait for the client to make space for them.
 
     std::thread readLocationWorker_;
-    eckit::Queue<std::pair<uint32_t, std::unique_ptr<eckit::DataHandle>>> readLocationQueue_;
+
+    std::mutex readRequestsMutex_;
+    std::condition_variable readRequestsCV_;
+    std::map<uint32_t, ReadRequest> readRequests_;
+    bool readRequestsClosed_;
+
+    size_t numReadWorkers_;
+    bool zeroCopyRead_;
+    std::vector<std::thread> readWorkers_;
+    std::vector<FDBStats> readWorkerStats_;
+    eckit::Queue<ReadTask> readTaskQueue_;
+
+    std::thread readResultWorker_;
+    eckit::Queue<ReadResult> readResultQueue_;
+
+    // Set if the data connection has been shut down part way through a message (see dataWriteFileRange)
+    std::atomic<bool> dataConnectionLost_;
 };
 
 //----------------------------------------------------------------------------------------------------------------------
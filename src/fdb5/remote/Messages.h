@@ -62,6 +62,8 @@ enum class Message : uint16_t {
     Inspect,
     Read,
     Move,
+    MultiRead,
+    ReadCredit,
 
     // Responses
     Received = 200,
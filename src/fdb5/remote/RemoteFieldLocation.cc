@@ -59,7 +59,7 @@ std::shared_ptr<FieldLocation> RemoteFieldLocation::make_shared() const {
 
 eckit::DataHandle* RemoteFieldLocation::dataHandle() const {
     ASSERT(remoteFDB_);
-    return remoteFDB_->dataHandle(*internal_);
+    return remoteFDB_->deferredDataHandle(internal_);
 }
 
 void RemoteFieldLocation::visit(FieldLocationVisitor& visitor) const {
@@ -147,6 +147,9 @@ BTREE(32, 4194304, FieldRefReduced);
 BTreeIndex::~BTreeIndex() {
 }
 
+void BTreeIndex::dump(std::ostream&, const char*) const {
+}
+
 
 const std::string& BTreeIndex::defaulType() {
     static std::string fdbIndexType = eckit::Resource<std::string>("fdbIndexType;$FDB_INDEX_TYPE", "BTreeIndex");
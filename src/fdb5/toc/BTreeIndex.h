@@ -49,6 +49,8 @@ public:
     virtual void flock() = 0;
     virtual void funlock() = 0;
 
+    /// Describe the storage of the index (for fdb-dump-index)
+    virtual void dump(std::ostream& out, const char* indent) const;
 
     static const std::string& defaulType();
 
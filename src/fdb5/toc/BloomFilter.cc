@@ -0,0 +1,151 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#include <algorithm>
+#include <cstring>
+#include <ostream>
+
+#include "eckit/config/Resource.h"
+#include "eckit/log/Bytes.h"
+
+#include "fdb5/toc/BloomFilter.h"
+#include "fdb5/toc/SortedArrayIndex.h"
+
+namespace fdb5 {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+namespace {
+
+const uint64_t magic = 0x4d4f4f4c42424446ULL; // "FDBBLOOM"
+
+struct EncodedHeader {
+    uint64_t magic_;
+    uint64_t nbits_;
+    uint32_t nhashes_;
+    uint32_t spare_;
+};
+
+const uint32_t maxHashes = 16;
+
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+BloomFilter::BloomFilter() :
+    nbits_(0),
+    nhashes_(0) {
+}
+
+BloomFilter::BloomFilter(size_t nkeys, size_t bitsPerKey) :
+    nbits_(0),
+    nhashes_(0) {
+
+    if (nkeys == 0 || bitsPerKey == 0) return;
+
+    // The optimal number of hashes is bitsPerKey * ln(2)
+
+    nhashes_ = std::max<uint32_t>(1, std::min<uint32_t>(maxHashes, uint32_t(bitsPerKey * 0.69 + 0.5)));
+    bits_.resize((nkeys * bitsPerKey + 63) / 64, 0);
+    nbits_ = bits_.size() * 64;
+}
+
+void BloomFilter::insert(uint64_t hash) {
+
+    if (empty()) return;
+
+    // Double hashing (Kirsch & Mitzenmacher), derived from one 64 bit hash
+
+    uint64_t h1 = hash & 0xffffffff;
+    uint64_t h2 = (hash >> 32) | 1;
+
+    for (uint32_t i = 0; i < nhashes_; ++i) {
+        uint64_t bit = (h1 + i * h2) % nbits_;
+        bits_[bit / 64] |= (uint64_t(1) << (bit % 64));
+    }
+}
+
+bool BloomFilter::mayContain(uint64_t hash) const {
+
+    if (empty()) return true;
+
+    uint64_t h1 = hash & 0xffffffff;
+    uint64_t h2 = (hash >> 32) | 1;
+
+    for (uint32_t i = 0; i < nhashes_; ++i) {
+        uint64_t bit = (h1 + i * h2) % nbits_;
+        if (!(bits_[bit / 64] & (uint64_t(1) << (bit % 64)))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+size_t BloomFilter::encode(void* data, size_t length) const {
+
+    size_t size = sizeof(EncodedHeader) + bits_.size() * sizeof(uint64_t);
+
+    if (empty() || size > length) return 0;
+
+    EncodedHeader hdr;
+    hdr.magic_ = magic;
+    hdr.nbits_ = nbits_;
+    hdr.nhashes_ = nhashes_;
+    hdr.spare_ = 0;
+
+    char* p = static_cast<char*>(data);
+    ::memcpy(p, &hdr, sizeof(hdr));
+    ::memcpy(p + sizeof(hdr), bits_.data(), bits_.size() * sizeof(uint64_t));
+
+    return size;
+}
+
+bool BloomFilter::decode(const void* data, size_t length) {
+
+    if (length < sizeof(EncodedHeader)) return false;
+
+    EncodedHeader hdr;
+    ::memcpy(&hdr, data, sizeof(hdr));
+
+    if (hdr.magic_ != magic || hdr.nbits_ == 0 || hdr.nbits_ % 64 != 0 ||
+        hdr.nhashes_ == 0 || hdr.nhashes_ > maxHashes || hdr.spare_ != 0 ||
+        hdr.nbits_ / 8 > length - sizeof(EncodedHeader)) {
+        return false;
+    }
+
+    nbits_ = hdr.nbits_;
+    nhashes_ = hdr.nhashes_;
+    bits_.resize(nbits_ / 64);
+    ::memcpy(bits_.data(), static_cast<const char*>(data) + sizeof(hdr), nbits_ / 8);
+
+    return true;
+}
+
+uint64_t BloomFilter::hash(const std::string& key) {
+    // n.b. The same (persistent) hash as the HashedKeyIndex
+    return SortedArrayIndex::hash(key.c_str(), key.size());
+}
+
+size_t BloomFilter::bitsPerKey() {
+    static size_t bits = eckit::Resource<size_t>("fdbIndexBloomFilterBitsPerKey;$FDB_INDEX_BLOOM_FILTER_BITS_PER_KEY", 10);
+    return bits;
+}
+
+void BloomFilter::print(std::ostream& s) const {
+    if (empty()) {
+        s << "BloomFilter()";
+    } else {
+        s << "BloomFilter(bits=" << nbits_ << ",hashes=" << nhashes_ << ",size=" << eckit::Bytes(nbits_ / 8) << ")";
+    }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+} // namespace fdb5
@@ -0,0 +1,75 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+/// @file   BloomFilter.h
+/// @date   Oct 2026
+
+#ifndef fdb5_BloomFilter_H
+#define fdb5_BloomFilter_H
+
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+namespace fdb5 {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/// A Bloom filter of the keys in a TocIndex, so that indexes that cannot contain a field are
+/// skipped without opening them. An empty filter (the default) may contain anything.
+
+class BloomFilter {
+
+public: // methods
+
+    BloomFilter();
+    BloomFilter(size_t nkeys, size_t bitsPerKey);
+
+    bool empty() const { return bits_.empty(); }
+
+    void insert(uint64_t hash);
+    bool mayContain(uint64_t hash) const;
+
+    /// Write the filter into (at most) length bytes, returning the number of bytes used. Returns
+    /// 0 (and nothing is written) if the filter is empty, or doesn't fit.
+    size_t encode(void* data, size_t length) const;
+
+    /// Read a filter written by encode(), if there is one. n.b. the data may be followed by
+    /// (uninitialised) padding, or contain no filter at all.
+    bool decode(const void* data, size_t length);
+
+    /// The hash of a key (as Key::valuesToString()). It is persistent.
+    static uint64_t hash(const std::string& key);
+
+    /// The size of the filters built (fdbIndexBloomFilterBitsPerKey). 0 disables them.
+    static size_t bitsPerKey();
+
+    friend std::ostream& operator<<(std::ostream& s, const BloomFilter& f) {
+        f.print(s);
+        return s;
+    }
+
+private: // methods
+
+    void print(std::ostream& s) const;
+
+private: // members
+
+    std::vector<uint64_t> bits_;
+    uint64_t nbits_;
+    uint32_t nhashes_;
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+
+} // namespace fdb5
+
+#endif // fdb5_BloomFilter_H
@@ -0,0 +1,123 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#include "eckit/config/Resource.h"
+#include "eckit/log/Log.h"
+#include "eckit/thread/AutoLock.h"
+
+#include "fdb5/LibFdb5.h"
+#include "fdb5/toc/DirectoryCache.h"
+
+using namespace eckit;
+
+namespace fdb5 {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+DirectoryCache& DirectoryCache::instance() {
+    static DirectoryCache cache;
+    return cache;
+}
+
+DirectoryCache::DirectoryCache() :
+    ttl_(eckit::Resource<long>("fdbDirectoryCacheTTL;$FDB_DIRECTORY_CACHE_TTL", 60)),
+    negativeTTL_(eckit::Resource<long>("fdbDirectoryCacheNegativeTTL;$FDB_DIRECTORY_CACHE_NEGATIVE_TTL", 5)),
+    maxEntries_(eckit::Resource<size_t>("fdbDirectoryCacheSize;$FDB_DIRECTORY_CACHE_SIZE", 100000)),
+    hits_(0),
+    misses_(0) {}
+
+bool DirectoryCache::lookup(const std::string& space, const PathName& db, bool& found, TocPath& root) {
+
+    AutoLock<Mutex> lock(mutex_);
+
+    EntryMap::iterator it = entries_.find(std::make_pair(space, db.asString()));
+    if (it != entries_.end()) {
+        if (::time(nullptr) < it->second.expires) {
+            ++hits_;
+            found = it->second.found;
+            if (found) {
+                root = it->second.root;
+            }
+            return true;
+        }
+        entries_.erase(it);
+    }
+
+    ++misses_;
+    return false;
+}
+
+void DirectoryCache::insert(const std::string& space, const PathName& db, bool found, const TocPath& root) {
+
+    time_t ttl = found ? ttl_ : negativeTTL_;
+    if (ttl <= 0) return;
+
+    AutoLock<Mutex> lock(mutex_);
+
+    // n.b. The entries expire, so rather than tracking their age just start again when full
+
+    if (entries_.size() >= maxEntries_) {
+        Log::debug<LibFdb5>() << "Directory cache full, clearing " << entries_.size() << " entries" << std::endl;
+        entries_.clear();
+    }
+
+    Entry& entry = entries_[std::make_pair(space, db.asString())];
+    entry.found = found;
+    entry.root = found ? root : TocPath{};
+    entry.expires = ::time(nullptr) + ttl;
+}
+
+void DirectoryCache::invalidate(const PathName& directory) {
+
+    std::string dir = directory.asString();
+
+    AutoLock<Mutex> lock(mutex_);
+
+    for (EntryMap::iterator it = entries_.begin(); it != entries_.end();) {
+        const std::string& db = it->first.second;
+        bool match = dir == db ||
+                     (dir.size() > db.size() && dir[dir.size() - db.size() - 1] == '/' &&
+                      dir.compare(dir.size() - db.size(), db.size(), db) == 0);
+        if (match) {
+            Log::debug<LibFdb5>() << "Directory cache invalidating " << db << " for " << directory << std::endl;
+            it = entries_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void DirectoryCache::clear() {
+    AutoLock<Mutex> lock(mutex_);
+    entries_.clear();
+}
+
+size_t DirectoryCache::hits() const {
+    AutoLock<Mutex> lock(mutex_);
+    return hits_;
+}
+
+size_t DirectoryCache::misses() const {
+    AutoLock<Mutex> lock(mutex_);
+    return misses_;
+}
+
+void DirectoryCache::print(std::ostream& out) const {
+    AutoLock<Mutex> lock(mutex_);
+    out << "DirectoryCache("
+        << "entries=" << entries_.size()
+        << ",hits=" << hits_
+        << ",misses=" << misses_
+        << ")";
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+} // namespace fdb5
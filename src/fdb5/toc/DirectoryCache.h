@@ -0,0 +1,101 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+/// @file   DirectoryCache.h
+/// @date   Oct 2026
+
+#ifndef fdb5_DirectoryCache_H
+#define fdb5_DirectoryCache_H
+
+#include <ctime>
+#include <iosfwd>
+#include <map>
+#include <string>
+#include <utility>
+
+#include "eckit/filesystem/PathName.h"
+#include "eckit/memory/NonCopyable.h"
+#include "eckit/thread/Mutex.h"
+
+#include "fdb5/toc/FileSpace.h"
+
+namespace fdb5 {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/// A process-wide cache of where the databases have been found in a file space (see FileSpace::existsDB),
+/// so that the roots are not probed again for every access to a database. Probing costs several
+/// metadata operations per root, which are expensive on parallel filesystems.
+///
+/// Databases that are not found are also cached, but for a shorter time (fdbDirectoryCacheNegativeTTL),
+/// as a database created by another process is not seen until the entry expires. They are only used
+/// by readers: before creating a database, the writers always probe the roots (see FileSpace::filesystem).
+/// Creating and wiping databases in this process invalidates the entries directly.
+
+class DirectoryCache : private eckit::NonCopyable {
+
+public: // methods
+
+    static DirectoryCache& instance();
+
+    /// @returns false if there is no (current) entry. Otherwise found indicates whether the database exists,
+    ///          and if so root is set.
+    bool lookup(const std::string& space, const eckit::PathName& db, bool& found, TocPath& root);
+
+    void insert(const std::string& space, const eckit::PathName& db, bool found, const TocPath& root);
+
+    /// Forget the entries for a database directory (root/db) that has been created or wiped
+    void invalidate(const eckit::PathName& directory);
+
+    void clear();
+
+    size_t hits() const;
+    size_t misses() const;
+
+    friend std::ostream& operator<<(std::ostream& s, const DirectoryCache& x) {
+        x.print(s);
+        return s;
+    }
+
+private: // types
+
+    struct Entry {
+        bool found;
+        TocPath root;
+        time_t expires;
+    };
+
+    typedef std::map<std::pair<std::string, std::string>, Entry> EntryMap;
+
+private: // methods
+
+    DirectoryCache();
+
+    void print(std::ostream& out) const;
+
+private: // members
+
+    mutable eckit::Mutex mutex_;
+
+    EntryMap entries_;
+
+    time_t ttl_;
+    time_t negativeTTL_;
+    size_t maxEntries_;
+
+    size_t hits_;
+    size_t misses_;
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+
+} // namespace fdb5
+
+#endif // fdb5_DirectoryCache_H
@@ -12,6 +12,7 @@
 
 #include <cctype> 
 #include <sys/file.h>
+#include <sys/stat.h>
 
 #include <algorithm>
 #include <fstream>
@@ -40,9 +41,48 @@ ExpverFileSpaceHandler::ExpverFileSpaceHandler() :
 ExpverFileSpaceHandler::~ExpverFileSpaceHandler() {
 }
 
-void ExpverFileSpaceHandler::load() const {
+std::shared_ptr<const ExpverFileSpaceHandler::Table> ExpverFileSpaceHandler::refresh(bool locked) const {
 
-    Log::debug<LibFdb5>() << "Loading " << fdbExpverFileSystems_ << std::endl;
+    struct stat st;
+    if (::stat(fdbExpverFileSystems_.localPath(), &st) < 0) {
+        std::ostringstream oss;
+        oss <<  fdbExpverFileSystems_ << Log::syserr;
+        Log::error() << oss.str() << std::endl;
+        throw CantOpenFile(oss.str(), Here());
+    }
+
+    std::shared_ptr<const Table> current = std::atomic_load(&table_);
+
+    bool sameFile = current && current->dev_ == st.st_dev && current->ino_ == st.st_ino;
+
+    if (sameFile && st.st_size == current->parsed_ && st.st_mtime == current->mtime_) {
+        return current;
+    }
+
+    std::shared_ptr<Table> table;
+
+    if (sameFile && st.st_size > current->parsed_) {
+        Log::debug<LibFdb5>() << "Updating " << fdbExpverFileSystems_ << " from offset " << current->parsed_ << std::endl;
+        table.reset(new Table(*current));
+    } else {
+        Log::debug<LibFdb5>() << "Loading " << fdbExpverFileSystems_ << std::endl;
+        table.reset(new Table());
+        table->parsed_ = 0;
+        table->lines_ = 0;
+    }
+
+    table->dev_ = st.st_dev;
+    table->ino_ = st.st_ino;
+    table->mtime_ = st.st_mtime;
+
+    parse(*table, locked);
+
+    std::shared_ptr<const Table> result(table);
+    std::atomic_store(&table_, result);
+    return result;
+}
+
+void ExpverFileSpaceHandler::parse(Table& table, bool locked) const {
 
     std::ifstream in(fdbExpverFileSystems_.localPath());
 
@@ -53,14 +93,22 @@ void ExpverFileSpaceHandler::load() const {
         throw CantOpenFile(oss.str(), Here());
     }
 
-    char line[1024];
-    size_t lineNo = 0;
+    in.seekg(table.parsed_);
+
+    std::string line;
     Tokenizer parse(" ");
     std::vector<std::string> s;
 
-    while(in.getline(line, sizeof(line)))
+    while(std::getline(in, line))
     {
-        ++lineNo;
+        // Only consume complete lines. A line being appended by another process is read later, but
+        // with the file locked nothing is being appended, and a last line without a newline is complete.
+        bool terminated = !in.eof();
+        if (!terminated && !locked)
+            break;
+
+        table.parsed_ += line.size() + (terminated ? 1 : 0);
+        ++table.lines_;
         s.clear();
 
         parse(line,s);
@@ -79,11 +127,11 @@ void ExpverFileSpaceHandler::load() const {
 
         if(s.size() != 2) {
             std::ostringstream oss;
-            oss << "Bad line (" << lineNo << ") in configuration file " << fdbExpverFileSystems_ << " -- should have format 'expver filesystem'";
+            oss << "Bad line (" << table.lines_ << ") in configuration file " << fdbExpverFileSystems_ << " -- should have format 'expver filesystem'";
             throw ReadError(oss.str(), Here());
         }
 
-        table_[ s[0] ] = PathName(s[1]);
+        table.paths_[ s[0] ] = PathName(s[1]);
     }
 }
 
@@ -96,55 +144,27 @@ eckit::PathName ExpverFileSpaceHandler::append(const std::string& expver, const
     eckit::FileLock locker(lockFile);
     eckit::AutoLock<eckit::FileLock> lock(locker);
 
-    // read the file first to check that this expver hasn't been inserted yet by another process
+    // check that this expver hasn't been inserted yet by another process
 
-    std::ifstream fi(fdbExpverFileSystems_.localPath());
+    std::shared_ptr<const Table> table = refresh(true);
 
-    if(!fi) {
-        std::ostringstream oss;
-        oss <<  fdbExpverFileSystems_ << Log::syserr;
-        Log::error() << oss.str() << std::endl;
-        throw CantOpenFile(oss.str(), Here());
+    PathTable::const_iterator itr = table->paths_.find(expver);
+    if (itr != table->paths_.end()) {
+        Log::debug<LibFdb5>() << "Found expver " << expver << " " << itr->second << " in " << fdbExpverFileSystems_ << std::endl;
+        return itr->second;
     }
 
-    char line[4*1024];
-    size_t lineNo = 0;
-    Tokenizer parse(" ");
-    std::vector<std::string> s;
+    // n.b. the file may have been edited by hand, leaving the last line without a newline
 
-    while(fi.getline(line, sizeof(line)))
+    bool newline = false;
     {
-        ++lineNo;
-        s.clear();
-
-        parse(line,s);
-
-        size_t i = 0;
-        while( i < s.size() ) /* cleanup entries that are empty */
-        {
-            if(s[i].length() == 0)
-                s.erase(s.begin()+i);
-            else
-                i++;
-        }
-
-        if(s.size() == 0 || s[0][0] == '#')
-            continue;
-
-        if(s.size() != 2) {
-            std::ostringstream oss;
-            oss << "Bad line (" << lineNo << ") in configuration file " << fdbExpverFileSystems_ << " -- should have format 'expver filesystem'";
-            throw ReadError(oss.str(), Here());
-        }
-
-        if(s[0] == expver) {
-            Log::debug<LibFdb5>() << "Found expver " << expver << " " << path << " in " << fdbExpverFileSystems_ << std::endl;
-            return PathName(s[1]);
+        std::ifstream in(fdbExpverFileSystems_.localPath(), std::ifstream::binary);
+        char last;
+        if (in.seekg(-1, std::ios::end) && in.get(last)) {
+            newline = (last != '\n');
         }
     }
 
-    fi.close();
-
     std::ofstream of(fdbExpverFileSystems_.localPath(), std::ofstream::app);
 
     if(!of) {
@@ -158,10 +178,15 @@ eckit::PathName ExpverFileSpaceHandler::append(const std::string& expver, const
 
     Log::debug<LibFdb5>() << "Appending expver " << expver << " " << path << " to " << fdbExpverFileSystems_ << std::endl;
 
+    if (newline) {
+        of << std::endl;
+    }
     of << expver << " " << path << std::endl;
 
     of.close();
 
+    refresh(true);
+
     return path;
 }
 
@@ -177,16 +202,10 @@ static bool expver_is_valid(const std::string& str) {
 
 eckit::PathName ExpverFileSpaceHandler::selectFileSystem(const Key& key, const FileSpace& fs) const {
 
-    AutoLock<Mutex> lock(mutex_);
-
     // Has the user specified a root to use already?
 
     static std::string fdbRootDirectory = eckit::Resource<std::string>("fdb5Root;$FDB5_ROOT", "");
 
-    // check if key is mapped already to a filesystem
-
-    if(table_.empty()) load();
-
     std::string expver = key.get("expver");
 
     // we can NOT use the type system here because we haven't opened a DB yet
@@ -196,16 +215,32 @@ eckit::PathName ExpverFileSpaceHandler::selectFileSystem(const Key& key, const F
 
     Log::debug<LibFdb5>() << "Selecting file system for expver [" << expver << "]" << std::endl;
 
-    PathTable::const_iterator itr = table_.find(expver);
-    if(itr != table_.end()) {
+    // check if key is mapped already to a filesystem. Known expvers are found without locking, and
+    // only if the expver is not known is the file checked for additions.
+
+    auto lookup = [&](const Table& table, PathName& path) {
+        PathTable::const_iterator itr = table.paths_.find(expver);
+        if(itr == table.paths_.end()) return false;
+
         Log::debug<LibFdb5>() << "Found expver " << expver << " " << itr->second << " in " << fdbExpverFileSystems_ << std::endl;
 
         if (!fdbRootDirectory.empty() && itr->second != fdbRootDirectory) {
             Log::warning() << "Existing root directory " << itr->second << " does not match FDB5_ROOT. Using existing" << std::endl;
         }
 
-        return itr->second;
-    }
+        path = itr->second;
+        return true;
+    };
+
+    PathName found;
+
+    std::shared_ptr<const Table> table = std::atomic_load(&table_);
+    if (table && lookup(*table, found)) return found;
+
+    AutoLock<Mutex> lock(mutex_);
+
+    table = refresh();
+    if (lookup(*table, found)) return found;
 
     // if not, assign a filesystem. Use the algorithm in select by default, unless overridden.
 
@@ -231,10 +266,8 @@ eckit::PathName ExpverFileSpaceHandler::selectFileSystem(const Key& key, const F
 
     PathName selected = append(expver, maybe);
 
-    table_[expver] = selected;
-
     if (!fdbRootDirectory.empty() && selected != fdbRootDirectory) {
-        Log::warning() << "Selected root directory " << itr->second << " does not match FDB5_ROOT. Using existing" << std::endl;
+        Log::warning() << "Selected root directory " << selected << " does not match FDB5_ROOT. Using existing" << std::endl;
     }
 
     return selected;
@@ -17,7 +17,9 @@
 #define fdb5_ExpverFileSpaceHandler_H
 
 #include <map>
+#include <memory>
 #include <string>
+#include <sys/types.h>
 
 #include "eckit/filesystem/PathName.h"
 #include "eckit/thread/Mutex.h"
@@ -33,6 +35,19 @@ class ExpverFileSpaceHandler : public FileSpaceHandler {
 
     typedef std::map<std::string, eckit::PathName>  PathTable;
 
+    /// The table, as parsed from the file. The file is only ever appended to (by this class), so
+    /// it can be brought up to date by parsing what has been appended since. Any other change to
+    /// the file causes it to be reparsed from scratch.
+
+    struct Table {
+        PathTable paths_;
+        dev_t     dev_;
+        ino_t     ino_;
+        time_t    mtime_;
+        off_t     parsed_;   ///< offset of the end of the last complete line parsed
+        size_t    lines_;
+    };
+
 public: // methods
 
     ExpverFileSpaceHandler();
@@ -43,7 +58,11 @@ public: // methods
 
 protected: // methods
 
-    void load() const;
+    /// Bring the table up to date with the file. Must be called with mutex_ held, and with locked
+    /// set if the file lock is also held (see append).
+    std::shared_ptr<const Table> refresh(bool locked = false) const;
+
+    void parse(Table& table, bool locked) const;
 
     eckit::PathName append(const std::string& expver, const eckit::PathName& path) const;
 
@@ -51,9 +70,11 @@ protected: // methods
 
     eckit::PathName fdbExpverFileSystems_;
 
+    /// Serialises refreshing the table, and insertions, within the process
     mutable eckit::Mutex mutex_;
 
-    mutable PathTable table_;
+    /// n.b. accessed atomically, so that lookups of known expvers take no lock
+    mutable std::shared_ptr<const Table> table_;
 };
 
 //----------------------------------------------------------------------------------------------------------------------
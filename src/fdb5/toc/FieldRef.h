@@ -41,6 +41,7 @@ public:
 
     FieldRefLocation();
     FieldRefLocation(UriStore &, const Field &);
+    FieldRefLocation(UriID uriId, const eckit::Offset& offset, const eckit::Length& length);
 
 
     UriID uriId() const { return uriId_; }
@@ -93,6 +94,7 @@ public:
     FieldRef(UriStore &, const Field &);
 
     FieldRef(const FieldRefReduced&);
+    FieldRef(const FieldRefLocation&);
 
     FieldRefLocation::UriID uriId() const { return location_.uriId(); }
     const eckit::Offset &offset() const { return location_.offset(); }
@@ -16,6 +16,7 @@
 
 #include "fdb5/LibFdb5.h"
 #include "fdb5/database/Key.h"
+#include "fdb5/toc/DirectoryCache.h"
 #include "fdb5/toc/FileSpaceHandler.h"
 #include "fdb5/toc/TocHandler.h"
 
@@ -34,14 +35,32 @@ namespace fdb5 {
 
 FileSpace::FileSpace(const std::string& name, const std::string& re, const std::string& handler,
                      const std::vector<Root>& roots) :
-    name_(name), handler_(handler), re_(re), roots_(roots) {}
+    name_(name), handler_(handler), re_(re), roots_(roots) {
+
+    // Identifies the file space in the DirectoryCache, as equivalent spaces may be built by many RootManagers
+    identity_ = name_;
+    for (RootVec::const_iterator i = roots_.begin(); i != roots_.end(); ++i) {
+        identity_ += ':' + i->path().asString();
+    }
+}
 
 TocPath FileSpace::filesystem(const Key& key, const eckit::PathName& db) const {
     // check that the database isn't present already
     // if it is, then return that path
 
+    // Only a database found in the cache is trusted. Another process may have created the database
+    // since it was cached as not found, so the roots are probed before a new one is created.
+
+    DirectoryCache& cache(DirectoryCache::instance());
+
     TocPath root;
-    if (existsDB(key, db, root)) {
+    bool found;
+    if (!cache.lookup(identity_, db, found, root) || !found) {
+        found = probeDB(key, db, root);
+        cache.insert(identity_, db, found, root);
+    }
+
+    if (found) {
         Log::debug<LibFdb5>() << "Found FDB root for key " << key << " -> " << root.directory_ << std::endl;
         return root;
     }
@@ -83,6 +102,22 @@ bool FileSpace::match(const std::string& s) const {
 }
 
 bool FileSpace::existsDB(const Key& key, const eckit::PathName& db, TocPath& root) const {
+
+    DirectoryCache& cache(DirectoryCache::instance());
+
+    bool cached;
+    if (cache.lookup(identity_, db, cached, root)) {
+        return cached;
+    }
+
+    Log::debug<LibFdb5>() << "Probing roots of " << name_ << " for " << db << ", " << cache << std::endl;
+
+    bool found = probeDB(key, db, root);
+    cache.insert(identity_, db, found, root);
+    return found;
+}
+
+bool FileSpace::probeDB(const Key& key, const eckit::PathName& db, TocPath& root) const {
     unsigned count = 0;
     bool found = false;
 
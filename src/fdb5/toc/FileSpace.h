@@ -35,6 +35,7 @@ class FileSpaceHandler;
 struct TocPath {
     eckit::PathName directory_;
     ControlIdentifiers controlIdentifiers_;
+    std::string root_;  ///< the root containing the directory, if resolved by the RootManager
 };
 
 //----------------------------------------------------------------------------------------------------------------------
@@ -69,8 +70,12 @@ public: // methods
 
 private: // methods
 
+    /// Whether the database exists in one of the roots, as cached in the DirectoryCache
     bool existsDB(const Key& key, const eckit::PathName& db, TocPath& root) const;
 
+    /// Search the roots for the database
+    bool probeDB(const Key& key, const eckit::PathName& db, TocPath& root) const;
+
     void print( std::ostream &out ) const;
 
 private: // members
@@ -84,6 +89,8 @@ private: // members
     eckit::Regex re_;
 
     RootVec roots_;
+
+    std::string identity_;
 };
 
 //----------------------------------------------------------------------------------------------------------------------
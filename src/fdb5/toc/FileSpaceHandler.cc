@@ -8,14 +8,18 @@
  * does it submit to any jurisdiction.
  */
 
+#include <random>
 #include <sstream>
 
 #include "fdb5/toc/FileSpaceHandler.h"
 
 #include "eckit/filesystem/FileSpaceStrategies.h"
+#include "eckit/filesystem/FileSystemSize.h"
 #include "eckit/exception/Exceptions.h"
 #include "eckit/thread/AutoLock.h"
 
+#include "fdb5/LibFdb5.h"
+#include "fdb5/io/RootStatistics.h"
 #include "fdb5/toc/FileSpace.h"
 #include "fdb5/database/Key.h"
 
@@ -165,6 +169,74 @@ struct WeightedRandomPercent : public FileSpaceHandler {
 
 static FileSpaceHandlerRegister<WeightedRandomPercent> weightedRandomPercent("WeightedRandomPercent");
 
+/// Weights the roots by their available space, scaled by their write throughput and latency as
+/// observed by all writers (see RootStatistics) relative to the average over the roots. Roots with
+/// no measurements are treated as average, so that they are explored.
+
+struct WeightedPerformance : public FileSpaceHandler {
+    WeightedPerformance() {}
+    eckit::PathName selectFileSystem(const Key&, const FileSpace& fs) const {
+
+        std::vector<eckit::PathName> roots = fs.enabled(ControlIdentifier::Archive);
+        if (roots.empty()) {
+            std::ostringstream oss;
+            oss << "No writable roots available. Configured roots: " << fs.roots();
+            throw eckit::UnexpectedState(oss.str(), Here());
+        }
+
+        std::vector<RootStatistics::Performance> perf(roots.size());
+        std::vector<bool> known(roots.size());
+
+        double throughput = 0;
+        double latency = 0;
+        size_t nknown = 0;
+
+        for (size_t i = 0; i < roots.size(); ++i) {
+            known[i] = RootStatistics::instance().performance(roots[i], perf[i]) &&
+                       perf[i].throughput > 0 && perf[i].latency > 0;
+            if (known[i]) {
+                throughput += perf[i].throughput;
+                latency += perf[i].latency;
+                ++nknown;
+            }
+        }
+
+        if (nknown != 0) {
+            throughput /= nknown;
+            latency /= nknown;
+        }
+
+        std::vector<double> weights(roots.size());
+        double total = 0;
+
+        for (size_t i = 0; i < roots.size(); ++i) {
+            eckit::FileSystemSize fsize;
+            roots[i].fileSystemSize(fsize);
+
+            double w = double(fsize.available);
+            if (known[i]) {
+                w *= (perf[i].throughput / throughput) * (latency / perf[i].latency);
+            }
+            weights[i] = w;
+            total += w;
+
+            Log::debug<LibFdb5>() << "Root " << roots[i] << " available " << fsize.available
+                                  << (known[i] ? "" : " (no measurements)") << " weight " << w << std::endl;
+        }
+
+        if (total <= 0) {
+            return eckit::FileSpaceStrategies::leastUsed(roots);
+        }
+
+        static thread_local std::mt19937 generator{std::random_device{}()};
+        std::discrete_distribution<size_t> distribution(weights.begin(), weights.end());
+
+        return roots[distribution(generator)];
+    }
+};
+
+static FileSpaceHandlerRegister<WeightedPerformance> weightedPerformance("WeightedPerformance");
+
 }
 
 //----------------------------------------------------------------------------------------------------------------------
@@ -0,0 +1,315 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+
+#include "eckit/config/Resource.h"
+#include "eckit/exception/Exceptions.h"
+#include "eckit/io/Buffer.h"
+#include "eckit/log/Log.h"
+#include "eckit/serialisation/MemoryStream.h"
+
+#include "fdb5/LibFdb5.h"
+#include "fdb5/toc/RootCatalogue.h"
+
+using namespace eckit;
+
+namespace fdb5 {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+namespace {
+
+constexpr const char* catalogueFile = "databases.catalogue";
+
+// Each record in the log is a (uint32_t) length, followed by the encoded operation:
+//
+//   init              the catalogue has been created, and is being populated
+//   complete          all of the databases in the root have been added
+//   add <db> <key>    a database has been created
+//   remove <db>       a database has been wiped
+
+constexpr const char* opInit = "init";
+constexpr const char* opComplete = "complete";
+constexpr const char* opAdd = "add";
+constexpr const char* opRemove = "remove";
+
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+RootCatalogue::RootCatalogue(const eckit::PathName& root) :
+    root_(root),
+    path_(root / catalogueFile) {}
+
+RootCatalogue::RootCatalogue(const eckit::PathName& root, const eckit::PathName& path) :
+    root_(root),
+    path_(path) {}
+
+bool RootCatalogue::exists() const {
+    return path_.exists();
+}
+
+bool RootCatalogue::enabled() {
+    static bool fdbUseRootCatalogue = eckit::Resource<bool>("fdbUseRootCatalogue;$FDB_USE_ROOT_CATALOGUE", true);
+    return fdbUseRootCatalogue;
+}
+
+bool RootCatalogue::load(std::map<std::string, Key>& databases) const {
+
+    databases.clear();
+
+    std::string contents;
+    if (!read(0, contents)) {
+        return false;
+    }
+
+    bool complete = false;
+    size_t pos = 0;
+
+    while (pos + sizeof(uint32_t) <= contents.size()) {
+
+        uint32_t length;
+        ::memcpy(&length, &contents[pos], sizeof(length));
+        if (pos + sizeof(length) + length > contents.size()) break;  // still being appended
+
+        MemoryStream s(&contents[pos + sizeof(length)], length);
+        pos += sizeof(length) + length;
+
+        std::string op;
+        s >> op;
+
+        if (op == opAdd) {
+            std::string database;
+            s >> database;
+            databases[database] = Key(s);
+        } else if (op == opRemove) {
+            std::string database;
+            s >> database;
+            databases.erase(database);
+        } else if (op == opComplete) {
+            complete = true;
+        } else if (op != opInit) {
+            // As for the TOC, later versions of the software may add records
+            Log::warning() << "Unknown record '" << op << "' in " << path_ << std::endl;
+        }
+    }
+
+    Log::debug<LibFdb5>() << "Loaded " << databases.size() << " databases from " << path_
+                          << (complete ? "" : " (incomplete)") << std::endl;
+
+    return complete;
+}
+
+bool RootCatalogue::read(size_t offset, std::string& contents) const {
+
+    int fd = ::open(path_.localPath(), O_RDONLY);
+    if (fd < 0) {
+        if (errno == ENOENT) return false;
+        throw FailedSystemCall("open " + path_.asString(), Here());
+    }
+
+    char buf[64 * 1024];
+    ssize_t len;
+    while ((len = ::pread(fd, buf, sizeof(buf), off_t(offset))) != 0) {
+        if (len < 0) {
+            if (errno == EINTR) continue;
+            ::close(fd);
+            throw FailedSystemCall("read " + path_.asString(), Here());
+        }
+        contents.append(buf, len);
+        offset += len;
+    }
+    ::close(fd);
+
+    return true;
+}
+
+size_t RootCatalogue::size() const {
+    return path_.size();
+}
+
+void RootCatalogue::create() {
+
+    int fd;
+    SYSCALL2((fd = ::open(path_.localPath(), O_CREAT | O_EXCL | O_WRONLY, mode_t(0666))), path_);
+    SYSCALL2(::close(fd), path_);
+
+    append(opInit, "");
+}
+
+void RootCatalogue::markComplete() {
+    append(opComplete, "");
+}
+
+void RootCatalogue::copyRecords(const RootCatalogue& other, size_t offset) {
+
+    std::string contents;
+    if (!other.read(offset, contents) || contents.empty()) {
+        return;
+    }
+
+    // n.b. only complete records are copied, as one may still be being appended
+
+    size_t pos = 0;
+    while (pos + sizeof(uint32_t) <= contents.size()) {
+        uint32_t length;
+        ::memcpy(&length, &contents[pos], sizeof(length));
+        if (pos + sizeof(length) + length > contents.size()) break;
+        pos += sizeof(length) + length;
+    }
+
+    if (pos > 0 && !write(contents.data(), pos)) {
+        throw CantOpenFile(path_.asString());
+    }
+}
+
+void RootCatalogue::replace(const RootCatalogue& other) {
+    ASSERT(root_ == other.root_);
+    SYSCALL2(::rename(path_.localPath(), other.path_.localPath()), path_);
+}
+
+void RootCatalogue::add(const std::string& database, const Key& key) {
+    append(opAdd, database, &key);
+}
+
+void RootCatalogue::remove(const std::string& database) {
+    append(opRemove, database);
+}
+
+void RootCatalogue::append(const std::string& op, const std::string& database, const Key* key) {
+    if (!appendIfExists(op, database, key)) {
+        throw CantOpenFile(path_.asString());
+    }
+}
+
+bool RootCatalogue::appendIfExists(const std::string& op, const std::string& database, const Key* key) {
+
+    Buffer buffer(64 * 1024);
+    char* data = static_cast<char*>(buffer.data());
+
+    uint32_t length;
+    MemoryStream s(data + sizeof(length), buffer.size() - sizeof(length));
+
+    s << op;
+    if (op == opAdd || op == opRemove) {
+        s << database;
+    }
+    if (key) {
+        s << *key;
+    }
+
+    length = s.position();
+    ::memcpy(data, &length, sizeof(length));
+
+    return write(data, sizeof(length) + length);
+}
+
+bool RootCatalogue::write(const void* data, size_t size) {
+
+    // n.b. a single write on an O_APPEND descriptor, so that concurrent records don't interleave
+
+    int fd = ::open(path_.localPath(), O_WRONLY | O_APPEND);
+    if (fd < 0) {
+        if (errno == ENOENT) return false;
+        throw FailedSystemCall("open " + path_.asString(), Here());
+    }
+
+    ssize_t written = ::write(fd, data, size);
+    int err = errno;
+    ::close(fd);
+
+    if (written != ssize_t(size)) {
+        errno = err;
+        throw WriteError(path_.asString(), Here());
+    }
+
+    return true;
+}
+
+void RootCatalogue::discard() const {
+
+    if (::unlink(path_.localPath()) == 0 || errno == ENOENT) {
+        Log::warning() << "Removed the catalogue of root " << root_ << ", which will be walked until the catalogue "
+                       << "is rebuilt (fdb-root-catalogue)" << std::endl;
+        return;
+    }
+
+    Log::error() << "Cannot remove the catalogue " << path_ << ": " << Log::syserr
+                 << ". It must be rebuilt (fdb-root-catalogue --rebuild)" << std::endl;
+}
+
+bool RootCatalogue::relativePath(const eckit::PathName& root, const eckit::PathName& directory, std::string& database) {
+
+    std::string r = root.asString();
+    std::string dir = directory.asString();
+
+    size_t skip = (r.empty() || r[r.size() - 1] == '/') ? r.size() : r.size() + 1;
+    if (dir.size() <= skip || dir.compare(0, r.size(), r) != 0 || (skip > r.size() && dir[r.size()] != '/')) {
+        return false;
+    }
+
+    database = dir.substr(skip);
+    return true;
+}
+
+void RootCatalogue::databaseCreated(const eckit::PathName& root, const eckit::PathName& directory, const Key& key) {
+
+    std::string database;
+    if (!relativePath(root, directory, database)) {
+        Log::debug<LibFdb5>() << "Database " << directory << " is not in root " << root << ", not catalogued" << std::endl;
+        return;
+    }
+
+    RootCatalogue catalogue(root);
+
+    try {
+        if (catalogue.appendIfExists(opAdd, database, &key)) {
+            Log::debug<LibFdb5>() << "Added " << database << " to catalogue of root " << root << std::endl;
+        }
+    }
+    catch (std::exception& e) {
+        Log::warning() << "Cannot add " << database << " to the catalogue of root " << root << ": " << e.what()
+                       << std::endl;
+        catalogue.discard();
+    }
+}
+
+void RootCatalogue::databaseWiped(const std::vector<eckit::PathName>& roots, const eckit::PathName& directory) {
+
+    for (const eckit::PathName& root : roots) {
+
+        std::string database;
+        if (!relativePath(root, directory, database)) continue;
+
+        RootCatalogue catalogue(root);
+
+        try {
+            if (catalogue.appendIfExists(opRemove, database)) {
+                Log::debug<LibFdb5>() << "Removed " << database << " from catalogue of root " << root << std::endl;
+            }
+        }
+        catch (std::exception& e) {
+            Log::warning() << "Cannot remove " << database << " from the catalogue of root " << root << ": " << e.what()
+                           << std::endl;
+            catalogue.discard();
+        }
+        return;
+    }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+} // namespace fdb5
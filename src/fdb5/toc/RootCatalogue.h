@@ -0,0 +1,109 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+/// @file   RootCatalogue.h
+/// @date   Oct 2026
+
+#ifndef fdb5_RootCatalogue_H
+#define fdb5_RootCatalogue_H
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "eckit/filesystem/PathName.h"
+
+#include "fdb5/database/Key.h"
+
+namespace eckit {
+class Stream;
+}
+
+namespace fdb5 {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/// A list of the databases in a root, and their keys, so that they can be found without walking
+/// the directory tree. It is an append-only log of databases created and wiped, maintained by
+/// TocHandler::writeInitRecord and the wipe.
+///
+/// A catalogue is only authoritative once it is complete. It is built by first creating the (empty)
+/// log, so that databases created concurrently are recorded, then walking the tree to add the
+/// existing databases, and finally marking it complete (see fdb-root-catalogue). A catalogue is
+/// rebuilt in a temporary file, which then replaces it.
+
+class RootCatalogue {
+
+public: // methods
+
+    RootCatalogue(const eckit::PathName& root);
+
+    /// A catalogue of the root kept in another file, e.g. whilst it is rebuilt
+    RootCatalogue(const eckit::PathName& root, const eckit::PathName& path);
+
+    const eckit::PathName& root() const { return root_; }
+    const eckit::PathName& path() const { return path_; }
+
+    bool exists() const;
+
+    /// Read the databases (path relative to the root -> key). Returns false (and the caller should
+    /// walk the tree instead) if the catalogue is missing or not yet complete.
+    bool load(std::map<std::string, Key>& databases) const;
+
+    size_t size() const;
+
+    void create();
+    void markComplete();
+
+    /// Append the (complete) records of the other catalogue from the offset onwards
+    void copyRecords(const RootCatalogue& other, size_t offset);
+
+    /// Move this catalogue into place of the other, atomically
+    void replace(const RootCatalogue& other);
+
+    void add(const std::string& database, const Key& key);
+    void remove(const std::string& database);
+
+    /// Record a database (directory) in the catalogue of its root, if the root has one. The catalogues
+    /// are advisory (they can be rebuilt), so failing to update one is logged rather than thrown, and
+    /// the catalogue is removed so that the root is walked until it is rebuilt.
+    static void databaseCreated(const eckit::PathName& root, const eckit::PathName& directory, const Key& key);
+    static void databaseWiped(const std::vector<eckit::PathName>& roots, const eckit::PathName& directory);
+
+    /// Whether catalogues are used to find databases (fdbUseRootCatalogue)
+    static bool enabled();
+
+private: // methods
+
+    void append(const std::string& op, const std::string& database, const Key* key = nullptr);
+
+    /// Returns false if there is no catalogue
+    bool appendIfExists(const std::string& op, const std::string& database, const Key* key = nullptr);
+    bool write(const void* data, size_t size);
+
+    /// Remove a catalogue that may be missing a record (or end with part of one)
+    void discard() const;
+
+    bool read(size_t offset, std::string& contents) const;
+
+    /// The path of the database relative to the root, if the root contains it
+    static bool relativePath(const eckit::PathName& root, const eckit::PathName& directory, std::string& database);
+
+private: // members
+
+    eckit::PathName root_;
+    eckit::PathName path_;
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+
+} // namespace fdb5
+
+#endif // fdb5_RootCatalogue_H
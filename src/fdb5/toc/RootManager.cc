@@ -564,7 +564,39 @@ RootManager::RootManager(const Config& config) :
 }
 
 
+// The names of the databases only depend on the key and the table of namers, which are memoised, so
+// the regex matching is done only once for each key
+
+typedef std::map<std::pair<const DbPathNamerTable*, std::string>, std::string> DbPathNameMap;
+
+static eckit::Mutex pathNameMutex;
+static DbPathNameMap dbPathNames;
+
 std::string RootManager::dbPathName(const Key& key)
+{
+    static size_t fdbDbPathNameCacheSize = eckit::Resource<size_t>("fdbDbPathNameCacheSize;$FDB_DBPATHNAME_CACHE_SIZE", 100000);
+
+    std::pair<const DbPathNamerTable*, std::string> id(&dbPathNamers_, std::string(key));
+
+    {
+        eckit::AutoLock<eckit::Mutex> lock(pathNameMutex);
+        DbPathNameMap::const_iterator it = dbPathNames.find(id);
+        if (it != dbPathNames.end()) {
+            return it->second;
+        }
+    }
+
+    std::string dbpath = nameDb(key);
+
+    eckit::AutoLock<eckit::Mutex> lock(pathNameMutex);
+    if (dbPathNames.size() >= fdbDbPathNameCacheSize) {
+        dbPathNames.clear();
+    }
+    dbPathNames[id] = dbpath;
+    return dbpath;
+}
+
+std::string RootManager::nameDb(const Key& key)
 {
     std::string dbpath;
     for (DbPathNamerTable::const_iterator i = dbPathNamers_.begin(); i != dbPathNamers_.end() ; ++i) {
@@ -622,7 +654,7 @@ TocPath RootManager::directory(const Key& key) {
     static std::string fdbRootDirectory = eckit::Resource<std::string>("fdbRootDirectory;$FDB_ROOT_DIRECTORY", "");
 
     if(!fdbRootDirectory.empty()) {
-        return TocPath{fdbRootDirectory + "/" + dbpath, ControlIdentifiers{}};
+        return TocPath{fdbRootDirectory + "/" + dbpath, ControlIdentifiers{}, fdbRootDirectory};
     }
 
     // returns the first filespace that matches
@@ -633,7 +665,7 @@ TocPath RootManager::directory(const Key& key) {
         if(i->match(keystr)) {
             TocPath root = i->filesystem(key, dbpath);
             eckit::Log::debug<LibFdb5>() << "Directory root " << root.directory_ << " dbpath " << dbpath <<  std::endl;
-            return TocPath{root.directory_ / dbpath, root.controlIdentifiers_};
+            return TocPath{root.directory_ / dbpath, root.controlIdentifiers_, root.directory_};
         }
     }
 
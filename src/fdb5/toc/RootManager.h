@@ -73,6 +73,10 @@ protected: // members
 
     std::vector<FileSpace> spacesTable_;
 
+private: // methods
+
+    std::string nameDb(const Key& key);
+
 private: // members
 
     const std::vector<DbPathNamer>& dbPathNamers_;
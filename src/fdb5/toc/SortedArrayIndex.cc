@@ -0,0 +1,485 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <sstream>
+#include <vector>
+
+#include "eckit/exception/Exceptions.h"
+#include "eckit/io/Buffer.h"
+#include "eckit/log/BigNum.h"
+#include "eckit/log/Bytes.h"
+#include "eckit/log/Log.h"
+
+#include "fdb5/LibFdb5.h"
+#include "fdb5/toc/SortedArrayIndex.h"
+
+using namespace eckit;
+
+namespace fdb5 {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+namespace {
+
+const char magic[8] = {'F', 'D', 'B', 'S', 'O', 'R', 'T', 'A'};
+const uint32_t version = 1;
+
+// A run of keys (or hashes) fills a 4KiB page
+const size_t fixedFenceStride = 4096 / SortedArrayIndex::keySize;
+const size_t hashedFenceStride = 4096 / sizeof(uint64_t);
+
+enum Column { URI = 0, OFFSET, LENGTH, NCOLUMNS };
+
+void padKey(const std::string& key, char* out) {
+    if (key.size() > SortedArrayIndex::keySize) {
+        std::ostringstream ss;
+        ss << "Key " << key << " is longer than the " << SortedArrayIndex::keySize
+           << " bytes supported by SortedArrayIndex. Use HashedKeyIndex for longer keys";
+        throw BadParameter(ss.str(), Here());
+    }
+    ::memset(out, 0, SortedArrayIndex::keySize);
+    ::memcpy(out, key.c_str(), key.size());
+}
+
+int compareKey(const char* lhs, const char* rhs) {
+    return ::memcmp(lhs, rhs, SortedArrayIndex::keySize);
+}
+
+size_t blockSize(bool hashed, size_t count, size_t nfences, size_t heapSize) {
+    size_t columns = count * NCOLUMNS * sizeof(uint64_t);
+    if (hashed) {
+        return sizeof(SortedArrayIndex::Header) + (nfences + count) * sizeof(uint64_t) + columns +
+               (count + 1) * sizeof(uint32_t) + heapSize;
+    }
+    return sizeof(SortedArrayIndex::Header) + (nfences + count) * SortedArrayIndex::keySize + columns;
+}
+
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+SortedArrayIndex::SortedArrayIndex(const eckit::PathName& path, bool readOnly, off_t offset, bool hashedKeys) :
+    path_(path),
+    offset_(offset),
+    readOnly_(readOnly),
+    hashedKeys_(hashedKeys),
+    fd_(-1),
+    keyBytes_(0),
+    dirty_(false),
+    addr_(nullptr),
+    mapped_(0),
+    header_(nullptr),
+    fences_(nullptr),
+    keys_(nullptr),
+    columns_(nullptr),
+    keyOffsets_(nullptr),
+    heap_(nullptr) {
+
+    static_assert(sizeof(Header) == 64, "SortedArrayIndex header must be 64 bytes");
+
+    int iomode = readOnly_ ? O_RDONLY : (O_RDWR | O_CREAT);
+    SYSCALL2((fd_ = ::open(path_.localPath(), iomode, (mode_t)0777)), path_);
+
+    if (readOnly_) {
+        try {
+            map();
+        } catch (...) {
+            ::close(fd_);
+            throw;
+        }
+    }
+}
+
+SortedArrayIndex::~SortedArrayIndex() {
+    if (addr_) {
+        ::munmap(addr_, mapped_);
+    }
+    if (fd_ >= 0) {
+        ::close(fd_);
+    }
+}
+
+uint64_t SortedArrayIndex::hash(const char* key, size_t length) {
+
+    // FNV-1a, with a final avalanche (from MurmurHash3), as the keys differ in few bytes
+
+    uint64_t h = 14695981039346656037ULL;
+    for (size_t i = 0; i < length; ++i) {
+        h ^= static_cast<unsigned char>(key[i]);
+        h *= 1099511628211ULL;
+    }
+
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+void SortedArrayIndex::map() {
+
+    Header hdr;
+    ssize_t len;
+    SYSCALL2((len = ::pread(fd_, &hdr, sizeof(hdr), offset_)), path_);
+
+    if (size_t(len) != sizeof(hdr) || ::memcmp(hdr.magic_, magic, sizeof(magic)) != 0) {
+        std::ostringstream ss;
+        ss << "No SortedArrayIndex found in " << path_ << " at offset " << offset_;
+        throw SeriousBug(ss.str(), Here());
+    }
+
+    // n.b. the layout is determined by the header, not by the type requested
+
+    if (hdr.version_ != version || (hdr.keySize_ != keySize && hdr.keySize_ != 0)) {
+        std::ostringstream ss;
+        ss << "Unsupported SortedArrayIndex in " << path_ << " at offset " << offset_
+           << " (version=" << hdr.version_ << ", keySize=" << hdr.keySize_ << ")";
+        throw SeriousBug(ss.str(), Here());
+    }
+
+    hashedKeys_ = (hdr.keySize_ == 0);
+    ASSERT(hdr.size_ == blockSize(hashedKeys_, hdr.count_, hdr.nfences_, hdr.heapSize_));
+
+    // mmap requires an offset aligned to a page
+
+    static const long pageSize = ::sysconf(_SC_PAGESIZE);
+    off_t base = offset_ - (offset_ % pageSize);
+
+    mapped_ = hdr.size_ + (offset_ - base);
+    addr_ = ::mmap(nullptr, mapped_, PROT_READ, MAP_SHARED, fd_, base);
+    if (addr_ == MAP_FAILED) {
+        addr_ = nullptr;
+        throw FailedSystemCall("mmap " + path_.asString(), Here());
+    }
+
+    header_ = reinterpret_cast<const Header*>(static_cast<const char*>(addr_) + (offset_ - base));
+
+    size_t width = hashedKeys_ ? sizeof(uint64_t) : keySize;
+    fences_ = reinterpret_cast<const char*>(header_) + sizeof(Header);
+    keys_ = fences_ + header_->nfences_ * width;
+    columns_ = reinterpret_cast<const uint64_t*>(keys_ + header_->count_ * width);
+
+    if (hashedKeys_) {
+        keyOffsets_ = reinterpret_cast<const uint32_t*>(columns_ + header_->count_ * NCOLUMNS);
+        heap_ = reinterpret_cast<const char*>(keyOffsets_ + header_->count_ + 1);
+    }
+
+    Log::debug<LibFdb5>() << "Mapped SortedArrayIndex " << path_ << ":" << offset_ << ", "
+                          << BigNum(header_->count_) << " entries, " << Bytes(header_->size_) << std::endl;
+}
+
+std::string SortedArrayIndex::key(size_t i) const {
+    if (hashedKeys_) {
+        return std::string(heap_ + keyOffsets_[i], keyOffsets_[i + 1] - keyOffsets_[i]);
+    }
+    const char* k = keys_ + i * keySize;
+    return std::string(k, ::strnlen(k, keySize));
+}
+
+FieldRef SortedArrayIndex::entry(size_t i) const {
+    size_t count = header_->count_;
+    return FieldRef(FieldRefLocation(columns_[URI * count + i], columns_[OFFSET * count + i], columns_[LENGTH * count + i]));
+}
+
+bool SortedArrayIndex::findFixed(const std::string& key, size_t& index) const {
+
+    char k[keySize];
+    padKey(key, k);
+
+    // Find the run that could contain the key: the last fence <= key
+
+    size_t lo = 0;
+    size_t hi = header_->nfences_;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (compareKey(fences_ + mid * keySize, k) <= 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    if (lo == 0) return false;
+
+    // And search within the run
+
+    size_t first = (lo - 1) * header_->fenceStride_;
+    size_t last = std::min<size_t>(first + header_->fenceStride_, header_->count_);
+
+    while (first < last) {
+        size_t mid = first + (last - first) / 2;
+        int c = compareKey(keys_ + mid * keySize, k);
+        if (c == 0) {
+            index = mid;
+            return true;
+        }
+        if (c < 0) {
+            first = mid + 1;
+        } else {
+            last = mid;
+        }
+    }
+
+    return false;
+}
+
+bool SortedArrayIndex::findHashed(const std::string& key, size_t& index) const {
+
+    uint64_t h = hash(key.c_str(), key.size());
+
+    const uint64_t* fences = reinterpret_cast<const uint64_t*>(fences_);
+    const uint64_t* hashes = reinterpret_cast<const uint64_t*>(keys_);
+    size_t count = header_->count_;
+
+    // The first entry with this hash is in the last run whose fence is < h (or at the start of
+    // the next run)
+
+    size_t run = std::lower_bound(fences, fences + header_->nfences_, h) - fences;
+    if (run > 0) --run;
+
+    size_t first = run * header_->fenceStride_;
+    size_t last = std::min<size_t>(first + header_->fenceStride_, count);
+
+    size_t i = std::lower_bound(hashes + first, hashes + last, h) - hashes;
+
+    // Resolve any collisions against the full keys
+
+    for (; i < count && hashes[i] == h; ++i) {
+        size_t length = keyOffsets_[i + 1] - keyOffsets_[i];
+        if (length == key.size() && ::memcmp(heap_ + keyOffsets_[i], key.c_str(), length) == 0) {
+            index = i;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool SortedArrayIndex::get(const std::string& key, FieldRef& data) const {
+
+    if (!readOnly_) {
+        auto it = entries_.find(key);
+        if (it == entries_.end()) return false;
+        data = it->second;
+        return true;
+    }
+
+    ASSERT(header_);
+
+    if (header_->count_ == 0) return false;
+
+    size_t i;
+    bool found = hashedKeys_ ? findHashed(key, i) : findFixed(key, i);
+    if (found) {
+        data = entry(i);
+    }
+    return found;
+}
+
+bool SortedArrayIndex::set(const std::string& key, const FieldRef& data) {
+    ASSERT(!readOnly_);
+
+    // Validate the key now, rather than at flush
+    if (!hashedKeys_) {
+        char k[keySize];
+        padKey(key, k);
+    }
+
+    auto r = entries_.insert(std::make_pair(key, data));
+    if (r.second) {
+        keyBytes_ += key.size();
+    } else {
+        r.first->second = data;
+    }
+
+    dirty_ = true;
+    return !r.second;
+}
+
+void SortedArrayIndex::encodeFixed(char* block, size_t count, size_t nfences) const {
+
+    char* fences = block + sizeof(Header);
+    char* keys = fences + nfences * keySize;
+    uint64_t* columns = reinterpret_cast<uint64_t*>(keys + count * keySize);
+
+    // std::map is ordered as std::string, which compares as unsigned chars, as does memcmp of
+    // the zero padded keys.
+
+    size_t i = 0;
+    for (const auto& e : entries_) {
+        padKey(e.first, keys + i * keySize);
+        if (i % fixedFenceStride == 0) {
+            ::memcpy(fences + (i / fixedFenceStride) * keySize, keys + i * keySize, keySize);
+        }
+        columns[URI * count + i] = e.second.uriId();
+        columns[OFFSET * count + i] = e.second.offset();
+        columns[LENGTH * count + i] = e.second.length();
+        ++i;
+    }
+}
+
+void SortedArrayIndex::encodeHashed(char* block, size_t count, size_t nfences) const {
+
+    uint64_t* fences = reinterpret_cast<uint64_t*>(block + sizeof(Header));
+    uint64_t* hashes = fences + nfences;
+    uint64_t* columns = hashes + count;
+    uint32_t* keyOffsets = reinterpret_cast<uint32_t*>(columns + count * NCOLUMNS);
+    char* heap = reinterpret_cast<char*>(keyOffsets + count + 1);
+
+    typedef std::map<std::string, FieldRef>::const_iterator entry_t;
+    std::vector<std::pair<uint64_t, entry_t>> sorted;
+    sorted.reserve(count);
+
+    for (entry_t e = entries_.begin(); e != entries_.end(); ++e) {
+        sorted.emplace_back(hash(e->first.c_str(), e->first.size()), e);
+    }
+
+    // Entries with the same hash are kept in the order of their keys
+    std::stable_sort(sorted.begin(), sorted.end(),
+                     [](const std::pair<uint64_t, entry_t>& a, const std::pair<uint64_t, entry_t>& b) {
+                         return a.first < b.first;
+                     });
+
+    uint32_t heapOffset = 0;
+    for (size_t i = 0; i < count; ++i) {
+        const std::string& k(sorted[i].second->first);
+        const FieldRef& ref(sorted[i].second->second);
+
+        hashes[i] = sorted[i].first;
+        if (i % hashedFenceStride == 0) {
+            fences[i / hashedFenceStride] = hashes[i];
+        }
+        columns[URI * count + i] = ref.uriId();
+        columns[OFFSET * count + i] = ref.offset();
+        columns[LENGTH * count + i] = ref.length();
+
+        keyOffsets[i] = heapOffset;
+        ::memcpy(heap + heapOffset, k.c_str(), k.size());
+        heapOffset += k.size();
+    }
+    keyOffsets[count] = heapOffset;
+}
+
+void SortedArrayIndex::flush() {
+    ASSERT(!readOnly_);
+
+    if (!dirty_) return;
+
+    size_t fenceStride = hashedKeys_ ? hashedFenceStride : fixedFenceStride;
+    size_t heapSize = hashedKeys_ ? keyBytes_ : 0;
+    ASSERT(heapSize <= std::numeric_limits<uint32_t>::max());
+
+    size_t count = entries_.size();
+    size_t nfences = (count + fenceStride - 1) / fenceStride;
+    size_t size = blockSize(hashedKeys_, count, nfences, heapSize);
+
+    Buffer buffer(size);
+    ::memset(buffer.data(), 0, size);
+
+    Header* hdr = reinterpret_cast<Header*>(buffer.data());
+    ::memcpy(hdr->magic_, magic, sizeof(magic));
+    hdr->version_ = version;
+    hdr->keySize_ = hashedKeys_ ? 0 : keySize;
+    hdr->count_ = count;
+    hdr->fenceStride_ = fenceStride;
+    hdr->nfences_ = nfences;
+    hdr->size_ = size;
+    hdr->heapSize_ = heapSize;
+
+    if (hashedKeys_) {
+        encodeHashed(static_cast<char*>(buffer.data()), count, nfences);
+    } else {
+        encodeFixed(static_cast<char*>(buffer.data()), count, nfences);
+    }
+
+    // n.b. The block is rewritten in place if the index is flushed again. TocCatalogueWriter
+    //      reopens its indexes after each flush, so the index is always at the end of the file.
+
+    const char* p = static_cast<const char*>(buffer.data());
+    size_t written = 0;
+    while (written < size) {
+        ssize_t len;
+        SYSCALL2((len = ::pwrite(fd_, p + written, size - written, offset_ + written)), path_);
+        written += len;
+    }
+
+    dirty_ = false;
+}
+
+void SortedArrayIndex::sync() {
+    if (!readOnly_) {
+        SYSCALL2(::fsync(fd_), path_);
+    }
+}
+
+void SortedArrayIndex::visit(BTreeIndexVisitor& visitor) const {
+
+    if (!readOnly_) {
+        for (const auto& e : entries_) {
+            visitor.visit(e.first, e.second);
+        }
+        return;
+    }
+
+    ASSERT(header_);
+
+    for (size_t i = 0; i < header_->count_; ++i) {
+        visitor.visit(key(i), entry(i));
+    }
+}
+
+void SortedArrayIndex::lock(short type) {
+    struct flock lock;
+    lock.l_type = type;
+    lock.l_whence = SEEK_SET;
+    lock.l_start = 0;
+    lock.l_len = 0;
+    SYSCALL2(::fcntl(fd_, F_SETLKW, &lock), path_);
+}
+
+void SortedArrayIndex::flock() {
+    lock(readOnly_ ? F_RDLCK : F_WRLCK);
+}
+
+void SortedArrayIndex::funlock() {
+    lock(F_UNLCK);
+}
+
+void SortedArrayIndex::dump(std::ostream& out, const char* indent) const {
+    const char* type = hashedKeys_ ? "HashedKeyIndex" : "SortedArrayIndex";
+    if (header_) {
+        out << indent << type << ": entries: " << header_->count_
+            << ", fences: " << header_->nfences_ << " (stride " << header_->fenceStride_ << ")"
+            << ", size: " << Bytes(header_->size_);
+        if (hashedKeys_) {
+            out << ", keys: " << Bytes(header_->heapSize_);
+        }
+        out << std::endl;
+    } else {
+        out << indent << type << ": entries: " << entries_.size() << " (in memory)" << std::endl;
+    }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+static BTreeIndexBuilder<SortedArrayIndex> sortedArrayIndex("SortedArrayIndex");
+static BTreeIndexBuilder<HashedKeyIndex> hashedKeyIndex("HashedKeyIndex");
+
+//----------------------------------------------------------------------------------------------------------------------
+
+} // namespace fdb5
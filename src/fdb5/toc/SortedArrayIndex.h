@@ -0,0 +1,148 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+/// @file   SortedArrayIndex.h
+/// @date   Oct 2026
+
+#ifndef fdb5_SortedArrayIndex_H
+#define fdb5_SortedArrayIndex_H
+
+#include <cstdint>
+#include <map>
+#include <string>
+
+#include "eckit/filesystem/PathName.h"
+
+#include "fdb5/toc/BTreeIndex.h"
+#include "fdb5/toc/FieldRef.h"
+
+namespace fdb5 {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/// An immutable index, stored as a sorted array. As a TocIndex is written once, and only read
+/// after it has been flushed, it has no need for the pages of a B-tree.
+///
+/// The entries are held in memory by the writer, and written out in a single block at flush().
+/// With fixed length keys (SortedArrayIndex):
+///
+///     Header
+///     fences   nfences x KEYSIZE     the first key of each run of fenceStride keys
+///     keys     count x KEYSIZE       sorted, zero padded
+///     uris     count x uint64
+///     offsets  count x uint64
+///     lengths  count x uint64
+///
+/// With variable length keys (HashedKeyIndex), which may be of any length, and are not padded,
+/// the entries are sorted by a 64 bit hash of the key instead. The full key is compared to
+/// resolve collisions:
+///
+///     Header                         keySize_ == 0
+///     fences   nfences x uint64      the first hash of each run of fenceStride hashes
+///     hashes   count x uint64        sorted
+///     uris     count x uint64
+///     offsets  count x uint64
+///     lengths  count x uint64
+///     keys     (count + 1) x uint32  the offset of each key in the heap
+///     heap     heapSize_ bytes
+///
+/// Readers map the block, and look a key up by a binary search of the fences (which are small,
+/// and usually resident) followed by a binary search within a single run of keys.
+///
+/// @note As with BTreeIndex, the FieldDetails are not stored.
+/// @note A HashedKeyIndex is visited in the order of the hashes, rather than of the keys
+
+class SortedArrayIndex : public BTreeIndex {
+
+public: // types
+
+    static const size_t keySize = 32;
+
+    struct Header {
+        char     magic_[8];
+        uint32_t version_;
+        uint32_t keySize_;      // 0 for variable length (hashed) keys
+        uint64_t count_;
+        uint64_t fenceStride_;
+        uint64_t nfences_;
+        uint64_t size_;         // of the whole block, including the header
+        uint64_t heapSize_;
+        char     spare_[8];
+    };
+
+public: // methods
+
+    SortedArrayIndex(const eckit::PathName& path, bool readOnly, off_t offset, bool hashedKeys = false);
+    ~SortedArrayIndex() override;
+
+    bool get(const std::string& key, FieldRef& data) const override;
+    bool set(const std::string& key, const FieldRef& data) override;
+    void flush() override;
+    void sync() override;
+    void visit(BTreeIndexVisitor& visitor) const override;
+    void flock() override;
+    void funlock() override;
+    void dump(std::ostream& out, const char* indent) const override;
+
+    /// The (persistent) hash of the variable length keys
+    static uint64_t hash(const char* key, size_t length);
+
+private: // methods
+
+    void map();
+    void lock(short type);
+
+    void encodeFixed(char* block, size_t count, size_t nfences) const;
+    void encodeHashed(char* block, size_t count, size_t nfences) const;
+
+    bool findFixed(const std::string& key, size_t& index) const;
+    bool findHashed(const std::string& key, size_t& index) const;
+
+    std::string key(size_t i) const;
+    FieldRef entry(size_t i) const;
+
+private: // members
+
+    eckit::PathName path_;
+    off_t offset_;
+    bool readOnly_;
+    bool hashedKeys_;
+
+    int fd_;
+
+    // Writer
+    std::map<std::string, FieldRef> entries_;
+    size_t keyBytes_;
+    bool dirty_;
+
+    // Reader
+    void* addr_;
+    size_t mapped_;
+    const Header* header_;
+    const char* fences_;
+    const char* keys_;
+    const uint64_t* columns_;
+    const uint32_t* keyOffsets_;
+    const char* heap_;
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+
+class HashedKeyIndex : public SortedArrayIndex {
+public:
+    HashedKeyIndex(const eckit::PathName& path, bool readOnly, off_t offset) :
+        SortedArrayIndex(path, readOnly, offset, true) {}
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+
+} // namespace fdb5
+
+#endif // fdb5_SortedArrayIndex_H
@@ -43,6 +43,7 @@ void TocCatalogueReader::loadIndexesAndRemap() {
     indexes_.reserve(remapKeys.size());
     for (size_t i = 0; i < remapKeys.size(); ++i) {
         indexes_.emplace_back(indexes[i], remapKeys[i]);
+        indexesByKey_[indexes[i].key()].push_back(i);
     }
 }
 
@@ -61,9 +62,11 @@ bool TocCatalogueReader::selectIndex(const Key &key) {
     matching_.clear();
 
 
-    for (auto idx = indexes_.begin(); idx != indexes_.end(); ++idx) {
-        if (idx->first.key() == key) {
-            matching_.push_back(*idx);
+    auto it = indexesByKey_.find(key);
+    if (it != indexesByKey_.end()) {
+        matching_.reserve(it->second.size());
+        for (size_t i : it->second) {
+            matching_.push_back(indexes_[i]);
         }
     }
 
@@ -93,8 +96,7 @@ bool TocCatalogueReader::open() {
 
 void TocCatalogueReader::axis(const std::string &keyword, eckit::StringSet &s) const {
     for (auto m = matching_.begin(); m != matching_.end(); ++m) {
-        const eckit::DenseSet<std::string>& a = m->first.axes().values(keyword);
-        s.insert(a.begin(), a.end());
+        m->first.axes().values(keyword, s);
     }
 }
 
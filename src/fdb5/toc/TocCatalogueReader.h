@@ -16,6 +16,9 @@
 #ifndef fdb5_TocCatalogueReader_H
 #define fdb5_TocCatalogueReader_H
 
+#include <unordered_map>
+#include <vector>
+
 #include "fdb5/toc/TocCatalogue.h"
 
 namespace fdb5 {
@@ -63,6 +66,9 @@ private: // members
     // If there is a key remapping for a mounted SubToc, this is stored alongside
     std::vector<std::pair<Index, Key>> indexes_;
 
+    // The positions in indexes_ of the indexes with each key, in TOC order
+    std::unordered_map<Key, std::vector<size_t>, KeyHash> indexesByKey_;
+
 };
 
 //----------------------------------------------------------------------------------------------------------------------
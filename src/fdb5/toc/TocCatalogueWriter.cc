@@ -217,6 +217,137 @@ void TocCatalogueWriter::reconsolidateIndexesAndTocs() {
     appendBlock(buf, combinedSize);
 }
 
+size_t TocCatalogueWriter::compactIndexes(size_t minimumIndexes) {
+
+    ASSERT(minimumIndexes > 1);
+
+    if (!enabled(ControlIdentifier::Archive)) {
+        std::ostringstream ss;
+        ss << "Cannot compact the indexes of " << directory_ << ", as archiving is disabled";
+        throw UserError(ss.str(), Here());
+    }
+
+    // If anything is written to the DB whilst the new indexes are being built, it would be
+    // hidden by them. In that case we give up, and the compaction may be retried.
+
+    size_t initialSize = tocFilesSize();
+
+    // Indexes in sub tocs are compacted by their writers (see compactSubTocIndexes), and those
+    // of mounted DBs belong to another DB. The remaining indexes are grouped by their key. As
+    // the indexes are returned in order of precedence, the first entry found for a key wins.
+    //
+    // The merged index is appended to the TOC, and so takes precedence over every index. A group
+    // is therefore left alone if an index with the same key, in a sub toc or a mounted DB, has
+    // precedence over any index of the group, as the merged index would hide it.
+
+    std::vector<bool> indexInSubtoc;
+    std::vector<Key> remapKeys;
+    std::vector<Index> readIndexes = loadIndexes(false, nullptr, &indexInSubtoc, &remapKeys);
+
+    ASSERT(readIndexes.size() == indexInSubtoc.size());
+    ASSERT(readIndexes.size() == remapKeys.size());
+
+    std::map<Key, std::vector<Index>> groups;
+    std::map<Key, size_t> lowestPrecedence;   // position of the oldest index of each group
+    std::map<Key, size_t> highestOther;       // position of the first other index with the key
+
+    for (size_t i = 0; i < readIndexes.size(); i++) {
+        const Key& key(readIndexes[i].key());
+        if (!indexInSubtoc[i] && remapKeys[i].empty()) {
+            groups[key].push_back(readIndexes[i]);
+            lowestPrecedence[key] = i;
+        } else {
+            highestOther.insert(std::make_pair(key, i));
+        }
+    }
+
+    std::vector<std::pair<Index, std::vector<Index>>> merged;
+    size_t nrecords = 0;
+
+    for (const auto& group : groups) {
+
+        const std::vector<Index>& indexes(group.second);
+        if (indexes.size() < minimumIndexes) continue;
+
+        auto other = highestOther.find(group.first);
+        if (other != highestOther.end() && other->second < lowestPrecedence[group.first]) {
+            Log::info() << "Not compacting the indexes of " << directory_ << " for " << group.first
+                        << ", as they are interleaved with those of a sub toc or mounted DB" << std::endl;
+            continue;
+        }
+
+        std::string type = indexes.front().type();
+        for (const Index& idx : indexes) {
+            if (idx.type() != type) {
+                type = TocIndex::defaulType();
+                break;
+            }
+        }
+
+        PathName indexPath(generateIndexPath(group.first));
+
+        if (stripeLustre()) {
+            fdb5LustreapiFileCreate(indexPath.localPath(), stripeIndexLustreSettings());
+        }
+
+        Index index(new TocIndex(group.first, indexPath, 0, TocIndex::WRITE, type));
+        TocIndex& target = dynamic_cast<TocIndex&>(*index.content());
+
+        index.open();
+        index.flock();
+
+        size_t entries = 0;
+        for (const Index& idx : indexes) {
+            entries += target.merge(dynamic_cast<const TocIndex&>(*idx.content()));
+        }
+
+        index.flush();
+        index.funlock();
+        index.close();
+
+        Log::info() << "Merged " << indexes.size() << " indexes (" << entries << " entries) into "
+                    << indexPath << std::endl;
+
+        merged.emplace_back(index, indexes);
+        nrecords += 1 + indexes.size();
+    }
+
+    if (merged.empty()) {
+        return 0;
+    }
+
+    // Add the new indexes, and mask the old ones, in one go
+
+    Buffer buf(sizeof(TocRecord) * nrecords);
+    size_t combinedSize = 0;
+    size_t replaced = 0;
+
+    for (const auto& m : merged) {
+
+        TocRecord* r = new (&buf[combinedSize]) TocRecord(serialisationVersion().used(), TocRecord::TOC_INDEX);
+        combinedSize += roundRecord(*r, buildIndexRecord(*r, m.first));
+
+        for (const Index& idx : m.second) {
+            r = new (&buf[combinedSize]) TocRecord(serialisationVersion().used(), TocRecord::TOC_CLEAR);
+            combinedSize += roundRecord(*r, buildClearRecord(*r, idx));
+            Log::info() << "Masking index: " << idx.location().uri() << std::endl;
+        }
+
+        replaced += m.second.size();
+    }
+
+    if (!appendBlockIfUnchanged(buf, combinedSize, initialSize)) {
+        Log::warning() << "The TOC of " << directory_ << " has been modified whilst compacting. "
+                       << "Abandoning compaction" << std::endl;
+        for (const auto& m : merged) {
+            dynamic_cast<const TocIndex&>(*m.first.content()).path().unlink();
+        }
+        return 0;
+    }
+
+    return replaced;
+}
+
 const Index& TocCatalogueWriter::currentIndex() {
 
     if (current_.null()) {
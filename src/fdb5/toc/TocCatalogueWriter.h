@@ -47,6 +47,8 @@ public: // methods
 
     void reconsolidate() override { reconsolidateIndexesAndTocs(); }
 
+    size_t compact(size_t minimumIndexes) override { return compactIndexes(minimumIndexes); }
+
     /// Mount an existing TocCatalogue, which has a different metadata key (within
     /// constraints) to allow on-line rebadging of data
     /// variableKeys: The keys that are allowed to differ between the two DBs
@@ -73,6 +75,10 @@ protected: // methods
     void archive(const Key& key, std::unique_ptr<FieldLocation> fieldLocation) override;
     void reconsolidateIndexesAndTocs();
 
+    /// Merge the indexes in the (master) TOC which share an index key into a single new index,
+    /// and mask the old ones. This may be run whilst the DB is being read or written.
+    size_t compactIndexes(size_t minimumIndexes);
+
     virtual void print( std::ostream &out ) const override;
 
 private: // methods
@@ -27,6 +27,7 @@
 
 #include "fdb5/LibFdb5.h"
 #include "fdb5/rules/Schema.h"
+#include "fdb5/toc/RootCatalogue.h"
 #include "fdb5/toc/RootManager.h"
 #include "fdb5/toc/TocEngine.h"
 #include "fdb5/toc/TocHandler.h"
@@ -38,7 +39,7 @@ namespace fdb5 {
 
 //----------------------------------------------------------------------------------------------------------------------
 
-void TocEngine::scan_dbs(const std::string& path, std::list<std::string>& dbs) const {
+void TocEngine::scan_dbs(const std::string& path, std::list<std::string>& dbs) {
 
     if ((eckit::PathName(path) / "toc").exists()) {
         dbs.push_back(path);
@@ -145,18 +146,30 @@ static void matchRequestToDB(const metkit::mars::MarsRequest& rq, std::set<Key>&
 
 static constexpr const char* regexForMissingValues = "[^:/]*";
 
-std::set<eckit::PathName> TocEngine::databases(const std::set<Key>& keys,
-                                               const std::vector<eckit::PathName>& roots,
-                                               const Config& config) const {
+std::map<eckit::PathName, Key> TocEngine::databases(const std::set<Key>& keys,
+                                                    const std::vector<eckit::PathName>& roots,
+                                                    const Config& config) const {
 
-    std::set<eckit::PathName> result;
+    std::map<eckit::PathName, Key> result;
 
     for (std::vector<eckit::PathName>::const_iterator j = roots.begin(); j != roots.end(); ++j) {
 
-        Log::debug<LibFdb5>() << "Scanning for TOC FDBs in root " << *j << std::endl;
+        // If the root has a (complete) catalogue of its databases, use that rather than walking
+        // the tree. The keys of catalogued databases are known, so their TOCs needn't be opened.
 
         std::list<std::string> dbs;
-        scan_dbs(*j, dbs);
+        std::map<std::string, Key> catalogued;
+
+        if (RootCatalogue::enabled() && RootCatalogue(*j).load(catalogued)) {
+            Log::debug<LibFdb5>() << "Using catalogue of TOC FDBs in root " << *j << std::endl;
+            for (const auto& db : catalogued) {
+                dbs.push_back(j->asString() + "/" + db.first);
+            }
+        } else {
+            Log::debug<LibFdb5>() << "Scanning for TOC FDBs in root " << *j << std::endl;
+            catalogued.clear();
+            scan_dbs(*j, dbs);
+        }
 
         for (std::set<Key>::const_iterator i = keys.begin(); i != keys.end(); ++i) {
 
@@ -179,7 +192,11 @@ std::set<eckit::PathName> TocEngine::databases(const std::set<Key>& keys,
                     }
 
                     if (re.match(*k)) {
-                        result.insert(*k);
+                        if (catalogued.empty()) {
+                            result[*k] = Key();
+                        } else if ((eckit::PathName(*k) / "toc").exists()) {
+                            result[*k] = catalogued[k->substr(j->asString().size() + 1)];
+                        }
                     }
                 }
             }
@@ -191,6 +208,14 @@ std::set<eckit::PathName> TocEngine::databases(const std::set<Key>& keys,
     return result;
 }
 
+static Key databaseKey(const eckit::PathName& path, const Key& catalogued, const Config& config) {
+    if (!catalogued.empty()) {
+        return catalogued;
+    }
+    TocHandler toc(path, config);
+    return toc.databaseKey();
+}
+
 std::vector<eckit::URI> TocEngine::databases(const Key& key,
                                                   const std::vector<eckit::PathName>& roots,
                                                   const Config& config) const {
@@ -201,13 +226,13 @@ std::vector<eckit::URI> TocEngine::databases(const Key& key,
 
     Log::debug<LibFdb5>() << "Matched DB schemas for key " << key << " -> keys " << keys << std::endl;
 
-    std::set<eckit::PathName> databasesMatchRegex(databases(keys, roots, config));
+    std::map<eckit::PathName, Key> databasesMatchRegex(databases(keys, roots, config));
 
     std::vector<eckit::URI> result;
-    for (const auto& path : databasesMatchRegex) {
+    for (const auto& db : databasesMatchRegex) {
+        const eckit::PathName& path(db.first);
         try {
-            TocHandler toc(path, config);
-            if (toc.databaseKey().match(key)) {
+            if (databaseKey(path, db.second, config).match(key)) {
                 Log::debug<LibFdb5>() << " found match with " << path << std::endl;
                 result.push_back(eckit::URI("toc", path));
             }
@@ -231,13 +256,13 @@ std::vector<eckit::URI> TocEngine::databases(const metkit::mars::MarsRequest& re
 
     Log::debug<LibFdb5>() << "Matched DB schemas for request " << request << " -> keys " << keys << std::endl;
 
-    std::set<eckit::PathName> databasesMatchRegex(databases(keys, roots, config));
+    std::map<eckit::PathName, Key> databasesMatchRegex(databases(keys, roots, config));
 
     std::vector<eckit::URI> result;
-    for (const auto& path : databasesMatchRegex) {
+    for (const auto& db : databasesMatchRegex) {
+        const eckit::PathName& path(db.first);
         try {
-            TocHandler toc(path, config);
-            if (toc.databaseKey().partialMatch(request)) {
+            if (databaseKey(path, db.second, config).partialMatch(request)) {
                 Log::debug<LibFdb5>() << " found match with " << path << std::endl;
                 result.push_back(eckit::URI("toc", path));
             }
@@ -16,7 +16,11 @@
 #ifndef fdb5_toc_TocEngine_H
 #define fdb5_toc_TocEngine_H
 
+#include <list>
+#include <map>
+
 #include "fdb5/database/Engine.h"
+#include "fdb5/database/Key.h"
 
 namespace fdb5 {
 
@@ -28,8 +32,11 @@ public: // methods
 
     static const char* typeName() { return "toc"; }
 
+    /// Walk the directory tree below path, to find the databases within it
+    static void scan_dbs(const std::string& path, std::list<std::string>& dbs);
+
 private:  // methods
-    std::set<eckit::PathName> databases(const std::set<Key>& keys, const std::vector<eckit::PathName>& dirs,
+    std::map<eckit::PathName, Key> databases(const std::set<Key>& keys, const std::vector<eckit::PathName>& dirs,
                                         const Config& config) const;
 
     std::vector<eckit::URI> databases(const Key& key, const std::vector<eckit::PathName>& dirs, const Config& config) const;
@@ -37,8 +44,6 @@ private:  // methods
     std::vector<eckit::URI> databases(const metkit::mars::MarsRequest& rq, const std::vector<eckit::PathName>& dirs,
                                       const Config& config) const;
 
-    void scan_dbs(const std::string& path, std::list<std::string>& dbs) const;
-
 protected: // methods
 
     virtual std::string name() const override;
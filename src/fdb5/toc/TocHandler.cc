@@ -9,12 +9,17 @@
  */
 
 #include <fcntl.h>
+#include <sys/file.h>
 #include <sys/types.h>
 #include <pwd.h>
 
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
 #include "eckit/config/Resource.h"
 #include "eckit/io/FileHandle.h"
-#include "eckit/io/FileDescHandle.h"
+#include "eckit/io/AutoClose.h"
 #include "eckit/log/BigNum.h"
 #include "eckit/log/Log.h"
 #include "eckit/maths/Functions.h"
@@ -25,6 +30,8 @@
 
 #include "fdb5/LibFdb5.h"
 #include "fdb5/database/Index.h"
+#include "fdb5/toc/DirectoryCache.h"
+#include "fdb5/toc/RootCatalogue.h"
 #include "fdb5/toc/TocCommon.h"
 #include "fdb5/toc/TocFieldLocation.h"
 #include "fdb5/toc/TocHandler.h"
@@ -57,6 +64,76 @@ const std::map<ControlIdentifier, const char*> controlfile_lookup {
 
 //----------------------------------------------------------------------------------------------------------------------
 
+// Records are appended under a shared lock of the TOC being written, so that the whole DB may be
+// frozen by taking the exclusive locks (see appendBlockIfUnchanged). These are flock() locks, which
+// belong to the open file, and so also exclude the other writers in the same process.
+
+class TocFileLock {
+public:
+    TocFileLock(int fd, const eckit::PathName& path, bool exclusive) :
+        fd_(fd), path_(path), owned_(false), locked_(lock(exclusive ? LOCK_EX : LOCK_SH)) {}
+
+    /// Opens the file to lock it exclusively, and closes it on release
+    explicit TocFileLock(const eckit::PathName& path) :
+        fd_(open(path)), path_(path), owned_(true), locked_(false) {
+        try {
+            locked_ = lock(LOCK_EX);
+        }
+        catch (...) {
+            ::close(fd_);
+            throw;
+        }
+    }
+
+    ~TocFileLock() {
+        if (locked_) {
+            ::flock(fd_, LOCK_UN);
+        }
+        if (owned_) {
+            ::close(fd_);
+        }
+    }
+
+private:
+    static int open(const eckit::PathName& path) {
+        int fd;
+        SYSCALL2((fd = ::open(path.localPath(), O_RDONLY)), path);
+        return fd;
+    }
+
+    bool lock(int operation) {
+        int ret;
+        while ((ret = ::flock(fd_, operation)) < 0 && errno == EINTR) {}
+
+        if (ret < 0) {
+            if (errno == ENOSYS || errno == EOPNOTSUPP) {
+                Log::debug<LibFdb5>() << "Cannot lock " << path_ << ", file locks are not supported" << std::endl;
+                return false;
+            }
+            throw eckit::FailedSystemCall("flock " + path_.asString(), Here());
+        }
+        return true;
+    }
+
+    int fd_;
+    eckit::PathName path_;
+    bool owned_;
+    bool locked_;
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+
+// The filter of an index follows the serialised index in its TOC_INDEX record, if present
+
+static void decodeIndexFilter(const TocRecord& r, size_t position, TocIndex& index) {
+    size_t payloadSize = r.header_.size_ - sizeof(TocRecord::Header);
+    if (position < payloadSize) {
+        index.decodeFilter(&r.payload_[position], payloadSize - position);
+    }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
 class TocHandlerCloser {
     const TocHandler& handler_;
   public:
@@ -71,16 +148,21 @@ class TocHandlerCloser {
 class CachedFDProxy {
 public: // methods
 
-    CachedFDProxy(const eckit::PathName& path, int fd, std::unique_ptr<eckit::MemoryHandle>& cached) :
+    CachedFDProxy(const eckit::PathName& path, int fd, const std::shared_ptr<const TocView>& cached, size_t& position) :
         path_(path),
         fd_(fd),
-        cached_(cached.get()) {
+        cached_(cached.get()),
+        position_(position) {
         ASSERT((fd != -1) != (!!cached));
     }
 
     long read(void* buf, long len) {
         if (cached_) {
-            return cached_->read(buf, len);
+            ASSERT(position_ <= cached_->size());
+            size_t n = std::min(size_t(len), cached_->size() - position_);
+            ::memcpy(buf, cached_->data() + position_, n);
+            position_ += n;
+            return n;
         } else {
             long ret;
             SYSCALL2( ret = ::read(fd_, buf, len), path_);
@@ -90,7 +172,7 @@ public: // methods
 
     Offset position() {
         if (cached_) {
-            return cached_->position();
+            return position_;
         } else {
             off_t pos;
             SYSCALL(pos = ::lseek(fd_, 0, SEEK_CUR));
@@ -100,7 +182,9 @@ public: // methods
 
     Offset seek(const Offset& pos) {
         if (cached_) {
-            return cached_->seek(pos);
+            ASSERT(size_t(pos) <= cached_->size());
+            position_ = pos;
+            return pos;
         } else {
             off_t ret;
             SYSCALL(ret = ::lseek(fd_, pos, SEEK_SET));
@@ -113,20 +197,23 @@ private: // members
 
     const eckit::PathName& path_;
     int fd_;
-    MemoryHandle* cached_;
+    const TocView* cached_;
+    size_t& position_;
 };
 
 //----------------------------------------------------------------------------------------------------------------------
 
-TocHandler::TocHandler(const eckit::PathName& directory, const Config& config) :
+TocHandler::TocHandler(const eckit::PathName& directory, const Config& config, const std::string& root) :
     TocCommon(directory),
     tocPath_(directory_ / "toc"),
     dbConfig_(config),
     serialisationVersion_(TocSerialisationVersion(config)),
     useSubToc_(config.userConfig().getBool("useSubToc", true)),
     isSubToc_(false),
+    root_(root),
     fd_(-1),
     cachedToc_(nullptr),
+    cachedPosition_(0),
     count_(0),
     enumeratedMaskedEntries_(false),
     writeMode_(false)
@@ -149,6 +236,7 @@ TocHandler::TocHandler(const eckit::PathName& path, const Key& parentKey) :
     isSubToc_(true),
     fd_(-1),
     cachedToc_(nullptr),
+    cachedPosition_(0),
     count_(0),
     enumeratedMaskedEntries_(false),
     writeMode_(false)
@@ -249,7 +337,7 @@ void TocHandler::openForRead() const {
 
     if (cachedToc_) {
         ASSERT(not writeMode_);
-        cachedToc_->seek(0);
+        cachedPosition_ = 0;
         return;
     }
 
@@ -269,48 +357,30 @@ void TocHandler::openForRead() const {
         iomode |= O_NOATIME;
     }
 #endif
-    SYSCALL2((fd_ = ::open( tocPath_.localPath(), iomode )), tocPath_ );
-    eckit::Length tocSize = tocPath_.size();
 
     // The masked subtocs and indexes could be updated each time, so reset this.
     enumeratedMaskedEntries_ = false;
     maskedEntries_.clear();
 
     if(fdbCacheTocsOnRead) {
-
-        FileDescHandle toc(fd_, true); // closes the file descriptor
-        AutoClose closer1(toc);
-        fd_ = -1;
-
-
-        bool grow = true;
-        cachedToc_.reset( new eckit::MemoryHandle(tocSize, grow) );
-
-        long buffersize = 4*1024*1024;
-        toc.copyTo(*cachedToc_, buffersize, tocSize, tocReadStats_);
-        cachedToc_->openForRead();
+        cachedToc_ = TocView::open(tocPath_, iomode);
+        cachedPosition_ = 0;
+        return;
     }
+
+    SYSCALL2((fd_ = ::open( tocPath_.localPath(), iomode )), tocPath_ );
 }
 
 void TocHandler::dumpTocCache() const {
     if (cachedToc_) {
-        eckit::Offset offset = cachedToc_->position();
-        cachedToc_->seek(0);
-
         eckit::PathName tocDumpFile("dump_of_"+tocPath_.baseName());
         eckit::FileHandle dump(eckit::PathName::unique(tocDumpFile));
-        cachedToc_->copyTo(dump);
-
-        std::ostringstream ss;
-        ss << tocPath_.baseName() << " read in " << tocReadStats_.size() << " step" << ((tocReadStats_.size()>1)?"s":"") << std::endl;
-        double time;
-        eckit::Length len;
-        while (tocReadStats_.next(time, len)) {
-            ss << "  step duration: " << (time*1000) << " ms, size: " << len << " bytes"<< std::endl;
-        }
-        Log::error() << ss.str();
+        dump.openForWrite(cachedToc_->size());
+        AutoClose closer(dump);
+        dump.write(cachedToc_->data(), cachedToc_->size());
 
-        cachedToc_->seek(offset);
+        Log::error() << tocPath_.baseName() << " mapped with " << cachedToc_->numberOfRecords() << " records ("
+                     << cachedToc_->size() << " bytes), read position " << cachedPosition_ << std::endl;
     }
 }
 
@@ -324,6 +394,8 @@ void TocHandler::append(TocRecord &r, size_t payloadSize ) {
     // Obtain the rounded size, and set it in the record header.
     size_t roundedSize = roundRecord(r, payloadSize);
 
+    TocFileLock lock(fd_, tocPath_, false);
+
     size_t len;
     SYSCALL2( len = ::write(fd_, &r, roundedSize), tocPath_ );
     dirty_ = true;
@@ -342,12 +414,53 @@ void TocHandler::appendBlock(const void *data, size_t size) {
 
     ASSERT(size % recordRoundSize() == 0);
 
+    TocFileLock lock(fd_, tocPath_, false);
+
     size_t len;
     SYSCALL2( len = ::write(fd_, data, size), tocPath_ );
     dirty_ = true;
     ASSERT( len == size );
 }
 
+bool TocHandler::appendBlockIfUnchanged(const void *data, size_t size, size_t tocFilesSize) {
+
+    // n.b. a sub toc registered after this list is made is first recorded in the (locked) TOC,
+    //      which changes its size
+
+    std::vector<eckit::PathName> subtocs = subTocPaths();
+
+    openForAppend();
+    TocHandlerCloser close(*this);
+
+    ASSERT(fd_ != -1);
+    ASSERT(not cachedToc_);
+    ASSERT(size % recordRoundSize() == 0);
+
+    // Lock the TOC, and then the sub tocs, so that nothing is appended to the DB until we are done
+
+    TocFileLock lock(fd_, tocPath_, true);
+
+    std::vector<std::unique_ptr<TocFileLock>> subtocLocks;
+
+    size_t currentSize = tocPath_.size();
+
+    for (const eckit::PathName& path : subtocs) {
+        subtocLocks.emplace_back(new TocFileLock(path));
+        currentSize += path.size();
+    }
+
+    if (currentSize != tocFilesSize) {
+        return false;
+    }
+
+    size_t len;
+    SYSCALL2( len = ::write(fd_, data, size), tocPath_ );
+    dirty_ = true;
+    ASSERT( len == size );
+
+    return true;
+}
+
 const TocSerialisationVersion& TocHandler::serialisationVersion() const {
     return serialisationVersion_;
 }
@@ -477,7 +590,7 @@ bool TocHandler::readNext( TocRecord &r, bool walkSubTocs, bool hideSubTocEntrie
 // readNextInternal reads the next TOC entry from this toc.
 bool TocHandler::readNextInternal(TocRecord& r) const {
 
-    CachedFDProxy proxy(tocPath_, fd_, cachedToc_);
+    CachedFDProxy proxy(tocPath_, fd_, cachedToc_, cachedPosition_);
 
     try {
         long len = proxy.read(&r, sizeof(TocRecord::Header));
@@ -580,7 +693,7 @@ void TocHandler::close() const {
 void TocHandler::allMaskableEntries(Offset startOffset, Offset endOffset,
                                     std::set<std::pair<PathName, Offset>>& maskedEntries) const {
 
-    CachedFDProxy proxy(tocPath_, fd_, cachedToc_);
+    CachedFDProxy proxy(tocPath_, fd_, cachedToc_, cachedPosition_);
 
     // Start reading entries where we are told to
 
@@ -632,10 +745,18 @@ void TocHandler::allMaskableEntries(Offset startOffset, Offset endOffset,
 void TocHandler::populateMaskedEntriesList() const {
 
     ASSERT(fd_ != -1 || cachedToc_);
-    CachedFDProxy proxy(tocPath_, fd_, cachedToc_);
+    CachedFDProxy proxy(tocPath_, fd_, cachedToc_, cachedPosition_);
 
     Offset startPosition = proxy.position(); // remember the current position of the file descriptor
 
+    // The masks for the whole of a (shared) mapped TOC only need enumerating once
+
+    bool shareable = (cachedToc_ && startPosition == Offset(0));
+    if (shareable && cachedToc_->maskedEntries(maskedEntries_)) {
+        enumeratedMaskedEntries_ = true;
+        return;
+    }
+
     maskedEntries_.clear();
 
     std::unique_ptr<TocRecord> r(new TocRecord(serialisationVersion_.used())); // allocate (large) TocRecord on heap not stack (MARS-779)
@@ -687,6 +808,10 @@ void TocHandler::populateMaskedEntriesList() const {
     Offset ret = proxy.seek(startPosition);
     ASSERT(ret == startPosition);
 
+    if (shareable) {
+        cachedToc_->maskedEntries(maskedEntries_);
+    }
+
     enumeratedMaskedEntries_ = true;
 }
 
@@ -755,6 +880,15 @@ void TocHandler::writeInitRecord(const Key &key) {
         append(*r2, s.position());
         dbUID_ = r2->header_.uid_;
 
+        // n.b. only once the TOC exists, so that a concurrent build of the root's catalogue
+        //      either finds it in the tree, or is already there to be appended to.
+        if (!isSubToc_) {
+            if (!root_.empty()) {
+                RootCatalogue::databaseCreated(root_, directory_, key);
+            }
+            DirectoryCache::instance().invalidate(directory_);
+        }
+
     } else {
         ASSERT(r->header_.tag_ == TocRecord::TOC_INIT);
         eckit::MemoryStream s(&r->payload_[0], r->maxPayloadSize);
@@ -917,6 +1051,20 @@ uid_t TocHandler::dbUID() const {
     openForRead();
     TocHandlerCloser close(*this);
 
+    // The first record in the TOC is the TOC_INIT. Read it directly if mapped.
+
+    if (cachedToc_) {
+        if (cachedToc_->numberOfRecords() != 0 && cachedToc_->header(0).tag_ == TocRecord::TOC_INIT) {
+            if (parentKey_.empty()) {
+                eckit::MemoryStream s(cachedToc_->payload(0), cachedToc_->payloadSize(0));
+                parentKey_ = Key(s);
+            }
+            dbUID_ = cachedToc_->header(0).uid_;
+            return dbUID_;
+        }
+        throw eckit::SeriousBug("Cannot find a TOC_INIT record");
+    }
+
     // Allocate (large) TocRecord on heap not stack (MARS-779)
     std::unique_ptr<TocRecord> r(new TocRecord(serialisationVersion_.used()));
 
@@ -934,6 +1082,18 @@ Key TocHandler::databaseKey() {
     openForRead();
     TocHandlerCloser close(*this);
 
+    if (cachedToc_) {
+        if (cachedToc_->numberOfRecords() != 0 && cachedToc_->header(0).tag_ == TocRecord::TOC_INIT) {
+            serialisationVersion_.check(cachedToc_->header(0).serialisationVersion_, true);
+            eckit::MemoryStream s(cachedToc_->payload(0), cachedToc_->payloadSize(0));
+            Key key(s);
+            if (parentKey_.empty()) parentKey_ = key;
+            dbUID_ = cachedToc_->header(0).uid_;
+            return key;
+        }
+        throw eckit::SeriousBug("Cannot find a TOC_INIT record");
+    }
+
     // Allocate (large) TocRecord on heap not stack (MARS-779)
     std::unique_ptr<TocRecord> r(new TocRecord(serialisationVersion_.used()));
 
@@ -1019,7 +1179,11 @@ std::vector<Index> TocHandler::loadIndexes(bool sorted,
             s >> offset;
             s >> type;
             LOG_DEBUG(debug, LibFdb5) << "TocRecord TOC_INDEX " << path << " - " << offset << std::endl;
-            indexes.push_back( new TocIndex(s, r->header_.serialisationVersion_, currentDirectory(), currentDirectory() / path, offset) );
+            {
+                TocIndex* index = new TocIndex(s, r->header_.serialisationVersion_, currentDirectory(), currentDirectory() / path, offset);
+                decodeIndexFilter(*r, s.position(), *index);
+                indexes.push_back(index);
+            }
 
             if (subTocs != 0 && subTocRead_) {
                 subTocs->insert(subTocRead_->tocPath());
@@ -1182,7 +1346,9 @@ void TocHandler::dumpIndexFile(std::ostream& out, const eckit::PathName& indexFi
                 if ((currentDirectory() / path).sameAs(indexFile)) {
                     r->dump(out, true);
                     out << std::endl << "  Path: " << path << ", offset: " << offset << ", type: " << type;
-                    Index index(new TocIndex(s, r->header_.serialisationVersion_, currentDirectory(), currentDirectory() / path, offset));
+                    TocIndex* tocIndex = new TocIndex(s, r->header_.serialisationVersion_, currentDirectory(), currentDirectory() / path, offset);
+                    decodeIndexFilter(*r, s.position(), *tocIndex);
+                    Index index(tocIndex);
                     index.dump(out, "  ", false, true);
                 }
                 break;
@@ -1355,7 +1521,14 @@ size_t TocHandler::buildIndexRecord(TocRecord& r, const Index &index) {
     s << index.type();
     index.encode(s, r.header_.serialisationVersion_);
 
-    return s.position();
+    size_t size = s.position();
+
+    const TocIndex* tocIndex = dynamic_cast<const TocIndex*>(index.content());
+    if (tocIndex) {
+        size += tocIndex->encodeFilter(&r.payload_[size], r.maxPayloadSize - size);
+    }
+
+    return size;
 }
 
 size_t TocHandler::buildClearRecord(TocRecord &r, const Index &index) {
@@ -1445,6 +1618,12 @@ void TocHandler::control(const ControlAction& action, const ControlIdentifiers&
                                   << std::endl;
         }
     }
+
+    // Whether duplicate databases are allowed changes where the database is found
+    // n.b. enabled() is false if the identifier is in the set
+    if (!identifiers.enabled(ControlIdentifier::UniqueRoot)) {
+        DirectoryCache::instance().invalidate(directory_);
+    }
 }
 
 bool TocHandler::enabled(const ControlIdentifier& controlIdentifier) const {
@@ -20,8 +20,6 @@
 #include "eckit/filesystem/PathName.h"
 #include "eckit/filesystem/URI.h"
 #include "eckit/io/Length.h"
-#include "eckit/io/MemoryHandle.h"
-#include "eckit/log/Timer.h"
 
 #include "fdb5/config/Config.h"
 #include "fdb5/database/DbStats.h"
@@ -29,6 +27,7 @@
 #include "fdb5/toc/TocCommon.h"
 #include "fdb5/toc/TocRecord.h"
 #include "fdb5/toc/TocSerialisationVersion.h"
+#include "fdb5/toc/TocView.h"
 
 
 
@@ -45,52 +44,6 @@ class Index;
 
 extern const std::map<ControlIdentifier, const char*> controlfile_lookup;
 
-//----------------------------------------------------------------------------------------------------------------------
-class TocCopyWatcher : public eckit::TransferWatcher {
-
-    void fromHandleOpened() override {
-        timer_.start();
-        time_ = timer_.elapsed();
-    }
-
-    void toHandleOpened() override {
-        timer_.start();
-        time_ = timer_.elapsed();
-    }
-
-    void watch(const void*, long len) override {
-        double now = timer_.elapsed();
-        tocCopyStats_.push_back(std::make_pair(now - time_, len));
-        time_ = now;
-    }
-    
-public:
-    TocCopyWatcher(): idx_(0) {}
-
-    size_t size() const {
-        return tocCopyStats_.size();
-    }
-
-    bool next(double& time, eckit::Length& len) {
-        if (tocCopyStats_.size()>idx_) {
-            time = tocCopyStats_[idx_].first;
-            len = tocCopyStats_[idx_].second;
-
-            idx_++;
-            return true;
-        }
-        return false;
-    }
-
-private:
-    eckit::Timer timer_;
-    double time_;
-
-    size_t idx_;
-    std::vector<std::pair<double, eckit::Length>> tocCopyStats_;
-
-};
-
 //-----------------------------------------------------------------------------
 
 class TocHandler : public TocCommon, private eckit::NonCopyable {
@@ -104,7 +57,8 @@ public: // methods
 
     TocHandler( const Key &key, const Config& config);
 
-    TocHandler( const eckit::PathName &dir, const Config& config);
+    /// @param root  the root containing the DB, if known, whose catalogue records its creation
+    TocHandler( const eckit::PathName &dir, const Config& config, const std::string& root = std::string());
 
     /// For initialising sub tocs or diagnostic interrogation.
     TocHandler(const eckit::PathName& path, const Key& parentKey);
@@ -196,6 +150,10 @@ protected: // methods
 
     void appendBlock(const void* data, size_t size);
 
+    /// Appends the block only if the TOC files are still of the given size, checked with the DB locked
+    /// against all other appends. Returns false if the DB has been modified.
+    bool appendBlockIfUnchanged(const void* data, size_t size, size_t tocFilesSize);
+
     const TocSerialisationVersion& serialisationVersion() const;
 
 private: // methods
@@ -239,14 +197,16 @@ private: // members
     bool useSubToc_;
     bool isSubToc_;
 
+    std::string root_;
+
     // If we have mounted another TocCatalogue internally, what is the current
     // remapping key?
     Key remapKey_;
 
     mutable int fd_;      ///< file descriptor, if zero file is not yet open.
 
-    mutable TocCopyWatcher tocReadStats_;
-    mutable std::unique_ptr<eckit::MemoryHandle> cachedToc_; ///< this is only for read path
+    mutable std::shared_ptr<const TocView> cachedToc_; ///< this is only for read path
+    mutable size_t cachedPosition_;
 
     /// The sub toc is initialised in the read or write pathways for maintaining state.
     mutable std::unique_ptr<TocHandler> subTocRead_;
@@ -8,6 +8,8 @@
  * does it submit to any jurisdiction.
  */
 
+#include <map>
+
 #include "eckit/log/BigNum.h"
 
 #include "fdb5/LibFdb5.h"
@@ -104,6 +106,9 @@ void TocIndex::reopen() {
 
     location_.offset_ = location_.path_.size();
 
+    keyHashes_.clear();
+    filter_ = BloomFilter();
+
     // The axes object must be reset at this point, as the TocIndex object is no longer referring
     // to the same region in memory. (i.e. the index is still associated with the same metadata
     // at the second level of the schema, but is a NEW index).
@@ -126,8 +131,14 @@ void TocIndex::add(const Key &key, const Field &field) {
 
     FieldRef ref(files_, field);
 
+    std::string fingerprint = key.valuesToString();
+
     //  bool replace =
-    btree_->set(key.valuesToString(), ref); // returns true if replace, false if new insert
+    btree_->set(fingerprint, ref); // returns true if replace, false if new insert
+
+    if (BloomFilter::bitsPerKey() != 0) {
+        keyHashes_.push_back(BloomFilter::hash(fingerprint));
+    }
 
     dirty_ = true;
 
@@ -141,6 +152,13 @@ void TocIndex::flush() {
         ASSERT(btree_);
         btree_->flush();
         btree_->sync();
+
+        // n.b. replaced keys are inserted more than once, which does no harm
+        filter_ = BloomFilter(keyHashes_.size(), BloomFilter::bitsPerKey());
+        for (uint64_t h : keyHashes_) {
+            filter_.insert(h);
+        }
+
         takeTimestamp();
         dirty_ = false;
     }
@@ -160,6 +178,28 @@ void TocIndex::funlock() const {
     btree_->funlock();
 }
 
+bool TocIndex::mayContain(const Key& key) const {
+
+    if (!IndexBase::mayContain(key)) {
+        return false;
+    }
+
+    // While writing, the filter only describes the last flush
+    if (mode_ != TocIndex::READ || filter_.empty()) {
+        return true;
+    }
+
+    return filter_.mayContain(BloomFilter::hash(key.valuesToString()));
+}
+
+size_t TocIndex::encodeFilter(void* data, size_t length) const {
+    return filter_.encode(data, length);
+}
+
+void TocIndex::decodeFilter(const void* data, size_t length) {
+    filter_.decode(data, length);
+}
+
 class TocIndexVisitor : public BTreeIndexVisitor {
     const UriStore &files_;
     EntryVisitor &visitor_;
@@ -186,6 +226,65 @@ void TocIndex::entries(EntryVisitor &visitor) const {
     }
 }
 
+class TocIndexMerger : public BTreeIndexVisitor {
+    BTreeIndex& btree_;
+    UriStore& files_;
+    const UriStore& otherFiles_;
+    std::vector<uint64_t>& keyHashes_;
+    std::map<UriStore::UriID, UriStore::UriID> uris_;
+    size_t added_;
+public:
+    TocIndexMerger(BTreeIndex& btree, UriStore& files, const UriStore& otherFiles, std::vector<uint64_t>& keyHashes) :
+        btree_(btree),
+        files_(files),
+        otherFiles_(otherFiles),
+        keyHashes_(keyHashes),
+        added_(0) {}
+
+    size_t added() const { return added_; }
+
+    void visit(const std::string& keyFingerprint, const FieldRef& ref) {
+
+        FieldRef existing;
+        if (btree_.get(keyFingerprint, existing)) {
+            return;
+        }
+
+        // The data files are numbered independently in each index
+
+        auto it = uris_.find(ref.uriId());
+        if (it == uris_.end()) {
+            it = uris_.emplace(ref.uriId(), files_.insert(otherFiles_.get(ref.uriId()))).first;
+        }
+
+        btree_.set(keyFingerprint, FieldRef(FieldRefLocation(it->second, ref.offset(), ref.length())));
+
+        if (BloomFilter::bitsPerKey() != 0) {
+            keyHashes_.push_back(BloomFilter::hash(keyFingerprint));
+        }
+
+        ++added_;
+    }
+};
+
+size_t TocIndex::merge(const TocIndex& other) {
+    ASSERT(btree_);
+    ASSERT( mode_ == TocIndex::WRITE );
+
+    TocIndexCloser closer(other);
+
+    TocIndexMerger merger(*btree_, files_, other.files_, keyHashes_);
+    other.btree_->visit(merger);
+
+    axes_.merge(other.axes_);
+
+    if (merger.added() != 0) {
+        dirty_ = true;
+    }
+
+    return merger.added();
+}
+
 void TocIndex::print(std::ostream &out) const {
     out << "TocIndex(path=" << location_.path_ << ",offset="<< location_.offset_ << ")";
 }
@@ -226,15 +325,18 @@ void TocIndex::dump(std::ostream &out, const char* indent, bool simple, bool dum
         out << std::endl;
         files_.dump(out, indent);
         axes_.dump(out, indent);
+        out << indent << "Filter: " << filter_ << std::endl;
     }
 
     if (dumpFields) {
         DumpBTreeVisitor v(out, std::string(indent) + std::string("  "));
 
         out << std::endl;
-        out << indent << "Contents of index: " << std::endl;
 
         TocIndexCloser closer(*this);
+        btree_->dump(out, indent);
+
+        out << indent << "Contents of index: " << std::endl;
         btree_->visit(v);
     }
 }
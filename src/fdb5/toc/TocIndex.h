@@ -26,6 +26,7 @@
 
 #include "fdb5/database/Index.h"
 #include "fdb5/database/UriStore.h"
+#include "fdb5/toc/BloomFilter.h"
 #include "fdb5/toc/TocIndexLocation.h"
 
 namespace fdb5 {
@@ -78,7 +79,20 @@ public: // methods
 
     void flock() const override;
     void funlock() const override;
-    
+
+    bool mayContain(const Key& key) const override;
+
+    /// The filter of the keys in the index is appended to the TOC_INDEX record, after the
+    /// (serialised) index, where older software ignores it.
+    size_t encodeFilter(void* data, size_t length) const;
+    void decodeFilter(const void* data, size_t length);
+
+    /// Add the entries of another index which are not already present in this one, so that
+    /// entries merged earlier take precedence. The entries are copied by their fingerprint,
+    /// without reference to the schema.
+    /// @returns the number of entries added
+    size_t merge(const TocIndex& other);
+
 private: // methods
 
     const IndexLocation& location() const override { return location_; }
@@ -109,6 +123,10 @@ private: // members
 
     bool dirty_;
 
+    // The hashes of the keys added since the index was (re)opened, from which the filter is built
+    std::vector<uint64_t> keyHashes_;
+    BloomFilter filter_;
+
     friend class TocIndexCloser;
 
     const TocIndex::Mode mode_;
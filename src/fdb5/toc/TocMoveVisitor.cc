@@ -17,6 +17,8 @@
 
 #include "fdb5/api/helpers/ControlIterator.h"
 #include "fdb5/database/DB.h"
+#include "fdb5/toc/DirectoryCache.h"
+#include "fdb5/toc/RootCatalogue.h"
 #include "fdb5/toc/TocCatalogue.h"
 #include "fdb5/toc/TocMoveVisitor.h"
 #include "fdb5/toc/RootManager.h"
@@ -146,6 +148,11 @@ void TocMoveVisitor::move() {
             pool.push(new FileCopy(catalogue_.basePath(), dest_db, "toc"));
             pool.wait();
 
+            // n.b. once the TOC has been copied, as for a database created in place
+
+            RootCatalogue::databaseCreated(destPath, dest_db, catalogue_.key());
+            DirectoryCache::instance().invalidate(dest_db);
+
             if (removeSrc_) {
                 sleep(removeDelay_);
 
@@ -172,6 +179,10 @@ void TocMoveVisitor::move() {
                 
                 eckit::Log::debug<LibFdb5>() << "Removing " << catalogue_.basePath() << std::endl;
                 catalogue_.basePath().rmdir(false);
+
+                RootCatalogue::databaseWiped(CatalogueRootManager(catalogue_.config()).allRoots(catalogue_.key()),
+                                             catalogue_.basePath());
+                DirectoryCache::instance().invalidate(catalogue_.basePath());
             }
         }
     }
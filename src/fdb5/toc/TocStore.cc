@@ -23,10 +23,12 @@
 #include "fdb5/rules/Rule.h"
 #include "fdb5/database/FieldLocation.h"
 #include "fdb5/toc/TocFieldLocation.h"
+#include "fdb5/toc/RootCatalogue.h"
 #include "fdb5/toc/RootManager.h"
 #include "fdb5/toc/TocPurgeVisitor.h"
 #include "fdb5/toc/TocStats.h"
 #include "fdb5/toc/TocStore.h"
+#include "fdb5/io/DirectFileHandle.h"
 #include "fdb5/io/FDBFileHandle.h"
 #include "fdb5/io/LustreFileHandle.h"
 
@@ -37,7 +39,10 @@ namespace fdb5 {
 //----------------------------------------------------------------------------------------------------------------------
 
 TocStore::TocStore(const Schema& schema, const Key& key, const Config& config) :
-    Store(schema), TocCommon(StoreRootManager(config).directory(key).directory_) {}
+    TocStore(schema, StoreRootManager(config).directory(key)) {}
+
+TocStore::TocStore(const Schema& schema, const TocPath& tocPath) :
+    Store(schema), TocCommon(tocPath.directory_), root_(tocPath.root_) {}
 
 TocStore::TocStore(const Schema& schema, const eckit::URI& uri, const Config& config) :
     Store(schema), TocCommon(uri.path().dirName()) {}
@@ -128,14 +133,14 @@ eckit::DataHandle *TocStore::createFileHandle(const eckit::PathName &path) {
                                      << " buffer size " << sizeBuffer
                                      << std::endl;
 
-        return new LustreFileHandle<FDBFileHandle>(path, sizeBuffer, stripeDataLustreSettings());
+        return new LustreFileHandle<FDBFileHandle>(path, sizeBuffer, root_, stripeDataLustreSettings());
     }
 
     eckit::Log::debug<LibFdb5>() << "Creating FDBFileHandle to " << path
                                  << " with buffer of " << eckit::Bytes(sizeBuffer)
                                  << std::endl;
 
-    return new FDBFileHandle(path, sizeBuffer);
+    return new FDBFileHandle(path, sizeBuffer, root_);
 }
 
 eckit::DataHandle *TocStore::createAsyncHandle(const eckit::PathName &path) {
@@ -156,12 +161,34 @@ eckit::DataHandle *TocStore::createAsyncHandle(const eckit::PathName &path) {
     return new eckit::AIOHandle(path, nbBuffers, sizeBuffer);
 }
 
+eckit::DataHandle *TocStore::createDirectHandle(const eckit::PathName &path) {
+
+    static size_t nbBuffers  = eckit::Resource<unsigned long>("fdbNbDirectBuffers", 4);
+    static size_t sizeBuffer = eckit::Resource<unsigned long>("fdbSizeDirectBuffer", 16 * 1024 * 1024);
+
+    if(stripeLustre()) {
+
+        eckit::Log::debug<LibFdb5>() << "Creating LustreFileHandle<DirectFileHandle> to " << path
+                                     << " with " << nbBuffers
+                                     << " buffer each with " << eckit::Bytes(sizeBuffer)
+                                     << std::endl;
+
+        return new LustreFileHandle<DirectFileHandle>(path, nbBuffers, sizeBuffer, root_, stripeDataLustreSettings());
+    }
+
+    return new DirectFileHandle(path, nbBuffers, sizeBuffer, root_);
+}
+
 eckit::DataHandle *TocStore::createDataHandle(const eckit::PathName &path) {
 
     static bool fdbWriteToNull = eckit::Resource<bool>("fdbWriteToNull;$FDB_WRITE_TO_NULL", false);
     if(fdbWriteToNull)
         return new eckit::EmptyHandle();
 
+    static bool fdbDirectWrite = eckit::Resource<bool>("fdbDirectWrite;$FDB_DIRECT_WRITE", false);
+    if(fdbDirectWrite)
+        return createDirectHandle(path);
+
     static bool fdbAsyncWrite = eckit::Resource<bool>("fdbAsyncWrite;$FDB_ASYNC_WRITE", false);
     if(fdbAsyncWrite)
         return createAsyncHandle(path);
@@ -283,6 +310,8 @@ void TocStore::moveTo(const Key& key, const Config& config, const eckit::URI& de
                 }
                 pool.wait();
             }
+
+            RootCatalogue::databaseCreated(destPath, dest_db, key);
         }
     }
 }
@@ -301,6 +330,10 @@ void TocStore::remove(const Key& key) const {
         }
     }
     closedir(dirp);
+
+    if (!root_.empty()) {
+        RootCatalogue::databaseWiped({eckit::PathName(root_)}, src_db);
+    }
 }
 
 void TocStore::print(std::ostream &out) const {
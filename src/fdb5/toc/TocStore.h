@@ -20,6 +20,7 @@
 #include "fdb5/database/Index.h"
 #include "fdb5/database/Store.h"
 #include "fdb5/rules/Schema.h"
+#include "fdb5/toc/FileSpace.h"
 #include "fdb5/toc/TocCommon.h"
 #include "fdb5/toc/TocEngine.h"
 
@@ -65,6 +66,7 @@ protected: // methods
     void closeDataHandles();
     eckit::DataHandle *createFileHandle(const eckit::PathName &path);
     eckit::DataHandle *createAsyncHandle(const eckit::PathName &path);
+    eckit::DataHandle *createDirectHandle(const eckit::PathName &path);
     eckit::DataHandle *createDataHandle(const eckit::PathName &path);
     eckit::DataHandle& getDataHandle( const eckit::PathName &path );
     eckit::PathName generateDataPath(const Key &key) const;
@@ -73,6 +75,10 @@ protected: // methods
 
     void print( std::ostream &out ) const override;
 
+private: // methods
+
+    TocStore(const Schema& schema, const TocPath& tocPath);
+
 private: // types
 
     typedef std::map< std::string, eckit::DataHandle * >  HandleStore;
@@ -84,6 +90,8 @@ private: // members
 
     mutable PathStore   dataPaths_;
 
+    std::string root_;  ///< the root containing the store, if known, in whose statistics the writes are recorded
+
 };
 
 //----------------------------------------------------------------------------------------------------------------------
@@ -0,0 +1,154 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <map>
+
+#include "eckit/exception/Exceptions.h"
+#include "eckit/log/Bytes.h"
+#include "eckit/log/Log.h"
+
+#include "fdb5/LibFdb5.h"
+#include "fdb5/toc/TocView.h"
+
+using namespace eckit;
+
+namespace fdb5 {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+namespace {
+
+class FDCloser {
+    int fd_;
+public:
+    FDCloser(int fd) : fd_(fd) {}
+    ~FDCloser() { ::close(fd_); }
+};
+
+std::mutex viewsMutex;
+std::map<std::string, std::weak_ptr<const TocView>> views;
+
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+std::shared_ptr<const TocView> TocView::open(const eckit::PathName& path, int iomode) {
+
+    int fd;
+    SYSCALL2((fd = ::open(path.localPath(), iomode)), path);
+    FDCloser closer(fd);
+
+    struct stat st;
+    SYSCALL2(::fstat(fd, &st), path);
+
+    std::lock_guard<std::mutex> lock(viewsMutex);
+
+    std::weak_ptr<const TocView>& cached(views[path.asString()]);
+    std::shared_ptr<const TocView> view = cached.lock();
+
+    if (view && view->inode_ == st.st_ino && view->fileSize_ == size_t(st.st_size)) {
+        return view;
+    }
+
+    view.reset(new TocView(path, fd, st.st_size, st.st_ino));
+    cached = view;
+
+    // Don't accumulate entries for TOCs that are no longer used
+
+    for (auto it = views.begin(); it != views.end();) {
+        if (it->second.expired()) {
+            it = views.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    return view;
+}
+
+TocView::TocView(const eckit::PathName& path, int fd, size_t fileSize, ino_t inode) :
+    path_(path),
+    addr_(nullptr),
+    mapped_(fileSize),
+    size_(0),
+    fileSize_(fileSize),
+    inode_(inode),
+    maskedEnumerated_(false) {
+
+    if (mapped_ != 0) {
+        addr_ = ::mmap(nullptr, mapped_, PROT_READ, MAP_SHARED, fd, 0);
+        if (addr_ == MAP_FAILED) {
+            addr_ = nullptr;
+            throw FailedSystemCall("mmap " + path_.asString(), Here());
+        }
+        ::madvise(addr_, mapped_, MADV_WILLNEED);
+    }
+
+    // Parse the record stream. A record that is still being appended by a writer is not (yet)
+    // part of the view.
+
+    while (size_ + sizeof(TocRecord::Header) <= mapped_) {
+        const TocRecord::Header* hdr = reinterpret_cast<const TocRecord::Header*>(data() + size_);
+        if (hdr->size_ < sizeof(TocRecord::Header) || hdr->size_ > sizeof(TocRecord)) {
+            std::ostringstream ss;
+            ss << "Invalid TOC record size " << hdr->size_ << " at offset " << size_ << " in " << path_;
+            throw SeriousBug(ss.str(), Here());
+        }
+        if (size_ + hdr->size_ > mapped_) break;
+        records_.push_back(size_);
+        size_ += hdr->size_;
+    }
+
+    Log::debug<LibFdb5>() << "Mapped TOC " << path_ << ", " << records_.size() << " records, "
+                          << Bytes(size_) << std::endl;
+}
+
+TocView::~TocView() {
+    if (addr_) {
+        ::munmap(addr_, mapped_);
+    }
+}
+
+const TocRecord::Header& TocView::header(size_t i) const {
+    ASSERT(i < records_.size());
+    return *reinterpret_cast<const TocRecord::Header*>(data() + records_[i]);
+}
+
+const unsigned char* TocView::payload(size_t i) const {
+    ASSERT(i < records_.size());
+    return reinterpret_cast<const unsigned char*>(data() + records_[i] + sizeof(TocRecord::Header));
+}
+
+size_t TocView::payloadSize(size_t i) const {
+    return header(i).size_ - sizeof(TocRecord::Header);
+}
+
+bool TocView::maskedEntries(MaskedEntries& entries) const {
+    std::lock_guard<std::mutex> lock(maskedMutex_);
+    if (maskedEnumerated_) {
+        entries = masked_;
+    }
+    return maskedEnumerated_;
+}
+
+void TocView::maskedEntries(const MaskedEntries& entries) const {
+    std::lock_guard<std::mutex> lock(maskedMutex_);
+    masked_ = entries;
+    maskedEnumerated_ = true;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+} // namespace fdb5
@@ -0,0 +1,94 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+/// @file   TocView.h
+/// @date   Oct 2026
+
+#ifndef fdb5_TocView_H
+#define fdb5_TocView_H
+
+#include <sys/types.h>
+
+#include <memory>
+#include <mutex>
+#include <set>
+#include <utility>
+#include <vector>
+
+#include "eckit/filesystem/PathName.h"
+#include "eckit/io/Offset.h"
+#include "eckit/memory/NonCopyable.h"
+
+#include "fdb5/toc/TocRecord.h"
+
+namespace fdb5 {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/// A read-only, memory mapped view of the records in a TOC file, as they were when it was opened.
+/// The record stream is parsed once into a table of record locations, and the views are shared
+/// by all the TocHandlers reading the same file in the process. As TOCs are only appended to,
+/// a view is reused for as long as the file has not grown.
+
+class TocView : private eckit::NonCopyable {
+
+public: // types
+
+    typedef std::set<std::pair<eckit::PathName, eckit::Offset>> MaskedEntries;
+
+public: // methods
+
+    /// Returns the (shared) view of the current contents of the file
+    static std::shared_ptr<const TocView> open(const eckit::PathName& path, int iomode);
+
+    ~TocView();
+
+    const eckit::PathName& path() const { return path_; }
+
+    /// The size of the (complete) records in the view, in bytes
+    size_t size() const { return size_; }
+    const char* data() const { return static_cast<const char*>(addr_); }
+
+    size_t numberOfRecords() const { return records_.size(); }
+    const TocRecord::Header& header(size_t i) const;
+    const unsigned char* payload(size_t i) const;
+    size_t payloadSize(size_t i) const;
+
+    /// The entries masked by the TOC_CLEAR records are a function only of the file contents. The
+    /// first TocHandler to enumerate them stores them here, for the others to reuse.
+    bool maskedEntries(MaskedEntries& entries) const;
+    void maskedEntries(const MaskedEntries& entries) const;
+
+private: // methods
+
+    TocView(const eckit::PathName& path, int fd, size_t fileSize, ino_t inode);
+
+private: // members
+
+    eckit::PathName path_;
+
+    void* addr_;
+    size_t mapped_;
+    size_t size_;
+    size_t fileSize_;
+    ino_t inode_;
+
+    std::vector<off_t> records_;
+
+    mutable std::mutex maskedMutex_;
+    mutable bool maskedEnumerated_;
+    mutable MaskedEntries masked_;
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+
+} // namespace fdb5
+
+#endif // fdb5_TocView_H
@@ -15,6 +15,9 @@
 
 #include "fdb5/api/helpers/ControlIterator.h"
 #include "fdb5/database/DB.h"
+#include "fdb5/toc/DirectoryCache.h"
+#include "fdb5/toc/RootCatalogue.h"
+#include "fdb5/toc/RootManager.h"
 #include "fdb5/toc/TocCatalogue.h"
 #include "fdb5/toc/TocWipeVisitor.h"
 
@@ -408,6 +411,12 @@ void TocWipeVisitor::wipe(bool wipeAll) {
             }
         }
     }
+
+    if (wipeAll && doit_) {
+        RootCatalogue::databaseWiped(CatalogueRootManager(catalogue_.config()).allRoots(catalogue_.key()),
+                                     catalogue_.basePath());
+        DirectoryCache::instance().invalidate(catalogue_.basePath());
+    }
 }
 
 
@@ -0,0 +1,77 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#include "fdb5/tools/FDBTool.h"
+
+#include "eckit/option/CmdArgs.h"
+#include "eckit/option/SimpleOption.h"
+#include "eckit/config/LocalConfiguration.h"
+
+using namespace eckit;
+
+//----------------------------------------------------------------------------------------------------------------------
+
+class FDBCompact : public fdb5::FDBTool {
+
+  public: // methods
+
+    FDBCompact(int argc, char **argv) :
+        fdb5::FDBTool(argc, argv) {
+        options_.push_back(new eckit::option::SimpleOption<long>("minimum-indexes",
+                                                                  "Only merge index keys with at least this many indexes (default 2)"));
+    }
+
+  private: // methods
+
+    virtual void usage(const std::string &tool) const;
+    virtual void execute(const eckit::option::CmdArgs& args);
+};
+
+void FDBCompact::usage(const std::string &tool) const {
+    Log::info() << std::endl
+                << "Usage: " << tool << " [--minimum-indexes=N] path" << std::endl
+                << std::endl
+                << "Merges the indexes of a DB that share an index key into one. May be run whilst" << std::endl
+                << "the DB is in use." << std::endl;
+    fdb5::FDBTool::usage(tool);
+}
+
+
+void FDBCompact::execute(const eckit::option::CmdArgs& args) {
+
+    if (args.count() != 1) {
+        usage(args.tool());
+        exit(1);
+    }
+
+    long minimumIndexes = args.getLong("minimum-indexes", 2);
+    if (minimumIndexes < 2) {
+        throw UserError("--minimum-indexes must be at least 2", Here());
+    }
+
+    eckit::PathName dbPath(args(0));
+
+    if (!dbPath.isDir()) {
+        ASSERT(dbPath.baseName() == "toc");
+        dbPath = dbPath.dirName();
+    }
+
+    std::unique_ptr<fdb5::DB> db = fdb5::DB::buildWriter(eckit::URI("toc", dbPath), eckit::LocalConfiguration());
+    size_t replaced = db->compact(minimumIndexes);
+
+    Log::info() << "Replaced " << replaced << " indexes in " << dbPath << std::endl;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+int main(int argc, char **argv) {
+    FDBCompact app(argc, argv);
+    return app.start();
+}
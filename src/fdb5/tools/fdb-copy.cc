@@ -8,11 +8,25 @@
  * does it submit to any jurisdiction.
  */
 
+#include <algorithm>
+#include <atomic>
+#include <exception>
 #include <fstream>
 #include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_set>
+#include <vector>
 
-#include "eckit/io/FileHandle.h"
+#include "eckit/container/Queue.h"
+#include "eckit/io/AutoClose.h"
+#include "eckit/io/Buffer.h"
+#include "eckit/io/DataHandle.h"
+#include "eckit/log/Bytes.h"
+#include "eckit/log/Seconds.h"
+#include "eckit/log/Timer.h"
 #include "eckit/option/CmdArgs.h"
+#include "eckit/option/SimpleOption.h"
 #include "eckit/filesystem/PathName.h"
 
 #include "metkit/mars/MarsRequest.h"
@@ -20,8 +34,9 @@
 #include "metkit/mars/MarsExpension.h"
 
 #include "fdb5/api/FDB.h"
-#include "fdb5/message/MessageArchiver.h"
-#include "fdb5/io/HandleGatherer.h"
+#include "fdb5/api/helpers/FDBToolRequest.h"
+#include "fdb5/database/FieldLocation.h"
+#include "fdb5/database/Key.h"
 #include "fdb5/tools/FDBTool.h"
 
 using namespace eckit::option;
@@ -37,11 +52,18 @@ class FDBCopy : public fdb5::FDBTool {
         options_.push_back(new SimpleOption<bool>("sort", "Sort fields according to location on input storage"));
         options_.push_back(new SimpleOption<eckit::PathName>("to", "Configuration of FDB to write to"));
         options_.push_back(new SimpleOption<eckit::PathName>("from", "Configuration of FDB to read from"));
+        options_.push_back(new SimpleOption<long>("readers", "Number of threads reading fields (default 4)"));
+        options_.push_back(new SimpleOption<long>("writers", "Number of threads archiving fields (default 1)"));
+        options_.push_back(new SimpleOption<long>("queue", "Maximum number of fields held in memory (default 64)"));
+        options_.push_back(new SimpleOption<bool>("skip-existing", "Do not copy fields already in the target FDB (to resume a copy)"));
     }
 };
 
 void FDBCopy::usage(const std::string &tool) const {
-    eckit::Log::info() << std::endl << "Usage: " << tool << " --from <config> --to <config> <request1>" << std::endl;
+    eckit::Log::info() << std::endl << "Usage: " << tool << " --from <config> --to <config> <request1>" << std::endl
+                       << std::endl
+                       << "The fields are copied with the keys by which they are indexed in the source FDB," << std::endl
+                       << "without decoding them." << std::endl;
     fdb5::FDBTool::usage(tool);
 }
 
@@ -77,6 +99,63 @@ static std::vector<metkit::mars::MarsRequest> readRequest(const CmdArgs& args) {
     return requests;
 }
 
+namespace {
+
+/// A DataHandle may return less than requested from a single read (e.g. a remote handle)
+
+void readFully(eckit::DataHandle& dh, eckit::Buffer& data, size_t length) {
+    size_t done = 0;
+    while (done < length) {
+        long len = dh.read(static_cast<char*>(data.data()) + done, length - done);
+        if (len <= 0) {
+            std::ostringstream msg;
+            msg << "Read " << done << " of " << length << " bytes from " << dh;
+            throw eckit::ReadError(msg.str());
+        }
+        done += len;
+    }
+}
+
+struct CopyItem {
+    fdb5::Key key;
+    std::unique_ptr<eckit::Buffer> data;
+    size_t length;
+};
+
+/// Collects the first error raised by any thread, and stops the others by interrupting the queues
+
+class CopyErrors {
+public:
+
+    template <typename... Queues>
+    void fail(std::exception_ptr e, Queues&... queues) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!error_) error_ = e;
+        }
+        interrupt(e, queues...);
+    }
+
+    void rethrow() {
+        if (error_) std::rethrow_exception(error_);
+    }
+
+private:
+
+    void interrupt(std::exception_ptr) {}
+
+    template <typename Queue, typename... Queues>
+    void interrupt(std::exception_ptr e, Queue& queue, Queues&... queues) {
+        queue.interrupt(e);
+        interrupt(e, queues...);
+    }
+
+    std::mutex mutex_;
+    std::exception_ptr error_;
+};
+
+}
+
 void FDBCopy::execute(const CmdArgs& args) {
 
     bool verbose            = args.getBool("verbose", false);
@@ -93,33 +172,148 @@ void FDBCopy::execute(const CmdArgs& args) {
         throw eckit::UserError("Missing --to parameter");
     }
 
+    const bool sort = args.getBool("sort", false);
+    const bool skipExisting = args.getBool("skip-existing", false);
+    const long readers = args.getLong("readers", 4);
+    const long writers = args.getLong("writers", 1);
+    const long queueSize = args.getLong("queue", 64);
+
+    if (readers < 1 || writers < 1 || queueSize < 1) {
+        throw eckit::UserError("--readers, --writers and --queue must be positive");
+    }
+
     fdb5::Config readConfig  = fdb5::Config::make(eckit::PathName(from));
     fdb5::Config writeConfig = fdb5::Config::make(eckit::PathName(to));
 
     std::vector<metkit::mars::MarsRequest> requests = readRequest(args);
 
-    // std::cout << "REQUESTS: " << std::endl;
-    // for (auto r : requests)
-    //     std::cout << r << std::endl;
+    // The fields are found by listing the source FDB, which supplies the key of each field with its
+    // location. The data is then read by a pool of readers, and archived by a pool of writers (each
+    // with its own FDB) with the same key. The messages are never decoded. Memory is bounded by the
+    // size of the queues.
 
-    // Evaluate the requests to obtain data handles
+    fdb5::FDB fdbRead(readConfig);
 
-    const bool sort = args.getBool("sort", false);
-    fdb5::HandleGatherer handles(sort);
+    std::unordered_set<fdb5::Key, fdb5::KeyHash> existing;
+    if (skipExisting) {
+        fdb5::FDB fdbTarget(writeConfig);
+        for (const auto& request : requests) {
+            auto it = fdbTarget.list(fdb5::FDBToolRequest(request), true);
+            fdb5::ListElement elem;
+            while (it.next(elem)) {
+                existing.insert(elem.combinedKey());
+            }
+        }
+        eckit::Log::info() << existing.size() << " fields already exist in the target FDB" << std::endl;
+    }
 
-    fdb5::FDB fdbRead(readConfig);
-   
-    for (const auto& request : requests) {
-        eckit::Log::info() << request << std::endl;
-        handles.add(fdbRead.retrieve(request));
+    eckit::Queue<fdb5::ListElement> locations(queueSize);
+    eckit::Queue<CopyItem> fields(queueSize);
+    CopyErrors errors;
+
+    std::atomic<size_t> copied(0);
+    std::atomic<size_t> bytes(0);
+    std::atomic<long> activeReaders(readers);
+
+    auto reader = [&]() {
+        try {
+            fdb5::ListElement elem;
+            while (locations.pop(elem) != -1) {
+                const fdb5::FieldLocation& location(elem.location());
+                size_t length = location.length();
+
+                std::unique_ptr<eckit::Buffer> data(new eckit::Buffer(length));
+                std::unique_ptr<eckit::DataHandle> dh(location.dataHandle());
+                dh->openForRead();
+                eckit::AutoClose closer(*dh);
+                readFully(*dh, *data, length);
+
+                fields.emplace(CopyItem{elem.combinedKey(), std::move(data), length});
+            }
+            if (--activeReaders == 0) {
+                fields.close();
+            }
+        } catch (...) {
+            errors.fail(std::current_exception(), locations, fields);
+        }
+    };
+
+    auto writer = [&]() {
+        try {
+            fdb5::FDB fdbWrite(writeConfig);
+            CopyItem item;
+            while (fields.pop(item) != -1) {
+                if (verbose) {
+                    eckit::Log::info() << "Copying " << item.key << std::endl;
+                }
+                fdbWrite.archive(item.key, item.data->data(), item.length);
+                bytes += item.length;
+                ++copied;
+            }
+            fdbWrite.flush();
+        } catch (...) {
+            errors.fail(std::current_exception(), locations, fields);
+        }
+    };
+
+    eckit::Timer timer;
+    size_t skipped = 0;
+
+    std::vector<std::thread> threads;
+    for (long i = 0; i < readers; ++i) threads.emplace_back(reader);
+    for (long i = 0; i < writers; ++i) threads.emplace_back(writer);
+
+    try {
+        std::vector<fdb5::ListElement> sorted;
+
+        for (const auto& request : requests) {
+            eckit::Log::info() << request << std::endl;
+
+            auto it = fdbRead.list(fdb5::FDBToolRequest(request), true);
+            fdb5::ListElement elem;
+            while (it.next(elem)) {
+                if (skipExisting && existing.find(elem.combinedKey()) != existing.end()) {
+                    ++skipped;
+                } else if (sort) {
+                    sorted.emplace_back(std::move(elem));
+                } else {
+                    locations.emplace(std::move(elem));
+                }
+            }
+        }
+
+        // Read the fields according to their location on the input storage
+
+        if (sort) {
+            std::sort(sorted.begin(), sorted.end(), [](const fdb5::ListElement& a, const fdb5::ListElement& b) {
+                const fdb5::FieldLocation& la(a.location());
+                const fdb5::FieldLocation& lb(b.location());
+                const std::string ua = la.uri().asRawString();
+                const std::string ub = lb.uri().asRawString();
+                if (ua != ub) return ua < ub;
+                return la.offset() < lb.offset();
+            });
+            for (auto& elem : sorted) {
+                locations.emplace(std::move(elem));
+            }
+        }
+
+        locations.close();
+
+    } catch (...) {
+        errors.fail(std::current_exception(), locations, fields);
     }
 
-    std::unique_ptr<eckit::DataHandle> dh(handles.dataHandle());
+    for (std::thread& t : threads) {
+        t.join();
+    }
+
+    errors.rethrow();
 
-    fdb5::MessageArchiver fdbWriter(fdb5::Key(), false, verbose, writeConfig);
-    fdbWriter.archive(*dh);
+    eckit::Log::info() << "Copied " << copied << " fields (" << eckit::Bytes(bytes) << ") in "
+                       << eckit::Seconds(timer.elapsed()) << ", skipped " << skipped << std::endl;
 }
-             
+
 int main(int argc, char **argv) {
     FDBCopy app(argc, argv);
     return app.start();
@@ -8,8 +8,11 @@
  * does it submit to any jurisdiction.
  */
 
-#include <unordered_set>
+#include <exception>
 #include <memory>
+#include <thread>
+#include <unordered_set>
+#include <vector>
 
 #include "eccodes.h"
 
@@ -22,6 +25,7 @@
 #include "eckit/option/SimpleOption.h"
 #include "eckit/option/VectorOption.h"
 
+#include "fdb5/api/FDB.h"
 #include "fdb5/message/MessageArchiver.h"
 #include "fdb5/io/HandleGatherer.h"
 #include "fdb5/tools/FDBTool.h"
@@ -45,6 +49,7 @@ class FDBWrite : public fdb5::FDBTool {
 
     void executeRead(const eckit::option::CmdArgs& args);
     void executeWrite(const eckit::option::CmdArgs& args);
+    void executeWriteThreaded(const eckit::option::CmdArgs& args);
 
 public:
 
@@ -62,6 +67,8 @@ public:
         options_.push_back(new eckit::option::SimpleOption<long>("nlevels", "Number of levels"));
         options_.push_back(new eckit::option::SimpleOption<long>("nparams", "Number of parameters"));
         options_.push_back(new eckit::option::SimpleOption<bool>("verbose", "Print verbose output"));
+        options_.push_back(new eckit::option::SimpleOption<long>("threads", "Number of threads writing the data, each with a share of the parameters (default 1)"));
+        options_.push_back(new eckit::option::SimpleOption<bool>("separate-fdbs", "With several threads, give each its own FDB rather than sharing one with concurrentArchive"));
     }
     ~FDBWrite() override {}
 
@@ -70,7 +77,7 @@ private:
 };
 
 void FDBWrite::usage(const std::string &tool) const {
-    eckit::Log::info() << std::endl << "Usage: " << tool << " [--statistics] [--read] --nsteps=<nsteps> --nensembles=<nensembles> --nlevels=<nlevels> --nparams=<nparams> --expver=<expver> <grib_path>" << std::endl;
+    eckit::Log::info() << std::endl << "Usage: " << tool << " [--statistics] [--read] [--threads=<threads> [--separate-fdbs]] --nsteps=<nsteps> --nensembles=<nensembles> --nlevels=<nlevels> --nparams=<nparams> --expver=<expver> <grib_path>" << std::endl;
     fdb5::FDBTool::usage(tool);
 }
 
@@ -91,6 +98,8 @@ void FDBWrite::execute(const eckit::option::CmdArgs &args) {
 
     if (args.getBool("read", false)) {
         executeRead(args);
+    } else if (args.getLong("threads", 1) > 1) {
+        executeWriteThreaded(args);
     } else {
         executeWrite(args);
     }
@@ -190,6 +199,137 @@ void FDBWrite::executeWrite(const eckit::option::CmdArgs &args) {
 }
 
 
+void FDBWrite::executeWriteThreaded(const eckit::option::CmdArgs &args) {
+
+    eckit::AutoStdFile fin(args(0));
+
+    int err;
+    codes_handle* handle = codes_handle_new_from_file(nullptr, fin, PRODUCT_GRIB, &err);
+    ASSERT(handle);
+
+    size_t nsteps = args.getLong("nsteps");
+    size_t nensembles = args.getLong("nensembles", 1);
+    size_t nlevels = args.getLong("nlevels");
+    size_t nparams = args.getLong("nparams");
+    size_t number  = args.getLong("number", 1);
+    size_t nthreads = args.getLong("threads");
+    bool separate = args.getBool("separate-fdbs", false);
+
+    size_t size = 0;
+
+    std::string expver = args.getString("expver");
+    size = expver.length();
+    CODES_CHECK(codes_set_string(handle, "expver", expver.c_str(), &size), 0);
+    std::string cls = args.getString("class");
+    size = cls.length();
+    CODES_CHECK(codes_set_string(handle, "class", cls.c_str(), &size), 0);
+
+    // n.b. concurrentArchive only applies to a local FDB. Otherwise, set FDB_CONCURRENT_ARCHIVE.
+
+    fdb5::Config cfg = config(args);
+    if (!separate) {
+        cfg.set("concurrentArchive", true);
+    }
+
+    std::unique_ptr<fdb5::FDB> shared;
+    if (!separate) {
+        shared.reset(new fdb5::FDB(cfg));
+    }
+
+    std::vector<size_t> writeCounts(nthreads, 0);
+    std::vector<size_t> bytesWritten(nthreads, 0);
+    std::vector<std::exception_ptr> errors(nthreads);
+
+    // Each thread writes a share of the parameters, and flushes at the end of each step
+
+    auto writer = [&](size_t id) {
+        codes_handle* h = nullptr;
+        try {
+            h = codes_handle_clone(handle);
+            ASSERT(h);
+
+            std::unique_ptr<fdb5::FDB> own;
+            if (separate) {
+                own.reset(new fdb5::FDB(cfg));
+            }
+            fdb5::FDB& fdb(separate ? *own : *shared);
+
+            const char* buffer = nullptr;
+            size_t size = 0;
+
+            for (size_t member = 0; member < nensembles; ++member) {
+                if (args.has("nensembles")) {
+                    CODES_CHECK(codes_set_long(h, "number", member+number), 0);
+                }
+                for (size_t step = 0; step < nsteps; ++step) {
+                    CODES_CHECK(codes_set_long(h, "step", step), 0);
+                    for (size_t level = 1; level <= nlevels; ++level) {
+                        CODES_CHECK(codes_set_long(h, "level", level), 0);
+                        for (size_t param = 1, real_param = 1; param <= nparams; ++param, ++real_param) {
+                            // GRIB API only allows us to use certain parameters
+                            while (AWKWARD_PARAMS.find(real_param) != AWKWARD_PARAMS.end()) {
+                                real_param++;
+                            }
+
+                            if ((param - 1) % nthreads != id) continue;
+
+                            CODES_CHECK(codes_set_long(h, "param", real_param), 0);
+                            CODES_CHECK(codes_get_message(h, reinterpret_cast<const void**>(&buffer), &size), 0);
+
+                            fdb.archive(buffer, size);
+                            writeCounts[id]++;
+                            bytesWritten[id] += size;
+                        }
+                    }
+                    fdb.flush();
+                }
+            }
+        }
+        catch (...) {
+            errors[id] = std::current_exception();
+        }
+        if (h) codes_handle_delete(h);
+    };
+
+    eckit::Timer timer;
+    timer.start();
+
+    std::vector<std::thread> threads;
+    for (size_t id = 0; id < nthreads; ++id) {
+        threads.emplace_back(writer, id);
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    if (shared) {
+        shared->flush();
+    }
+
+    timer.stop();
+
+    codes_handle_delete(handle);
+
+    for (const auto& e : errors) {
+        if (e) std::rethrow_exception(e);
+    }
+
+    size_t writeCount = 0;
+    size_t bytes = 0;
+    for (size_t id = 0; id < nthreads; ++id) {
+        writeCount += writeCounts[id];
+        bytes += bytesWritten[id];
+    }
+
+    Log::info() << "Threads: " << nthreads << (separate ? " (separate FDBs)" : " (shared FDB)") << std::endl;
+    Log::info() << "Fields written: " << writeCount << std::endl;
+    Log::info() << "Bytes written: " << bytes << std::endl;
+    Log::info() << "Total duration: " << timer.elapsed() << std::endl;
+    Log::info() << "Total rate: " << double(bytes) / timer.elapsed() << " bytes / s" << std::endl;
+    Log::info() << "Total rate: " << double(bytes) / (timer.elapsed() * 1024 * 1024) << " MB / s" << std::endl;
+}
+
+
 void FDBWrite::executeRead(const eckit::option::CmdArgs &args) {
 
 
@@ -0,0 +1,179 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#include <list>
+#include <map>
+#include <sstream>
+
+#include "eckit/option/CmdArgs.h"
+
+#include "fdb5/LibFdb5.h"
+#include "fdb5/toc/RootCatalogue.h"
+#include "fdb5/toc/TocEngine.h"
+#include "fdb5/toc/TocHandler.h"
+#include "fdb5/tools/FDBTool.h"
+
+namespace fdb5 {
+namespace tools {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+class FdbRootCatalogue : public FDBTool {
+
+public: // methods
+
+    FdbRootCatalogue(int argc, char **argv) :
+        FDBTool(argc, argv) {
+        options_.push_back(new eckit::option::SimpleOption<bool>("rebuild", "Replace an existing catalogue"));
+        options_.push_back(new eckit::option::SimpleOption<bool>("list", "List the databases in the catalogue, rather than building it"));
+    }
+
+private: // methods
+
+    virtual void execute(const eckit::option::CmdArgs& args);
+    virtual void usage(const std::string &tool) const;
+    virtual int minimumPositionalArguments() const { return 1; }
+
+    void build(const eckit::PathName& root, const Config& config, bool rebuild);
+    void list(const eckit::PathName& root);
+};
+
+void FdbRootCatalogue::usage(const std::string &tool) const {
+
+    eckit::Log::info() << std::endl
+                       << "Usage: " << tool << " [options] [root1] [root2] ..." << std::endl
+                       << std::endl
+                       << "Builds the catalogue of the databases in each root, which is used to find" << std::endl
+                       << "them instead of walking the directory tree. Once built, it is maintained" << std::endl
+                       << "as databases are created and wiped." << std::endl
+                       << std::endl
+                       << "Examples:" << std::endl
+                       << "=========" << std::endl << std::endl
+                       << tool << " /data/fdb/root1"
+                       << std::endl
+                       << std::endl;
+    FDBTool::usage(tool);
+}
+
+void FdbRootCatalogue::execute(const eckit::option::CmdArgs& args) {
+
+    bool rebuild = args.getBool("rebuild", false);
+    bool listOnly = args.getBool("list", false);
+
+    Config conf = config(args);
+
+    for (size_t i = 0; i < args.count(); ++i) {
+
+        eckit::PathName root(args(i));
+
+        if (listOnly) {
+            list(root);
+        } else {
+            build(root, conf, rebuild);
+        }
+    }
+}
+
+void FdbRootCatalogue::build(const eckit::PathName& root, const Config& config, bool rebuild) {
+
+    RootCatalogue catalogue(root);
+
+    bool replace = catalogue.exists();
+
+    if (replace && !rebuild) {
+        std::stringstream ss;
+        ss << "Catalogue " << catalogue.path() << " already exists. Use --rebuild to replace it";
+        throw FDBToolException(ss.str(), Here());
+    }
+
+    // n.b. a new catalogue is created before walking the tree, so that databases created meanwhile
+    //      are recorded either by their creator or by the walk. An existing catalogue stays in use
+    //      whilst the new one is built in a temporary file. The records added to it meanwhile are
+    //      then copied across, before the new catalogue is moved into place.
+
+    RootCatalogue target = replace ? RootCatalogue(root, eckit::PathName::unique(catalogue.path())) : catalogue;
+    size_t initialSize = replace ? catalogue.size() : 0;
+
+    target.create();
+
+    try {
+        std::string prefix = root.asString();
+        size_t skip = (prefix.empty() || prefix[prefix.size() - 1] == '/') ? prefix.size() : prefix.size() + 1;
+
+        std::list<std::string> dbs;
+        TocEngine::scan_dbs(prefix, dbs);
+
+        size_t count = 0;
+        for (const auto& path : dbs) {
+            try {
+                if (path.size() <= skip) {
+                    eckit::Log::warning() << "Root " << root << " is itself a database, skipping" << std::endl;
+                    continue;
+                }
+                TocHandler toc(path, config);
+                Key key = toc.databaseKey();
+                target.add(path.substr(skip), key);
+                eckit::Log::info() << key << " : " << path << std::endl;
+                ++count;
+            } catch (eckit::Exception& e) {
+                eckit::Log::error() << "Error loading FDB database from " << path << std::endl;
+                eckit::Log::error() << e.what() << std::endl;
+            }
+        }
+
+        if (replace) {
+            // A catalogue that failed to be updated is removed, and its records may not all be copied
+            if (!catalogue.exists()) {
+                std::stringstream ss;
+                ss << "Catalogue " << catalogue.path() << " was removed whilst it was rebuilt. Please retry";
+                throw FDBToolException(ss.str(), Here());
+            }
+            target.copyRecords(catalogue, initialSize);
+        }
+
+        target.markComplete();
+
+        if (replace) {
+            target.replace(catalogue);
+        }
+
+        eckit::Log::info() << "Catalogued " << count << " databases in " << root << std::endl;
+    }
+    catch (...) {
+        if (replace) {
+            target.path().unlink();
+        }
+        throw;
+    }
+}
+
+void FdbRootCatalogue::list(const eckit::PathName& root) {
+
+    std::map<std::string, Key> databases;
+    bool complete = RootCatalogue(root).load(databases);
+
+    for (const auto& db : databases) {
+        eckit::Log::info() << db.second << " : " << (root / db.first) << std::endl;
+    }
+
+    if (!complete) {
+        eckit::Log::warning() << "The catalogue of " << root << " is missing or incomplete" << std::endl;
+    }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+} // namespace tools
+} // namespace fbb5
+
+int main(int argc, char **argv) {
+    fdb5::tools::FdbRootCatalogue app(argc, argv);
+    return app.start();
+}
@@ -0,0 +1,196 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+#include "eckit/config/Resource.h"
+#include "eckit/io/AIOHandle.h"
+#include "eckit/log/Bytes.h"
+#include "eckit/log/Seconds.h"
+#include "eckit/log/Timer.h"
+#include "eckit/option/CmdArgs.h"
+#include "eckit/option/SimpleOption.h"
+#include "eckit/utils/Tokenizer.h"
+
+#include "fdb5/io/DirectFileHandle.h"
+#include "fdb5/io/FDBFileHandle.h"
+#include "fdb5/tools/FDBTool.h"
+
+using namespace eckit;
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/// Writes the same stream of fields through each of the data handles that a TocStore may use, with
+/// the same buffer settings, and reports the throughput and how much of the file is left in the page cache.
+
+class FDBWriteBench : public fdb5::FDBTool {
+
+public: // methods
+
+    FDBWriteBench(int argc, char **argv) :
+        fdb5::FDBTool(argc, argv) {
+        options_.push_back(new eckit::option::SimpleOption<long>("size", "Size of each field in bytes (default 1MiB)"));
+        options_.push_back(new eckit::option::SimpleOption<long>("count", "Number of fields written (default 1024)"));
+        options_.push_back(new eckit::option::SimpleOption<long>("flush-every", "Flush after this many fields (default only at the end)"));
+        options_.push_back(new eckit::option::SimpleOption<std::string>("modes", "Handles to compare, of file,async,direct (default all)"));
+        options_.push_back(new eckit::option::SimpleOption<bool>("keep", "Keep the files written"));
+    }
+
+private: // methods
+
+    virtual void usage(const std::string &tool) const;
+    virtual void execute(const eckit::option::CmdArgs& args);
+
+    DataHandle* handle(const std::string& mode, const PathName& path) const;
+};
+
+void FDBWriteBench::usage(const std::string &tool) const {
+    Log::info() << std::endl
+                << "Usage: " << tool << " [--size=bytes] [--count=N] [--flush-every=N] [--modes=file,async,direct] [--keep] directory" << std::endl
+                << std::endl
+                << "Compares the data handles used by the TocStore when writing to the directory:" << std::endl
+                << "  file    buffered stdio (default)" << std::endl
+                << "  async   asynchronous I/O (fdbAsyncWrite)" << std::endl
+                << "  direct  aligned O_DIRECT writes, bypassing the page cache (fdbDirectWrite)" << std::endl;
+    fdb5::FDBTool::usage(tool);
+}
+
+DataHandle* FDBWriteBench::handle(const std::string& mode, const PathName& path) const {
+
+    // n.b. the same settings as TocStore
+
+    if (mode == "file") {
+        static size_t sizeBuffer = eckit::Resource<unsigned long>("fdbBufferSize", 64 * 1024 * 1024);
+        return new fdb5::FDBFileHandle(path, sizeBuffer);
+    }
+
+    if (mode == "async") {
+        static size_t nbBuffers  = eckit::Resource<unsigned long>("fdbNbAsyncBuffers", 4);
+        static size_t sizeBuffer = eckit::Resource<unsigned long>("fdbSizeAsyncBuffer", 64 * 1024 * 1024);
+        return new AIOHandle(path, nbBuffers, sizeBuffer);
+    }
+
+    if (mode == "direct") {
+        static size_t nbBuffers  = eckit::Resource<unsigned long>("fdbNbDirectBuffers", 4);
+        static size_t sizeBuffer = eckit::Resource<unsigned long>("fdbSizeDirectBuffer", 16 * 1024 * 1024);
+        return new fdb5::DirectFileHandle(path, nbBuffers, sizeBuffer);
+    }
+
+    throw UserError("Unknown mode " + mode + ", expected file, async or direct", Here());
+}
+
+static size_t residentBytes(const PathName& path) {
+
+    int fd = ::open(path.localPath(), O_RDONLY);
+    if (fd < 0) return 0;
+
+    struct stat st;
+    st.st_size = 0;
+    size_t resident = 0;
+
+    if (::fstat(fd, &st) == 0 && st.st_size > 0) {
+        void* addr = ::mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        if (addr != MAP_FAILED) {
+            size_t page = ::sysconf(_SC_PAGESIZE);
+            std::vector<unsigned char> pages((st.st_size + page - 1) / page);
+            if (::mincore(addr, st.st_size, pages.data()) == 0) {
+                for (unsigned char p : pages) {
+                    if (p & 1) resident += page;
+                }
+            }
+            ::munmap(addr, st.st_size);
+        }
+    }
+
+    ::close(fd);
+    return std::min(resident, size_t(st.st_size));
+}
+
+void FDBWriteBench::execute(const eckit::option::CmdArgs& args) {
+
+    if (args.count() != 1) {
+        usage(args.tool());
+        exit(1);
+    }
+
+    size_t size = args.getLong("size", 1024 * 1024);
+    size_t count = args.getLong("count", 1024);
+    size_t flushEvery = args.getLong("flush-every", 0);
+    bool keep = args.getBool("keep", false);
+
+    std::vector<std::string> modes;
+    Tokenizer parse(",");
+    parse(args.getString("modes", "file,async,direct"), modes);
+
+    // n.b. no root is given to the handles, so nothing is recorded in the RootStatistics
+
+    PathName directory = PathName(args(0)) / "fdb-write-bench";
+    directory.mkdir();
+
+    std::vector<char> field(size);
+    for (size_t i = 0; i < size; ++i) {
+        field[i] = char(i * 31 + 7);
+    }
+
+    for (const std::string& mode : modes) {
+
+        PathName path = directory / (mode + ".data");
+        if (path.exists()) {
+            path.unlink();
+        }
+
+        std::unique_ptr<DataHandle> dh(handle(mode, path));
+
+        Timer timer;
+        timer.start();
+
+        dh->openForAppend(0);
+        for (size_t i = 0; i < count; ++i) {
+            long len = dh->write(field.data(), size);
+            ASSERT(size_t(len) == size);
+            if (flushEvery != 0 && (i + 1) % flushEvery == 0) {
+                dh->flush();
+            }
+        }
+        dh->flush();
+        dh->close();
+
+        timer.stop();
+
+        size_t bytes = size * count;
+        ASSERT(size_t(path.size()) == bytes);
+
+        Log::info() << mode << ": " << Bytes(bytes) << " in " << Seconds(timer.elapsed()) << ", "
+                    << Bytes(bytes, timer) << ", "
+                    << Bytes(residentBytes(path)) << " left in the page cache" << std::endl;
+
+        if (!keep) {
+            path.unlink();
+        }
+    }
+
+    if (!keep) {
+        directory.rmdir(false);
+    }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+int main(int argc, char **argv) {
+    FDBWriteBench app(argc, argv);
+    return app.start();
+}
@@ -0,0 +1,202 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#include <atomic>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "eckit/io/Buffer.h"
+#include "eckit/io/DataHandle.h"
+#include "eckit/testing/Test.h"
+
+#include "fdb5/api/FDB.h"
+#include "fdb5/api/helpers/FDBToolRequest.h"
+#include "fdb5/config/Config.h"
+#include "fdb5/database/ConcurrentArchiver.h"
+#include "fdb5/database/Key.h"
+
+using namespace eckit::testing;
+using namespace eckit;
+
+
+namespace fdb {
+namespace test {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+const std::string dbKey = "class=rd,expver=conc,stream=oper,date=20191110,time=0000,domain=g";
+
+const size_t nthreads = 8;
+const size_t nfields = 40;
+const size_t dataLength = 16;
+
+fdb5::Key fieldKey(size_t thread, size_t field) {
+    return fdb5::Key{dbKey + ",type=an,levtype=pl,step=0,levelist=" + std::to_string(field + 1) +
+                     ",param=" + std::to_string(130 + thread)};
+}
+
+std::string fieldData(size_t thread, size_t field) {
+    char buf[dataLength + 1];
+    std::snprintf(buf, sizeof(buf), "%07zu:%08zu", thread, field);
+    return std::string(buf, dataLength);
+}
+
+fdb5::Config concurrentConfig() {
+    fdb5::Config config = fdb5::Config().expandConfig();
+    config.set("concurrentArchive", true);
+    return config;
+}
+
+void wipe() {
+    fdb5::FDB fdb;
+    auto it = fdb.wipe(fdb5::FDBToolRequest::requestsFromString("class=rd,expver=conc")[0], true, false, true);
+    fdb5::WipeElement elem;
+    while (it.next(elem)) {}
+}
+
+/// Retrieves with a separate FDB, which only sees the data once it has been flushed
+
+bool retrieve(size_t thread, size_t field, std::string& data) {
+    fdb5::FDB fdb;
+    std::unique_ptr<DataHandle> dh(fdb.retrieve(fieldKey(thread, field).request("retrieve")));
+
+    char buf[2 * dataLength];
+    dh->openForRead();
+    long len = dh->read(buf, sizeof(buf));
+    dh->close();
+
+    if (len <= 0) return false;
+    data.assign(buf, len);
+    return true;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+CASE( "Fields archived concurrently through one FDB are all flushed" ) {
+
+    wipe();
+
+    std::atomic<size_t> errors{0};
+
+    {
+        fdb5::FDB fdb(concurrentConfig());
+
+        std::vector<std::thread> threads;
+        for (size_t t = 0; t < nthreads; ++t) {
+            threads.emplace_back([&fdb, &errors, t] {
+
+                // Flush part way through, and check that everything this thread has archived is
+                // visible once its flush returns, whilst the other threads continue to archive
+
+                for (size_t i = 0; i < nfields; ++i) {
+                    std::string data = fieldData(t, i);
+                    if (i % 2 == 0) {
+                        fdb.archive(fieldKey(t, i), data.c_str(), data.size());
+                    } else {
+                        fdb.archive(fieldKey(t, i), Buffer(data.c_str(), data.size()));
+                    }
+
+                    if (i == nfields / 2 || i == nfields - 1) {
+                        fdb.flush();
+                        for (size_t j = 0; j <= i; ++j) {
+                            std::string retrieved;
+                            if (!retrieve(t, j, retrieved) || retrieved != fieldData(t, j)) ++errors;
+                        }
+                    }
+                }
+            });
+        }
+
+        for (std::thread& t : threads) {
+            t.join();
+        }
+    }
+
+    EXPECT(errors == 0);
+
+    for (size_t t = 0; t < nthreads; ++t) {
+        for (size_t i = 0; i < nfields; ++i) {
+            std::string retrieved;
+            EXPECT(retrieve(t, i, retrieved));
+            EXPECT(retrieved == fieldData(t, i));
+        }
+    }
+}
+
+CASE( "Concurrent flushes all return" ) {
+
+    wipe();
+
+    // n.b. FDB::flush serialises the flushes, so the ConcurrentArchiver is used directly. The flushes race
+    //      to queue their barriers, which may then be reached out of order.
+
+    std::atomic<size_t> errors{0};
+
+    {
+        fdb5::ConcurrentArchiver archiver(fdb5::Config().expandConfig(), 4);
+
+        std::vector<std::thread> threads;
+        for (size_t t = 0; t < nthreads; ++t) {
+            threads.emplace_back([&archiver, &errors, t] {
+                for (size_t i = 0; i < nfields; ++i) {
+                    std::string data = fieldData(t, i);
+                    archiver.archive(fieldKey(t, i), data.c_str(), data.size());
+                    archiver.flush();
+
+                    std::string retrieved;
+                    if (!retrieve(t, i, retrieved) || retrieved != data) ++errors;
+                }
+            });
+        }
+
+        // And flushes from a thread that archives nothing
+
+        std::thread flusher([&archiver] {
+            for (size_t i = 0; i < nthreads * nfields; ++i) {
+                archiver.flush();
+            }
+        });
+
+        for (std::thread& t : threads) {
+            t.join();
+        }
+        flusher.join();
+    }
+
+    EXPECT(errors == 0);
+}
+
+CASE( "Once a field fails to archive, the error is reported to all callers" ) {
+
+    fdb5::ConcurrentArchiver archiver(fdb5::Config().expandConfig(), 4);
+
+    std::string data = fieldData(0, 0);
+
+    // No rule matches an incomplete key
+
+    archiver.archive(fdb5::Key{"class=rd,expver=conc"}, data.c_str(), data.size());
+
+    EXPECT_THROWS(archiver.flush());
+    EXPECT_THROWS(archiver.flush());
+    EXPECT_THROWS(archiver.archive(fieldKey(0, 0), data.c_str(), data.size()));
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+}  // namespace test
+}  // namespace fdb
+
+int main(int argc, char **argv)
+{
+    return run_tests ( argc, argv );
+}
@@ -0,0 +1,222 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "eckit/config/LocalConfiguration.h"
+#include "eckit/filesystem/PathName.h"
+#include "eckit/io/DataHandle.h"
+#include "eckit/testing/Test.h"
+
+#include "fdb5/api/FDB.h"
+#include "fdb5/api/helpers/FDBToolRequest.h"
+#include "fdb5/config/Config.h"
+#include "fdb5/database/Archiver.h"
+#include "fdb5/database/DB.h"
+#include "fdb5/database/Key.h"
+
+using namespace eckit::testing;
+using namespace eckit;
+
+
+namespace fdb {
+namespace test {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+const std::vector<std::string> dbKeys{
+    "class=rd,expver=arch,stream=oper,date=20191110,time=0000,domain=g",
+    "class=rd,expver=arch,stream=oper,date=20191111,time=0000,domain=g",
+};
+
+const size_t dataLength = 16;
+
+fdb5::Key fieldKey(size_t db, size_t field, const std::string& levtype = "pl") {
+    std::string key = dbKeys[db] + ",type=an,levtype=" + levtype + ",step=0,param=138";
+    if (levtype == "pl") key += ",levelist=" + std::to_string(field + 1);
+    return fdb5::Key{key};
+}
+
+std::string fieldData(size_t db, size_t field) {
+    char buf[dataLength + 1];
+    std::snprintf(buf, sizeof(buf), "%07zu:%08zu", db, field);
+    return std::string(buf, dataLength);
+}
+
+/// The mode of the Archiver is read from the environment when it is constructed
+
+void asynchronous(bool async) {
+    EXPECT(::setenv("FDB_ASYNC_ARCHIVER", async ? "1" : "0", 1) == 0);
+}
+
+void wipe() {
+    fdb5::FDB fdb;
+    auto it = fdb.wipe(fdb5::FDBToolRequest::requestsFromString("class=rd,expver=arch")[0], true, false, true);
+    fdb5::WipeElement elem;
+    while (it.next(elem)) {}
+}
+
+bool retrieve(const fdb5::Key& key, std::string& data) {
+    fdb5::FDB fdb;
+    std::unique_ptr<DataHandle> dh(fdb.retrieve(key.request("retrieve")));
+
+    char buf[2 * dataLength];
+    dh->openForRead();
+    long len = dh->read(buf, sizeof(buf));
+    dh->close();
+
+    if (len <= 0) return false;
+    data.assign(buf, len);
+    return true;
+}
+
+void checkRetrieve(size_t db, size_t field) {
+    std::string data;
+    EXPECT(retrieve(fieldKey(db, field), data));
+    EXPECT(data == fieldData(db, field));
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+CASE( "Fields archived asynchronously are written once flushed" ) {
+
+    wipe();
+    asynchronous(true);
+
+    const size_t nfields = 20;
+
+    {
+        fdb5::Archiver archiver;
+
+        for (size_t i = 0; i < nfields; ++i) {
+            for (size_t db = 0; db < dbKeys.size(); ++db) {
+
+                // n.b. the data is copied, so the caller may reuse its buffer straight away
+
+                std::string data = fieldData(db, i);
+                archiver.archive(fieldKey(db, i), data.c_str(), data.size());
+                data.assign(dataLength, 'x');
+            }
+        }
+
+        archiver.flush();
+
+        for (size_t i = 0; i < nfields; ++i) {
+            for (size_t db = 0; db < dbKeys.size(); ++db) {
+                checkRetrieve(db, i);
+            }
+        }
+    }
+
+    asynchronous(false);
+}
+
+CASE( "An error in an asynchronous worker is reported by flush" ) {
+
+    wipe();
+    asynchronous(true);
+
+    // n.b. without sub tocs, closing the database doesn't write to it once the data has been flushed
+
+    eckit::LocalConfiguration userConfig;
+    userConfig.set("useSubToc", false);
+    fdb5::Config config(fdb5::Config().expandConfig(), userConfig);
+
+    {
+        fdb5::Archiver archiver(config);
+
+        std::string data = fieldData(0, 0);
+        archiver.archive(fieldKey(0, 0), data.c_str(), data.size());
+        archiver.flush();
+
+        // Remove the database from under the worker, so that it cannot create a new index
+
+        PathName directory = fdb5::DB::buildReader(fdb5::Key{dbKeys[0]}, config)->uri().path();
+        std::vector<PathName> files;
+        std::vector<PathName> dirs;
+        directory.children(files, dirs);
+        for (const PathName& f : files) {
+            f.unlink();
+        }
+        directory.rmdir(false);
+
+        // n.b. the key is expanded on this thread, and the worker fails to write it
+
+        archiver.archive(fieldKey(0, 0, "sfc"), data.c_str(), data.size());
+
+        EXPECT_THROWS(archiver.flush());
+    }
+
+    asynchronous(false);
+    wipe();
+}
+
+CASE( "The least recently used database is closed, and reopened when it is archived to again" ) {
+
+    for (bool async : {false, true}) {
+
+        wipe();
+        asynchronous(async);
+
+        fdb5::Config config = fdb5::Config().expandConfig();
+        config.set("maxOpenDatabases", 1);
+
+        const size_t rounds = 3;
+
+        {
+            fdb5::Archiver archiver(config);
+
+            for (size_t i = 0; i < rounds; ++i) {
+                for (size_t db = 0; db < dbKeys.size(); ++db) {
+                    std::string data = fieldData(db, i);
+                    archiver.archive(fieldKey(db, i), data.c_str(), data.size());
+                }
+            }
+
+            // A database that is already open is reused
+
+            std::string data = fieldData(1, rounds);
+            archiver.archive(fieldKey(1, rounds), data.c_str(), data.size());
+
+            archiver.flush();
+
+            fdb5::FDBStats stats = archiver.stats();
+            EXPECT(stats.numDatabaseOpen() == rounds * dbKeys.size());
+            EXPECT(stats.numDatabaseEvict() == rounds * dbKeys.size() - 1);
+            EXPECT(stats.numDatabaseHit() == 1);
+        }
+
+        // The fields written before each database was closed are kept
+
+        for (size_t i = 0; i < rounds; ++i) {
+            for (size_t db = 0; db < dbKeys.size(); ++db) {
+                checkRetrieve(db, i);
+            }
+        }
+        checkRetrieve(1, rounds);
+    }
+
+    asynchronous(false);
+    wipe();
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+}  // namespace test
+}  // namespace fdb
+
+int main(int argc, char **argv)
+{
+    return run_tests ( argc, argv );
+}
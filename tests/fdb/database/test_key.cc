@@ -0,0 +1,126 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#include <functional>
+#include <sstream>
+#include <string>
+
+#include "eckit/testing/Test.h"
+
+#include "fdb5/database/Key.h"
+#include "fdb5/rules/Schema.h"
+
+using namespace eckit::testing;
+using namespace eckit;
+
+
+namespace fdb {
+namespace test {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/// The values and hashes are cached, so must be checked after every change to the key
+
+void checkValues(const fdb5::Key& key, const std::string& values) {
+    EXPECT(key.valuesToString() == values);
+    EXPECT(key.hash() == std::hash<std::string>()(values));
+    EXPECT(std::hash<fdb5::Key>()(key) == key.hash());
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+CASE( "The values of a key follow its modifications" ) {
+
+    fdb5::Key key;
+    checkValues(key, "");
+
+    key.push("class", "rd");
+    key.push("expver", "xxxx");
+    checkValues(key, "rd:xxxx");
+
+    key.set("expver", "yyyy");
+    checkValues(key, "rd:yyyy");
+
+    key.set("stream", "oper");
+    checkValues(key, "rd:yyyy:oper");
+
+    key.unset("stream");
+    checkValues(key, "rd:yyyy");
+
+    // n.b. the values are canonicalised (levelist is a Double in the schema)
+
+    key.push("levelist", "500.0");
+    checkValues(key, "rd:yyyy:500");
+
+    key.pop("levelist");
+    checkValues(key, "rd:yyyy");
+
+    key.clear();
+    checkValues(key, "");
+}
+
+CASE( "Copies of a key are unaffected by modifications of the original" ) {
+
+    fdb5::Key key;
+    key.push("class", "rd");
+    key.push("expver", "xxxx");
+    checkValues(key, "rd:xxxx");
+
+    fdb5::Key copy(key);
+    fdb5::Key assigned;
+    assigned = key;
+
+    key.set("expver", "yyyy");
+    checkValues(key, "rd:yyyy");
+    checkValues(copy, "rd:xxxx");
+    checkValues(assigned, "rd:xxxx");
+
+    fdb5::Key moved(std::move(copy));
+    checkValues(moved, "rd:xxxx");
+
+    moved.push("stream", "oper");
+    checkValues(moved, "rd:xxxx:oper");
+    checkValues(assigned, "rd:xxxx");
+}
+
+CASE( "The values of a key follow the types of its rule" ) {
+
+    // The types of a rule override those of the default schema
+
+    std::istringstream s(
+        "[ class, expver\n"
+        "    [ type, levtype\n"
+        "        [ step, levelist:Default, param ]]]\n");
+
+    fdb5::Schema schema(s);
+    const fdb5::Rule* rule = schema.ruleFor(fdb5::Key{"class=rd,expver=xxxx"}, fdb5::Key{"type=an,levtype=pl"});
+    EXPECT(rule);
+
+    fdb5::Key key;
+    key.push("class", "rd");
+    key.push("levelist", "500.0");
+    checkValues(key, "rd:500");
+
+    key.rule(rule);
+    checkValues(key, "rd:500.0");
+
+    key.rule(nullptr);
+    checkValues(key, "rd:500");
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+}  // namespace test
+}  // namespace fdb
+
+int main(int argc, char **argv)
+{
+    return run_tests ( argc, argv );
+}
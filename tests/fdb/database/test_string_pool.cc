@@ -0,0 +1,127 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "eckit/testing/Test.h"
+
+#include "fdb5/database/StringPool.h"
+
+using namespace eckit::testing;
+using namespace eckit;
+
+
+namespace fdb {
+namespace test {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+// n.b. the pool is process-wide, so each case uses its own strings
+
+CASE( "Interning a string twice gives the same id" ) {
+
+    fdb5::StringPool& pool(fdb5::StringPool::instance());
+
+    size_t size = pool.size();
+
+    fdb5::StringPool::id_t a = pool.intern("test-interned-a");
+    fdb5::StringPool::id_t b = pool.intern("test-interned-b");
+    fdb5::StringPool::id_t empty = pool.intern("");
+
+    EXPECT(a != b);
+    EXPECT(a != empty);
+    EXPECT(pool.size() == size + 3);
+
+    EXPECT(pool.intern("test-interned-a") == a);
+    EXPECT(pool.intern(std::string("test-interned-") + "b") == b);
+    EXPECT(pool.intern("") == empty);
+    EXPECT(pool.size() == size + 3);
+
+    EXPECT(pool.get(a) == "test-interned-a");
+    EXPECT(pool.get(b) == "test-interned-b");
+    EXPECT(pool.get(empty) == "");
+}
+
+CASE( "Interned strings do not move as the pool grows" ) {
+
+    fdb5::StringPool& pool(fdb5::StringPool::instance());
+
+    fdb5::StringPool::id_t first = pool.intern("test-growth-0");
+    const std::string* ref = &pool.get(first);
+
+    // More than one chunk of strings
+
+    const size_t count = 10000;
+    std::vector<fdb5::StringPool::id_t> ids;
+    for (size_t i = 1; i < count; ++i) {
+        ids.push_back(pool.intern("test-growth-" + std::to_string(i)));
+    }
+
+    EXPECT(&pool.get(first) == ref);
+    EXPECT(*ref == "test-growth-0");
+
+    for (size_t i = 1; i < count; ++i) {
+        EXPECT(pool.get(ids[i - 1]) == "test-growth-" + std::to_string(i));
+    }
+}
+
+CASE( "Strings interned concurrently are given a single id" ) {
+
+    fdb5::StringPool& pool(fdb5::StringPool::instance());
+
+    const size_t nthreads = 8;
+    const size_t count = 5000;
+
+    size_t size = pool.size();
+
+    // Each thread interns the same strings, half of them in the reverse order
+
+    std::vector<std::vector<fdb5::StringPool::id_t>> ids(nthreads, std::vector<fdb5::StringPool::id_t>(count));
+    std::vector<std::thread> threads;
+
+    for (size_t t = 0; t < nthreads; ++t) {
+        threads.emplace_back([&pool, &ids, t, count] {
+            for (size_t n = 0; n < count; ++n) {
+                size_t i = (t % 2 == 0) ? n : count - 1 - n;
+                fdb5::StringPool::id_t id = pool.intern("test-concurrent-" + std::to_string(i));
+                ids[t][i] = id;
+                if (pool.get(id) != "test-concurrent-" + std::to_string(i)) {
+                    ids[t][i] = fdb5::StringPool::id_t(-1);
+                }
+            }
+        });
+    }
+
+    for (std::thread& t : threads) {
+        t.join();
+    }
+
+    EXPECT(pool.size() == size + count);
+
+    for (size_t i = 0; i < count; ++i) {
+        EXPECT(ids[0][i] != fdb5::StringPool::id_t(-1));
+        for (size_t t = 1; t < nthreads; ++t) {
+            EXPECT(ids[t][i] == ids[0][i]);
+        }
+        EXPECT(pool.get(ids[0][i]) == "test-concurrent-" + std::to_string(i));
+    }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+}  // namespace test
+}  // namespace fdb
+
+int main(int argc, char **argv)
+{
+    return run_tests ( argc, argv );
+}
@@ -0,0 +1,166 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#include "eckit/filesystem/PathName.h"
+#include "eckit/testing/Test.h"
+
+#include "fdb5/io/DirectFileHandle.h"
+
+using namespace eckit::testing;
+using namespace eckit;
+
+
+namespace fdb {
+namespace test {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+// Small buffers (of two 4KiB blocks), so that the writes span several of them
+
+const size_t nbBuffers = 2;
+const size_t bufferSize = 8192;
+
+std::string pattern(size_t offset, size_t length) {
+    std::string s(length, ' ');
+    for (size_t i = 0; i < length; ++i) {
+        s[i] = char('a' + (offset + i) % 26);
+    }
+    return s;
+}
+
+std::string contents(const PathName& path) {
+    std::ifstream in(path.localPath(), std::ifstream::binary);
+    std::stringstream ss;
+    ss << in.rdbuf();
+    return ss.str();
+}
+
+/// Appends length bytes, in writes of at most chunk bytes, checking the position as it goes
+
+void append(DataHandle& dh, size_t length, size_t chunk) {
+    size_t start = size_t(dh.position());
+    size_t done = 0;
+    while (done < length) {
+        size_t n = std::min(chunk, length - done);
+        std::string s = pattern(start + done, n);
+        EXPECT(dh.write(s.c_str(), n) == long(n));
+        done += n;
+        EXPECT(size_t(dh.position()) == start + done);
+    }
+}
+
+void checkFile(const PathName& path, size_t length) {
+    EXPECT(size_t(path.size()) == length);
+    EXPECT(contents(path) == pattern(0, length));
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+CASE( "A flush leaves the file with exactly the data written" ) {
+
+    PathName path = PathName::unique(PathName("direct_file_handle.data"));
+
+    {
+        fdb5::DirectFileHandle dh(path, nbBuffers, bufferSize);
+        dh.openForAppend(0);
+        EXPECT(dh.position() == Offset(0));
+
+        // Part of a block, with no padding left behind
+
+        append(dh, 100, 100);
+        dh.flush();
+        checkFile(path, 100);
+
+        // The partial block is rewritten as it fills, and beyond
+
+        append(dh, 30000, 1000);
+        dh.flush();
+        checkFile(path, 30100);
+
+        // Nothing new
+
+        dh.flush();
+        checkFile(path, 30100);
+
+        dh.close();
+    }
+
+    checkFile(path, 30100);
+
+    path.unlink();
+}
+
+CASE( "A file reopened part way through a block is appended to" ) {
+
+    PathName path = PathName::unique(PathName("direct_file_handle.data"));
+
+    size_t length = 0;
+
+    for (size_t length1 : {size_t(1), size_t(4095), size_t(4097), size_t(10000)}) {
+
+        fdb5::DirectFileHandle dh(path, nbBuffers, bufferSize);
+        dh.openForAppend(0);
+        EXPECT(size_t(dh.position()) == length);
+
+        append(dh, length1, 777);
+        length += length1;
+
+        dh.flush();
+        EXPECT(size_t(dh.position()) == length);
+        checkFile(path, length);
+
+        dh.close();
+        checkFile(path, length);
+    }
+
+    // Reopened, and closed without writing anything
+
+    {
+        fdb5::DirectFileHandle dh(path, nbBuffers, bufferSize);
+        dh.openForAppend(0);
+        EXPECT(size_t(dh.position()) == length);
+        dh.close();
+    }
+
+    checkFile(path, length);
+
+    path.unlink();
+}
+
+CASE( "Closing without a flush writes everything" ) {
+
+    PathName path = PathName::unique(PathName("direct_file_handle.data"));
+
+    {
+        fdb5::DirectFileHandle dh(path, nbBuffers, bufferSize);
+        dh.openForAppend(0);
+        append(dh, 5 * bufferSize + 123, 3000);
+        dh.close();
+    }
+
+    checkFile(path, 5 * bufferSize + 123);
+
+    path.unlink();
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+}  // namespace test
+}  // namespace fdb
+
+int main(int argc, char **argv)
+{
+    return run_tests ( argc, argv );
+}
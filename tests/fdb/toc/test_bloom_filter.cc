@@ -0,0 +1,131 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "eckit/testing/Test.h"
+
+#include "fdb5/toc/BloomFilter.h"
+
+using namespace eckit::testing;
+using namespace eckit;
+
+
+namespace fdb {
+namespace test {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+const size_t nkeys = 10000;
+
+std::string key(size_t i) {
+    return "od:0001:oper:20191110:0000:g:an:pl:0:" + std::to_string(i) + ":138";
+}
+
+fdb5::BloomFilter makeFilter() {
+    fdb5::BloomFilter filter(nkeys, 10);
+    for (size_t i = 0; i < nkeys; ++i) {
+        filter.insert(fdb5::BloomFilter::hash(key(i)));
+    }
+    return filter;
+}
+
+size_t falsePositives(const fdb5::BloomFilter& filter) {
+    size_t count = 0;
+    for (size_t i = nkeys; i < 2 * nkeys; ++i) {
+        if (filter.mayContain(fdb5::BloomFilter::hash(key(i)))) ++count;
+    }
+    return count;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+CASE( "A BloomFilter has no false negatives" ) {
+
+    fdb5::BloomFilter filter = makeFilter();
+    EXPECT(!filter.empty());
+
+    for (size_t i = 0; i < nkeys; ++i) {
+        EXPECT(filter.mayContain(fdb5::BloomFilter::hash(key(i))));
+    }
+
+    // With 10 bits per key, about 1% of the keys not inserted are (falsely) matched
+
+    EXPECT(falsePositives(filter) < nkeys / 20);
+}
+
+CASE( "An empty BloomFilter may contain anything" ) {
+
+    fdb5::BloomFilter filter;
+    EXPECT(filter.empty());
+    EXPECT(filter.mayContain(fdb5::BloomFilter::hash(key(0))));
+
+    fdb5::BloomFilter none(0, 10);
+    EXPECT(none.empty());
+    none.insert(fdb5::BloomFilter::hash(key(0)));
+    EXPECT(none.mayContain(fdb5::BloomFilter::hash(key(1))));
+
+    char buf[64];
+    EXPECT(filter.encode(buf, sizeof(buf)) == 0);
+}
+
+CASE( "A BloomFilter is unchanged by encoding and decoding" ) {
+
+    fdb5::BloomFilter filter = makeFilter();
+
+    std::vector<char> buf(nkeys * 2);
+    EXPECT(filter.encode(buf.data(), 16) == 0);
+
+    size_t size = filter.encode(buf.data(), buf.size());
+    EXPECT(size > 0);
+    EXPECT(size < buf.size());
+
+    // n.b. the encoded filter may be followed by padding
+
+    fdb5::BloomFilter decoded;
+    EXPECT(decoded.decode(buf.data(), buf.size()));
+
+    for (size_t i = 0; i < nkeys; ++i) {
+        EXPECT(decoded.mayContain(fdb5::BloomFilter::hash(key(i))));
+    }
+    EXPECT(falsePositives(decoded) == falsePositives(filter));
+
+    // But it must not be truncated
+
+    fdb5::BloomFilter truncated;
+    EXPECT(!truncated.decode(buf.data(), size - 1));
+    EXPECT(truncated.empty());
+}
+
+CASE( "Data that is not a BloomFilter is not decoded" ) {
+
+    std::vector<char> buf(1024, 0);
+
+    fdb5::BloomFilter filter;
+    EXPECT(!filter.decode(buf.data(), buf.size()));
+    EXPECT(!filter.decode(buf.data(), 4));
+
+    ::memset(buf.data(), 0xff, buf.size());
+    EXPECT(!filter.decode(buf.data(), buf.size()));
+
+    EXPECT(filter.empty());
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+}  // namespace test
+}  // namespace fdb
+
+int main(int argc, char **argv)
+{
+    return run_tests ( argc, argv );
+}
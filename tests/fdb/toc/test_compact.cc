@@ -0,0 +1,284 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#include <atomic>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "eckit/config/LocalConfiguration.h"
+#include "eckit/io/DataHandle.h"
+#include "eckit/testing/Test.h"
+
+#include "fdb5/api/FDB.h"
+#include "fdb5/api/helpers/FDBToolRequest.h"
+#include "fdb5/config/Config.h"
+#include "fdb5/database/DB.h"
+#include "fdb5/database/Key.h"
+
+using namespace eckit::testing;
+using namespace eckit;
+
+
+namespace fdb {
+namespace test {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+const std::string dbKey = "class=rd,expver=cmpt,stream=oper,date=20191110,time=0000,domain=g";
+const std::string otherDbKey = "class=rd,expver=cmpo,stream=oper,date=20191110,time=0000,domain=g";
+const std::string indexKey = "type=an,levtype=pl";
+
+const size_t nfields = 8;
+const size_t dataLength = 16;
+
+fdb5::Key fieldKey(size_t field, const std::string& db = dbKey) {
+    return fdb5::Key{db + "," + indexKey + ",step=0,levelist=" + std::to_string(100 * (field + 1)) + ",param=138"};
+}
+
+std::string fieldData(size_t field, size_t version) {
+    char buf[dataLength + 1];
+    std::snprintf(buf, sizeof(buf), "%07zu:%08zu", field, version);
+    return std::string(buf, dataLength);
+}
+
+/// Without sub tocs, each flush appends an index to the TOC of the DB
+
+fdb5::Config config(bool subTocs = false) {
+    eckit::LocalConfiguration userConfig;
+    userConfig.set("useSubToc", subTocs);
+    return fdb5::Config(fdb5::Config().expandConfig(), userConfig);
+}
+
+void wipe() {
+    fdb5::FDB fdb;
+    for (const std::string& request : {"class=rd,expver=cmpt", "class=rd,expver=cmpo"}) {
+        auto it = fdb.wipe(fdb5::FDBToolRequest::requestsFromString(request)[0], true, false, true);
+        fdb5::WipeElement elem;
+        while (it.next(elem)) {}
+    }
+}
+
+/// Writes a new version of every field, and flushes it as a new index
+
+void archiveVersion(fdb5::FDB& fdb, size_t version, const std::string& db = dbKey) {
+    for (size_t i = 0; i < nfields; ++i) {
+        std::string data = fieldData(i, version);
+        fdb.archive(fieldKey(i, db), data.c_str(), data.size());
+    }
+    fdb.flush();
+}
+
+std::string retrieve(size_t field) {
+    fdb5::FDB fdb;
+    std::unique_ptr<DataHandle> dh(fdb.retrieve(fieldKey(field).request("retrieve")));
+
+    char buf[2 * dataLength];
+    dh->openForRead();
+    long len = dh->read(buf, sizeof(buf));
+    dh->close();
+
+    EXPECT(len == long(dataLength));
+    return std::string(buf, dataLength);
+}
+
+size_t compact() {
+    std::unique_ptr<fdb5::DB> db = fdb5::DB::buildWriter(fdb5::Key{dbKey}, config());
+    return db->compact(2);
+}
+
+void overlay(bool unmount) {
+    std::unique_ptr<fdb5::DB> source = fdb5::DB::buildReader(fdb5::Key{otherDbKey}, config());
+    std::unique_ptr<fdb5::DB> target = fdb5::DB::buildWriter(fdb5::Key{dbKey}, config());
+    target->overlayDB(*source, {"expver"}, unmount);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+CASE( "Compaction keeps the most recent version of each field" ) {
+
+    wipe();
+
+    {
+        fdb5::FDB fdb(config());
+        for (size_t version = 0; version < 4; ++version) {
+            archiveVersion(fdb, version);
+        }
+    }
+
+    for (size_t i = 0; i < nfields; ++i) {
+        EXPECT(retrieve(i) == fieldData(i, 3));
+    }
+
+    EXPECT(compact() == 4);
+
+    for (size_t i = 0; i < nfields; ++i) {
+        EXPECT(retrieve(i) == fieldData(i, 3));
+    }
+
+    // Nothing left to merge
+
+    EXPECT(compact() == 0);
+
+    // Data archived after the compaction takes precedence over the merged index
+
+    {
+        fdb5::FDB fdb(config());
+        archiveVersion(fdb, 4);
+    }
+
+    for (size_t i = 0; i < nfields; ++i) {
+        EXPECT(retrieve(i) == fieldData(i, 4));
+    }
+
+    EXPECT(compact() == 2);
+
+    for (size_t i = 0; i < nfields; ++i) {
+        EXPECT(retrieve(i) == fieldData(i, 4));
+    }
+}
+
+CASE( "Compaction whilst the DB is written does not hide newer data" ) {
+
+    wipe();
+
+    const size_t versions = 50;
+
+    {
+        fdb5::FDB fdb(config());
+        archiveVersion(fdb, 0);
+    }
+
+    std::atomic<bool> writing{true};
+
+    std::thread writer([&writing] {
+        fdb5::FDB fdb(config());
+        for (size_t version = 1; version < versions; ++version) {
+            archiveVersion(fdb, version);
+        }
+        writing = false;
+    });
+
+    // A compaction that races with a flush must either be abandoned, or include the new index
+
+    size_t replaced = 0;
+    while (writing) {
+        replaced += compact();
+    }
+
+    writer.join();
+
+    for (size_t i = 0; i < nfields; ++i) {
+        EXPECT(retrieve(i) == fieldData(i, versions - 1));
+    }
+
+    replaced += compact();
+    EXPECT(replaced > 0);
+
+    for (size_t i = 0; i < nfields; ++i) {
+        EXPECT(retrieve(i) == fieldData(i, versions - 1));
+    }
+}
+
+CASE( "Compaction does not hide the indexes of a sub toc" ) {
+
+    wipe();
+
+    {
+        fdb5::FDB fdb(config());
+        archiveVersion(fdb, 0);
+        archiveVersion(fdb, 1);
+    }
+
+    {
+        // A writer using a sub toc, which has flushed but not yet closed
+
+        fdb5::FDB fdb(config(true));
+        archiveVersion(fdb, 2);
+
+        for (size_t i = 0; i < nfields; ++i) {
+            EXPECT(retrieve(i) == fieldData(i, 2));
+        }
+
+        // The merged index would take precedence over the sub toc
+
+        EXPECT(compact() == 0);
+
+        for (size_t i = 0; i < nfields; ++i) {
+            EXPECT(retrieve(i) == fieldData(i, 2));
+        }
+    }
+
+    // On closing, the writer appends its own index to the TOC, which may then be merged
+
+    EXPECT(compact() == 3);
+
+    for (size_t i = 0; i < nfields; ++i) {
+        EXPECT(retrieve(i) == fieldData(i, 2));
+    }
+}
+
+CASE( "Compaction does not hide the indexes of a mounted DB" ) {
+
+    wipe();
+
+    {
+        fdb5::FDB fdb(config());
+        archiveVersion(fdb, 0);
+        archiveVersion(fdb, 1);
+        archiveVersion(fdb, 2, otherDbKey);
+    }
+
+    overlay(false);
+
+    for (size_t i = 0; i < nfields; ++i) {
+        EXPECT(retrieve(i) == fieldData(i, 2));
+    }
+
+    EXPECT(compact() == 0);
+
+    for (size_t i = 0; i < nfields; ++i) {
+        EXPECT(retrieve(i) == fieldData(i, 2));
+    }
+
+    // Data archived after the mount takes precedence over it, but the older indexes are still not merged
+
+    {
+        fdb5::FDB fdb(config());
+        archiveVersion(fdb, 3);
+    }
+
+    EXPECT(compact() == 0);
+
+    for (size_t i = 0; i < nfields; ++i) {
+        EXPECT(retrieve(i) == fieldData(i, 3));
+    }
+
+    overlay(true);
+
+    EXPECT(compact() == 3);
+
+    for (size_t i = 0; i < nfields; ++i) {
+        EXPECT(retrieve(i) == fieldData(i, 3));
+    }
+
+    wipe();
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+}  // namespace test
+}  // namespace fdb
+
+int main(int argc, char **argv)
+{
+    return run_tests ( argc, argv );
+}
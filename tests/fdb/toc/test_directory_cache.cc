@@ -0,0 +1,148 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#include <vector>
+
+#include "eckit/filesystem/PathName.h"
+#include "eckit/testing/Test.h"
+
+#include "fdb5/database/Key.h"
+#include "fdb5/toc/DirectoryCache.h"
+#include "fdb5/toc/FileSpace.h"
+#include "fdb5/toc/Root.h"
+
+using namespace eckit::testing;
+using namespace eckit;
+
+
+namespace fdb {
+namespace test {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+fdb5::TocPath tocPath(const PathName& directory) {
+    return fdb5::TocPath{directory, fdb5::ControlIdentifiers{}};
+}
+
+PathName makeRoot() {
+    PathName root = PathName::unique(PathName("directory_cache_root"));
+    root.mkdir();
+    return root.realName();
+}
+
+void removeRoot(const PathName& root, const PathName& db) {
+    PathName dir = root / db;
+    if ((dir / "toc").exists()) (dir / "toc").unlink();
+    if (dir.exists()) dir.rmdir(false);
+    root.rmdir(false);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+CASE( "The DirectoryCache returns the entries inserted" ) {
+
+    fdb5::DirectoryCache& cache(fdb5::DirectoryCache::instance());
+    cache.clear();
+
+    bool found = false;
+    fdb5::TocPath root;
+
+    size_t misses = cache.misses();
+    EXPECT(!cache.lookup("space", "rd:aaaa", found, root));
+    EXPECT(cache.misses() == misses + 1);
+
+    cache.insert("space", "rd:aaaa", true, tocPath("/root/a"));
+    cache.insert("space", "rd:bbbb", false, fdb5::TocPath{});
+
+    size_t hits = cache.hits();
+
+    EXPECT(cache.lookup("space", "rd:aaaa", found, root));
+    EXPECT(found);
+    EXPECT(root.directory_ == "/root/a");
+
+    EXPECT(cache.lookup("space", "rd:bbbb", found, root));
+    EXPECT(!found);
+
+    EXPECT(cache.hits() == hits + 2);
+
+    // The entries belong to a file space
+
+    EXPECT(!cache.lookup("other", "rd:aaaa", found, root));
+
+    cache.clear();
+    EXPECT(!cache.lookup("space", "rd:aaaa", found, root));
+}
+
+CASE( "Creating or wiping a database invalidates its entries" ) {
+
+    fdb5::DirectoryCache& cache(fdb5::DirectoryCache::instance());
+    cache.clear();
+
+    bool found;
+    fdb5::TocPath root;
+
+    cache.insert("space1", "rd:aaaa", false, fdb5::TocPath{});
+    cache.insert("space2", "rd:aaaa", true, tocPath("/root/a"));
+    cache.insert("space1", "rd:aaaaa", false, fdb5::TocPath{});
+    cache.insert("space1", "rd:bbbb", false, fdb5::TocPath{});
+
+    // n.b. the directory is that of the database, in whichever root it is
+
+    cache.invalidate("/root/b/rd:aaaa");
+
+    EXPECT(!cache.lookup("space1", "rd:aaaa", found, root));
+    EXPECT(!cache.lookup("space2", "rd:aaaa", found, root));
+    EXPECT(cache.lookup("space1", "rd:aaaaa", found, root));
+    EXPECT(cache.lookup("space1", "rd:bbbb", found, root));
+
+    cache.clear();
+}
+
+CASE( "A database created elsewhere is found by writers, despite a cached negative entry" ) {
+
+    fdb5::DirectoryCache::instance().clear();
+
+    PathName first = makeRoot();
+    PathName second = makeRoot();
+    PathName db("rd:dcch");
+
+    // The First handler would create the database in the first root
+
+    std::vector<fdb5::Root> roots{fdb5::Root(first, "test", true, true, true, true),
+                                  fdb5::Root(second, "test", true, true, true, true)};
+    fdb5::FileSpace space("test", ".*", "First", roots);
+
+    fdb5::Key key{"class=rd,expver=dcch"};
+
+    EXPECT(space.filesystem(key, db).directory_ == first);
+
+    // As if by another process, which doesn't invalidate the cache here
+
+    (second / db).mkdir();
+    (second / db / "toc").touch();
+
+    EXPECT(space.filesystem(key, db).directory_ == second);
+    EXPECT(space.filesystem(key, db).directory_ == second);
+
+    fdb5::DirectoryCache::instance().clear();
+
+    removeRoot(first, db);
+    removeRoot(second, db);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+}  // namespace test
+}  // namespace fdb
+
+int main(int argc, char **argv)
+{
+    return run_tests ( argc, argv );
+}
@@ -0,0 +1,194 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#include "eckit/filesystem/PathName.h"
+#include "eckit/testing/Test.h"
+#include "eckit/thread/AutoLock.h"
+
+#include "fdb5/toc/ExpverFileSpaceHandler.h"
+
+using namespace eckit::testing;
+using namespace eckit;
+
+
+namespace fdb {
+namespace test {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/// Exposes the table maintained by the handler. The file used is given by FDB_EXPVER_FILE.
+
+class ExpverFile : public fdb5::ExpverFileSpaceHandler {
+public:
+
+    using fdb5::ExpverFileSpaceHandler::append;
+
+    bool find(const std::string& expver, PathName& path, bool locked = false) const {
+        AutoLock<Mutex> lock(mutex_);
+        auto table = refresh(locked);
+        auto it = table->paths_.find(expver);
+        if (it == table->paths_.end()) return false;
+        path = it->second;
+        return true;
+    }
+};
+
+PathName expverFile(const std::string& contents) {
+    PathName path = PathName::unique(PathName("expver.map"));
+    std::ofstream of(path.localPath());
+    of << contents;
+    of.close();
+    EXPECT(::setenv("FDB_EXPVER_FILE", path.localPath(), 1) == 0);
+    return path;
+}
+
+void removeExpverFile(const PathName& path) {
+    path.unlink();
+    PathName lockFile = path + ".lock";
+    if (lockFile.exists()) lockFile.unlink();
+}
+
+std::string contents(const PathName& path) {
+    std::ifstream in(path.localPath());
+    std::stringstream ss;
+    ss << in.rdbuf();
+    return ss.str();
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+CASE( "A last line without a newline is only read with the file locked" ) {
+
+    PathName file = expverFile("# comment\naaaa /root/a\n\nbbbb /root/b");
+
+    ExpverFile table;
+    PathName path;
+
+    // Without the lock, it may be a line that is still being written
+
+    EXPECT(table.find("aaaa", path));
+    EXPECT(path == "/root/a");
+    EXPECT(!table.find("bbbb", path));
+
+    EXPECT(table.find("bbbb", path, true));
+    EXPECT(path == "/root/b");
+
+    // And once read, it is not read again
+
+    EXPECT(table.find("bbbb", path));
+    EXPECT(table.find("aaaa", path));
+
+    removeExpverFile(file);
+}
+
+CASE( "Appending to a file whose last line has no newline" ) {
+
+    PathName file = expverFile("aaaa /root/a\nbbbb /root/b");
+
+    {
+        ExpverFile table;
+
+        // An expver on the last line is found, rather than appended again
+
+        EXPECT(table.append("bbbb", "/root/other") == "/root/b");
+        EXPECT(contents(file) == "aaaa /root/a\nbbbb /root/b");
+
+        EXPECT(table.append("cccc", "/root/c") == "/root/c");
+        EXPECT(contents(file) == "aaaa /root/a\nbbbb /root/b\ncccc /root/c\n");
+
+        PathName path;
+        EXPECT(table.find("cccc", path));
+        EXPECT(path == "/root/c");
+    }
+
+    // The file is read correctly from scratch
+
+    ExpverFile table;
+    PathName path;
+    EXPECT(table.find("aaaa", path));
+    EXPECT(path == "/root/a");
+    EXPECT(table.find("bbbb", path));
+    EXPECT(path == "/root/b");
+    EXPECT(table.find("cccc", path));
+    EXPECT(path == "/root/c");
+
+    removeExpverFile(file);
+}
+
+CASE( "Lines appended by other processes are found" ) {
+
+    PathName file = expverFile("aaaa /root/a\n");
+
+    ExpverFile table;
+    PathName path;
+    EXPECT(table.find("aaaa", path));
+    EXPECT(!table.find("bbbb", path));
+
+    {
+        std::ofstream of(file.localPath(), std::ofstream::app);
+        of << "bbbb /root/b\ncccc /root/c\n";
+    }
+
+    EXPECT(table.find("bbbb", path));
+    EXPECT(path == "/root/b");
+
+    // Another process beat us to it
+
+    {
+        std::ofstream of(file.localPath(), std::ofstream::app);
+        of << "dddd /root/d\n";
+    }
+
+    EXPECT(table.append("dddd", "/root/other") == "/root/d");
+    EXPECT(table.append("eeee", "/root/e") == "/root/e");
+
+    EXPECT(contents(file) == "aaaa /root/a\nbbbb /root/b\ncccc /root/c\ndddd /root/d\neeee /root/e\n");
+
+    removeExpverFile(file);
+}
+
+CASE( "A file that is replaced is read again" ) {
+
+    PathName file = expverFile("aaaa /root/a\n");
+
+    ExpverFile table;
+    PathName path;
+    EXPECT(table.find("aaaa", path));
+
+    // n.b. replaced by a new file, rather than rewritten in place
+
+    PathName replacement = PathName::unique(PathName("expver.map"));
+    {
+        std::ofstream of(replacement.localPath());
+        of << "bbbb /root/b\n";
+    }
+    PathName::rename(replacement, file);
+
+    EXPECT(!table.find("aaaa", path));
+    EXPECT(table.find("bbbb", path));
+    EXPECT(path == "/root/b");
+
+    removeExpverFile(file);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+}  // namespace test
+}  // namespace fdb
+
+int main(int argc, char **argv)
+{
+    return run_tests ( argc, argv );
+}
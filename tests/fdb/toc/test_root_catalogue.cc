@@ -0,0 +1,170 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#include <unistd.h>
+
+#include <map>
+#include <string>
+
+#include "eckit/filesystem/PathName.h"
+#include "eckit/testing/Test.h"
+
+#include "fdb5/database/Key.h"
+#include "fdb5/toc/RootCatalogue.h"
+
+using namespace eckit::testing;
+using namespace eckit;
+
+
+namespace fdb {
+namespace test {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+PathName makeRoot() {
+    PathName root = PathName::unique(PathName("root_catalogue_root"));
+    root.mkdir();
+    return root.realName();
+}
+
+void removeRoot(const PathName& root) {
+    fdb5::RootCatalogue catalogue(root);
+    if (catalogue.exists()) catalogue.path().unlink();
+    root.rmdir(false);
+}
+
+std::map<std::string, fdb5::Key> load(const PathName& root, bool complete = true) {
+    std::map<std::string, fdb5::Key> databases;
+    EXPECT(fdb5::RootCatalogue(root).load(databases) == complete);
+    return databases;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+CASE( "Databases created and wiped are recorded in the catalogue of their root" ) {
+
+    PathName root = makeRoot();
+    PathName other = makeRoot();
+
+    fdb5::Key keyA{"class=rd,expver=aaaa"};
+    fdb5::Key keyB{"class=rd,expver=bbbb"};
+
+    // Without a catalogue, nothing is recorded
+
+    fdb5::RootCatalogue::databaseCreated(root, root / "rd:aaaa", keyA);
+    EXPECT(!fdb5::RootCatalogue(root).exists());
+    load(root, false);
+
+    // Until it is complete, the catalogue is not used
+
+    fdb5::RootCatalogue catalogue(root);
+    catalogue.create();
+
+    fdb5::RootCatalogue::databaseCreated(root, root / "rd:aaaa", keyA);
+    EXPECT(load(root, false).size() == 1);
+
+    catalogue.markComplete();
+
+    fdb5::RootCatalogue::databaseCreated(root, root / "rd:bbbb", keyB);
+    fdb5::RootCatalogue::databaseCreated(root, other / "rd:cccc", keyB);
+
+    std::map<std::string, fdb5::Key> databases = load(root);
+    EXPECT(databases.size() == 2);
+    EXPECT(databases["rd:aaaa"] == keyA);
+    EXPECT(databases["rd:bbbb"] == keyB);
+
+    // n.b. the wipe is given all of the roots that may contain the database
+
+    fdb5::RootCatalogue::databaseWiped({other, root}, root / "rd:aaaa");
+
+    databases = load(root);
+    EXPECT(databases.size() == 1);
+    EXPECT(databases.find("rd:aaaa") == databases.end());
+    EXPECT(databases["rd:bbbb"] == keyB);
+
+    removeRoot(root);
+    removeRoot(other);
+}
+
+CASE( "A rebuilt catalogue includes the databases created whilst it was built" ) {
+
+    PathName root = makeRoot();
+
+    fdb5::Key keyA{"class=rd,expver=aaaa"};
+    fdb5::Key keyB{"class=rd,expver=bbbb"};
+    fdb5::Key keyC{"class=rd,expver=cccc"};
+
+    fdb5::RootCatalogue catalogue(root);
+    catalogue.create();
+    catalogue.add("rd:aaaa", keyA);
+    catalogue.markComplete();
+
+    // As fdb-root-catalogue --rebuild, the existing catalogue is in use whilst the tree is walked
+
+    fdb5::RootCatalogue target(root, PathName::unique(catalogue.path()));
+    size_t initialSize = catalogue.size();
+    target.create();
+
+    target.add("rd:bbbb", keyB);
+    fdb5::RootCatalogue::databaseCreated(root, root / "rd:cccc", keyC);
+
+    target.copyRecords(catalogue, initialSize);
+    target.markComplete();
+    target.replace(catalogue);
+
+    EXPECT(!target.exists());
+
+    std::map<std::string, fdb5::Key> databases = load(root);
+    EXPECT(databases.size() == 2);
+    EXPECT(databases["rd:bbbb"] == keyB);
+    EXPECT(databases["rd:cccc"] == keyC);
+
+    removeRoot(root);
+}
+
+CASE( "A catalogue that cannot be appended to is removed, and the root walked instead" ) {
+
+    // Writes to /dev/full fail, whatever the permissions of the process
+
+    if (!PathName("/dev/full").exists()) {
+        return;
+    }
+
+    PathName root = makeRoot();
+
+    fdb5::Key key{"class=rd,expver=aaaa"};
+
+    for (bool wipe : {false, true}) {
+
+        fdb5::RootCatalogue catalogue(root);
+        EXPECT(::symlink("/dev/full", catalogue.path().localPath()) == 0);
+
+        if (wipe) {
+            fdb5::RootCatalogue::databaseWiped({root}, root / "rd:aaaa");
+        } else {
+            fdb5::RootCatalogue::databaseCreated(root, root / "rd:aaaa", key);
+        }
+
+        EXPECT(!catalogue.exists());
+        load(root, false);
+    }
+
+    removeRoot(root);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+}  // namespace test
+}  // namespace fdb
+
+int main(int argc, char **argv)
+{
+    return run_tests ( argc, argv );
+}
@@ -0,0 +1,209 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#include <map>
+#include <string>
+
+#include "eckit/exception/Exceptions.h"
+#include "eckit/filesystem/PathName.h"
+#include "eckit/testing/Test.h"
+
+#include "fdb5/toc/SortedArrayIndex.h"
+
+using namespace eckit::testing;
+using namespace eckit;
+
+
+namespace fdb {
+namespace test {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+typedef std::map<std::string, fdb5::FieldRef> entries_t;
+
+fdb5::FieldRef fieldRef(size_t i) {
+    return fdb5::FieldRef(fdb5::FieldRefLocation(i % 7, Offset(1024 * i), Length(100 + i)));
+}
+
+bool sameLocation(const fdb5::FieldRef& lhs, const fdb5::FieldRef& rhs) {
+    return lhs.uriId() == rhs.uriId() && lhs.offset() == rhs.offset() && lhs.length() == rhs.length();
+}
+
+class CollectVisitor : public fdb5::BTreeIndexVisitor {
+public:
+    CollectVisitor(entries_t& entries) : entries_(entries) {}
+    void visit(const std::string& key, const fdb5::FieldRef& ref) override {
+        EXPECT(entries_.insert(std::make_pair(key, ref)).second);
+    }
+private:
+    entries_t& entries_;
+};
+
+/// Enough keys to fill several runs between the fences
+
+entries_t makeEntries(size_t count, const std::string& prefix) {
+    entries_t entries;
+    for (size_t i = 0; i < count; ++i) {
+        entries[prefix + std::to_string(i * 7919 % 100003)] = fieldRef(i);
+    }
+    return entries;
+}
+
+void writeIndex(const PathName& path, off_t offset, const entries_t& entries, bool hashed) {
+    fdb5::SortedArrayIndex index(path, false, offset, hashed);
+    for (const auto& e : entries) {
+        EXPECT(!index.set(e.first, e.second));
+    }
+    index.flush();
+    index.sync();
+}
+
+void checkIndex(const PathName& path, off_t offset, const entries_t& entries, bool hashed) {
+
+    fdb5::SortedArrayIndex index(path, true, offset, hashed);
+
+    for (const auto& e : entries) {
+        fdb5::FieldRef ref;
+        EXPECT(index.get(e.first, ref));
+        EXPECT(sameLocation(ref, e.second));
+    }
+
+    fdb5::FieldRef ref;
+    EXPECT(!index.get("missing", ref));
+    EXPECT(!index.get("", ref));
+
+    entries_t visited;
+    CollectVisitor visitor(visited);
+    index.visit(visitor);
+
+    EXPECT(visited.size() == entries.size());
+    for (const auto& e : entries) {
+        auto it = visited.find(e.first);
+        EXPECT(it != visited.end());
+        EXPECT(sameLocation(it->second, e.second));
+    }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+CASE( "SortedArrayIndex entries are found after a round trip" ) {
+
+    PathName path = PathName::unique(PathName("sorted_array.index"));
+
+    entries_t first = makeEntries(1000, "step=");
+    entries_t second = makeEntries(10, "param=");
+
+    // The second index is at an offset that is not aligned to a page
+
+    writeIndex(path, 0, first, false);
+    off_t offset = path.size();
+    EXPECT(offset % 4096 != 0);
+    writeIndex(path, offset, second, false);
+
+    checkIndex(path, 0, first, false);
+    checkIndex(path, offset, second, false);
+
+    // Keys from one index are not found in the other
+
+    {
+        fdb5::SortedArrayIndex index(path, true, offset);
+        fdb5::FieldRef ref;
+        EXPECT(!index.get(first.begin()->first, ref));
+    }
+
+    path.unlink();
+}
+
+CASE( "SortedArrayIndex keeps the last value set for a key" ) {
+
+    PathName path = PathName::unique(PathName("sorted_array.index"));
+
+    {
+        fdb5::SortedArrayIndex index(path, false, 0);
+        EXPECT(!index.set("levelist=500", fieldRef(1)));
+        EXPECT(index.set("levelist=500", fieldRef(2)));
+        index.flush();
+    }
+
+    fdb5::SortedArrayIndex index(path, true, 0);
+    fdb5::FieldRef ref;
+    EXPECT(index.get("levelist=500", ref));
+    EXPECT(sameLocation(ref, fieldRef(2)));
+
+    path.unlink();
+}
+
+CASE( "SortedArrayIndex rejects keys that are too long" ) {
+
+    PathName path = PathName::unique(PathName("sorted_array.index"));
+
+    {
+        fdb5::SortedArrayIndex index(path, false, 0);
+        EXPECT_THROWS_AS(index.set(std::string(fdb5::SortedArrayIndex::keySize + 1, 'x'), fieldRef(0)), BadParameter);
+        EXPECT(!index.set(std::string(fdb5::SortedArrayIndex::keySize, 'x'), fieldRef(0)));
+    }
+
+    path.unlink();
+}
+
+CASE( "HashedKeyIndex entries of any length are found after a round trip" ) {
+
+    PathName path = PathName::unique(PathName("hashed_key.index"));
+
+    std::string longPrefix = "class=rd,expver=xxxx,stream=oper,date=20191110,time=0000,levelist=";
+    EXPECT(longPrefix.size() > fdb5::SortedArrayIndex::keySize);
+
+    entries_t first = makeEntries(2000, longPrefix);
+    entries_t second = makeEntries(10, "p");
+
+    writeIndex(path, 0, first, true);
+    off_t offset = path.size();
+    writeIndex(path, offset, second, true);
+
+    checkIndex(path, 0, first, true);
+    checkIndex(path, offset, second, true);
+
+    // The layout is determined by the stored header, not by the type that opens it
+
+    {
+        fdb5::SortedArrayIndex index(path, true, 0);
+        fdb5::FieldRef ref;
+        EXPECT(index.get(first.begin()->first, ref));
+        EXPECT(sameLocation(ref, first.begin()->second));
+    }
+
+    {
+        fdb5::HashedKeyIndex index(path, true, offset);
+        fdb5::FieldRef ref;
+        EXPECT(index.get(second.begin()->first, ref));
+        EXPECT(!index.get(first.begin()->first, ref));
+    }
+
+    path.unlink();
+}
+
+CASE( "The hash of the keys is stable" ) {
+
+    // n.b. the hash is stored in the indexes, so it must never change
+
+    EXPECT(fdb5::SortedArrayIndex::hash("levelist=500", 12) == 0x4344d8797835886fULL);
+    EXPECT(fdb5::SortedArrayIndex::hash("", 0) == 0xefd01f60ba992926ULL);
+    EXPECT(fdb5::SortedArrayIndex::hash("levelist=500", 12) != fdb5::SortedArrayIndex::hash("levelist=501", 12));
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+}  // namespace test
+}  // namespace fdb
+
+int main(int argc, char **argv)
+{
+    return run_tests ( argc, argv );
+}